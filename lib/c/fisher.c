@@ -4,99 +4,196 @@
 #include <math.h>
 #include "fisher.h"
 
-#include "gsl/gsl_randist.h"
-
-static double *_buf = NULL;
-static unsigned int _allocn = 0;
-
 /**
-  * Can't just use _allocn as an indicator since explicit reserve/releases
-  * can cycle _allocn between 0 and non-zero, but once atexit is called
-  * the registration is permanent.
+  * The hypergeometric probabilities are computed from a table of
+  * log-factorials, so the only transcendental function evaluated per
+  * support point is the exp() that undoes the logarithm.
   */
-static int _callback_registered = 0;
+struct fexact_workspace {
 
-static void _fexact_free( void ) {
-	if( _buf ) free( _buf );
-}
+	/**
+	  * Largest table total (m+n) the workspace can handle without
+	  * growing.
+	  */
+	unsigned int capacity;
 
-int fexact_reserve( unsigned int n ) {
-	_buf = (double*)realloc( _buf, n * sizeof(double) );
-	if( _buf ) {
-		if( ! _callback_registered ) {
-			_callback_registered = 1;
-			atexit( _fexact_free );
-		}
-		_allocn = n;
-		return 0;
-	} else
+	/**
+	  * lnfact[i] == log(i!) for i in [0,capacity].
+	  */
+	double *lnfact;
+
+	/**
+	  * Probabilities of the support points.
+	  */
+	double *buf;
+};
+
+
+static int _grow( struct fexact_workspace *ws, unsigned int n ) {
+
+	double *lnfact = realloc( ws->lnfact, (n+1)*sizeof(double) );
+	double *buf;
+
+	if( NULL == lnfact )
+		return -1;
+	ws->lnfact = lnfact;
+
+	buf = realloc( ws->buf, (n+1)*sizeof(double) );
+	if( NULL == buf )
 		return -1;
+	ws->buf = buf;
+
+	// log(i!) is a running sum of log(i) rather than lgamma(i+1), which
+	// is not reentrant (it sets signgam). Summing in extended precision
+	// (where available) keeps its error comparable to that of lgamma.
+
+	if( ws->capacity == 0 )
+		lnfact[0] = 0.0;
+	long double sum = lnfact[ ws->capacity ];
+	for(unsigned int i = ws->capacity+1; i <= n; i++ )
+		lnfact[i] = (double)( sum += log( i ) );
+	ws->capacity = n;
+	return 0;
 }
 
 
-void fexact_release() {
-	if( _buf ) free( _buf );
-	_buf = NULL;
-	_allocn = 0;
+void *fexact_alloc( unsigned int n ) {
+	struct fexact_workspace *ws
+		= calloc( 1, sizeof(struct fexact_workspace) );
+	if( ws && _grow( ws, n ) ) {
+		fexact_free( ws );
+		ws = NULL;
+	}
+	return ws;
 }
 
 
-double fexact_prob( unsigned int x, unsigned int m, unsigned int n, unsigned int k ) {
+void fexact_free( void *pv ) {
+	struct fexact_workspace *ws = (struct fexact_workspace *)pv;
+	if( ws ) {
+		if( ws->buf )    free( ws->buf );
+		if( ws->lnfact ) free( ws->lnfact );
+		free( ws );
+	}
+}
+
+
+double fexact_prob_r( void *pv, unsigned int x, unsigned int m, unsigned int n, unsigned int k ) {
+
+	struct fexact_workspace *ws = (struct fexact_workspace *)pv;
 
 	// support is [lo,hi]...
-	const unsigned int lo = 0 < k-n ? k-n : 0;
-	const unsigned int hi = k < m   ? k   : m;
+	const unsigned int lo = k > n ? k-n : 0;
+	const unsigned int hi = k < m ? k   : m;
 	const unsigned int N = hi-lo+1;
 
-	double lim, sum = 0.0, max = 0.0;
-	int i;
+	const double *F = ws->lnfact;
+	double *buf = ws->buf;
+	double C, lim, sum = 0.0, max;
+	unsigned int i;
 
-	if( _allocn < N ) {
-		_buf = (double*)realloc( _buf, N * sizeof(double) );
-		if( NULL == _buf ) {
-			fprintf( stderr, "error: failed realloc( %p, %ld ) @ %s:%d\n",
-				_buf, N*sizeof(double), __FILE__, __LINE__ );
+	if( NULL == ws->lnfact || ws->capacity < m+n ) {
+		if( _grow( ws, m+n ) ) {
+			fprintf( stderr, "error: failed realloc @ %s:%d\n", __FILE__, __LINE__ );
 			return nan("NaN");
 		}
-		// If this is first allocation, register for cleanup.
-		if( ! _callback_registered ) {
-			_callback_registered = 1;
-			atexit( _fexact_free );
-		}
-		_allocn = N;
+		F   = ws->lnfact;
+		buf = ws->buf;
 	}
 
-	// Begin calculation.
+	// log p(i) = log C(m,i) + log C(n,k-i) - log C(m+n,k) where
+	// the last term, common to all i, is immaterial after the
+	// normalization below...
 
-	i = N;
-		_buf[0] 
-			= max 
-			= log( gsl_ran_hypergeometric_pdf( lo+0, m, n, k ) );
-	while( i-- > 1 ) {
-		const double d 
-			= log( gsl_ran_hypergeometric_pdf( lo+i, m, n, k ) );
+	C = F[m] + F[n];
+	max = -HUGE_VAL;
+	for(i = 0; i < N; i++ ) {
+		const unsigned int j = lo + i;
+		const double d
+			= C - F[j] - F[m-j] - F[k-j] - F[n-k+j];
 		if( max < d )
 			max = d;
-		_buf[i] = d;
+		buf[i] = d;
 	}
-	i = N; while( i-- > 0 ) {
-		_buf[i] = exp( _buf[i] - max );
-		sum += _buf[i];
-	}	
-	i = N; while( i-- > 0 ) {
-		_buf[i] /= sum;
+	for(i = 0; i < N; i++ ) {
+		buf[i] = exp( buf[i] - max );
+		sum += buf[i];
+	}
+	for(i = 0; i < N; i++ ) {
+		buf[i] /= sum;
 	}
 
-	lim = _buf[x-lo]*(1.0+1e-7);
+	lim = buf[x-lo]*(1.0+1e-7);
 
 	// Sum up the probabilities
 
 	sum = 0.0;
-	i = N; while( i-- > 0 ) {
-		if( _buf[i] <= lim ) sum += _buf[i];
+	for(i = 0; i < N; i++ ) {
+		if( buf[i] <= lim ) sum += buf[i];
+	}
+
+	// Rounding can carry the sum over the whole support a hair past 1.
+	return sum < 1.0 ? sum : 1.0;
+}
+
+
+double fexact_point_prob_r( void *pv, unsigned int x, unsigned int m, unsigned int n, unsigned int k ) {
+
+	struct fexact_workspace *ws = (struct fexact_workspace *)pv;
+	const double *F;
+
+	if( NULL == ws->lnfact || ws->capacity < m+n ) {
+		if( _grow( ws, m+n ) ) {
+			fprintf( stderr, "error: failed realloc @ %s:%d\n", __FILE__, __LINE__ );
+			return nan("NaN");
+		}
+	}
+	F = ws->lnfact;
+
+	// p(x) = C(m,x) C(n,k-x) / C(m+n,k)
+
+	return exp( F[m] + F[n] + F[k] + F[m+n-k] - F[m+n]
+		- F[x] - F[m-x] - F[k-x] - F[n-k+x] );
+}
+
+
+/***************************************************************************
+  * The original, non-reentrant API, implemented with a private workspace.
+  */
+
+static struct fexact_workspace *_default = NULL;
+
+static void _fexact_free( void ) {
+	fexact_free( _default );
+	_default = NULL;
+}
+
+int fexact_reserve( unsigned int n ) {
+	if( NULL == _default ) {
+		_default = fexact_alloc( n );
+		if( NULL == _default )
+			return -1;
+		atexit( _fexact_free );
+		return 0;
+	}
+	return n > _default->capacity ? _grow( _default, n ) : 0;
+}
+
+
+void fexact_release() {
+	if( _default ) {
+		free( _default->buf );
+		free( _default->lnfact );
+		_default->buf = _default->lnfact = NULL;
+		_default->capacity = 0;
 	}
+}
 
-	return sum;
+
+double fexact_prob( unsigned int x, unsigned int m, unsigned int n, unsigned int k ) {
+	if( NULL == _default && fexact_reserve( m+n ) )
+		return nan("NaN");
+	return fexact_prob_r( _default, x, m, n, k );
 }
 
 
@@ -107,11 +204,6 @@ double fexact_prob( unsigned int x, unsigned int m, unsigned int n, unsigned int
   * ...where C(a,b) = a!/(b!(a-b)!) and t <= n_1 + n_2. 
   * The domain of k is max(0,t-n_2), ..., min(t,n_1).
   *
-  *   gsl_ran_hypergeometric_pdf( k,  n1,  n2,  t)
-  * This function computes the probability p(k) of obtaining k from a 
-  * hypergeometric distribution with parameters n1, n2, t, using the 
-  * formula given above.
-  *
   * argv[1] | argv[2]      a | b
   * --------+--------  ==  --+--
   * argv[3] | argv[4]      c | d
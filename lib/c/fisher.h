@@ -2,14 +2,37 @@
 #ifndef __fisher_h__
 #define __fisher_h__
 
-/**
-  * Warning: NOT THREAD-SAFE !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-  */
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+  * A workspace holds a table of log-factorials for table totals up to n
+  * (it grows automatically if a larger table is encountered) and the
+  * scratch space for the support of the distribution. Distinct
+  * workspaces may be used concurrently.
+  */
+void *fexact_alloc( unsigned int n );
+void  fexact_free( void *ws );
+
+/**
+  * Reentrant equivalent of fexact_prob (below).
+  */
+double fexact_prob_r( void *ws, unsigned int x, unsigned int m, unsigned int n, unsigned int k );
+
+/**
+  * The probability of the given table alone, in constant time. Since it
+  * is a lower bound of fexact_prob_r's two-tail probability, callers that
+  * only compare that with a threshold need not compute it when this
+  * (clearly) exceeds the threshold.
+  */
+double fexact_point_prob_r( void *ws, unsigned int x, unsigned int m, unsigned int n, unsigned int k );
+
+/**
+  * Warning: The following are NOT THREAD-SAFE !!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+  * They use a single private workspace.
+  */
+
 /**
   * Pre-reserves buffer space to preclude just-in-time allocation
   * (or RE-allocation).
@@ -0,0 +1,284 @@
+
+/**
+ * Fast, exact printf-compatible formatting of doubles.
+ *
+ * A value v is scaled by a power of ten so that the digits to be printed
+ * form the integer part; the fraction then decides rounding. Scaling by
+ * exact powers of ten costs at most a few ulps of relative error, so
+ * whenever the computed fraction lies within that error of one half the
+ * correctly rounded result (which is what glibc's printf produces) is
+ * uncertain and snprintf is used instead. This is rare for real data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "numfmt.h"
+
+/**
+  * All powers of ten that are exactly representable as doubles.
+  */
+static const double POW10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_EXACT_POW10 (22)
+
+static const uint64_t IPOW10[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL
+};
+
+/**
+  * Relative error allowed for in scaled values (many times the worst
+  * accumulated rounding error of _scale).
+  */
+#define TOLERANCE (1e-13)
+
+
+static double _scale( double a, int k ) {
+	while( k > MAX_EXACT_POW10 ) {
+		a *= POW10[ MAX_EXACT_POW10 ];
+		k -= MAX_EXACT_POW10;
+	}
+	while( k < -MAX_EXACT_POW10 ) {
+		a /= POW10[ MAX_EXACT_POW10 ];
+		k += MAX_EXACT_POW10;
+	}
+	return k >= 0 ? a*POW10[k] : a/POW10[-k];
+}
+
+
+/**
+  * Round the non-negative scaled value half-to-even into *n unless the
+  * outcome is uncertain, in which case returns false.
+  */
+static bool _round( double scaled, uint64_t *n ) {
+	const double f = floor( scaled );
+	const double frac = scaled - f;
+	if( fabs( frac - 0.5 ) <= scaled*TOLERANCE )
+		return false;
+	*n = (uint64_t)f + ( frac > 0.5 ? 1 : 0 );
+	return true;
+}
+
+
+/**
+  * Write the w least significant decimal digits of n.
+  */
+static char *_digits( char *buf, uint64_t n, int w ) {
+	for(int i = w-1; i >= 0; i-- ) {
+		buf[i] = '0' + (n % 10);
+		n /= 10;
+	}
+	return buf + w;
+}
+
+
+static char *_fallback( char *buf, const char *fmt, int prec, double v ) {
+	const int n = snprintf( buf, NUMFMT_MAXLEN, fmt, prec, v );
+	return buf + ( n < NUMFMT_MAXLEN ? n : NUMFMT_MAXLEN-1 );
+}
+
+
+char *numfmt_int( char *buf, long v ) {
+	char tmp[24];
+	char *pc = tmp + sizeof(tmp);
+	unsigned long u = v < 0 ? -(unsigned long)v : (unsigned long)v;
+	do {
+		*--pc = '0' + (u % 10);
+		u /= 10;
+	} while( u );
+	if( v < 0 )
+		*--pc = '-';
+	memcpy( buf, pc, tmp + sizeof(tmp) - pc );
+	return buf + ( tmp + sizeof(tmp) - pc );
+}
+
+
+char *numfmt_exp( char *buf, double v, int prec, bool plus ) {
+
+	const double a = fabs( v );
+	uint64_t n = 0;
+	int e = 0;
+
+	if( ! isfinite( v ) || ( a < DBL_MIN && a > 0.0 )
+			|| prec < 0 || prec > NUMFMT_MAXPREC )
+		return _fallback( buf, plus ? "%+.*e" : "%.*e", prec, v );
+
+	if( a > 0.0 ) {
+		double scaled;
+		e = (int)floor( log10( a ) );
+		scaled = _scale( a, prec - e );
+		// log10 may be off by one near powers of ten.
+		if( scaled < IPOW10[prec] ) {
+			e -= 1;
+			scaled = _scale( a, prec - e );
+		} else
+		if( scaled >= IPOW10[prec+1] ) {
+			e += 1;
+			scaled = _scale( a, prec - e );
+		}
+		if( ! _round( scaled, &n ) )
+			return _fallback( buf, plus ? "%+.*e" : "%.*e", prec, v );
+		if( n == IPOW10[prec+1] ) {
+			n  = IPOW10[prec];
+			e += 1;
+		}
+	}
+
+	if( signbit( v ) )
+		*buf++ = '-';
+	else
+	if( plus )
+		*buf++ = '+';
+	*buf++ = '0' + (int)( n / IPOW10[prec] );
+	if( prec > 0 ) {
+		*buf++ = '.';
+		buf = _digits( buf, n, prec );
+	}
+	*buf++ = 'e';
+	*buf++ = e < 0 ? '-' : '+';
+	e = abs( e );
+	return _digits( buf, e, e < 100 ? 2 : 3 );
+}
+
+
+char *numfmt_fixed( char *buf, double v, int prec, bool plus ) {
+
+	const double a = fabs( v );
+	double scaled;
+	uint64_t n, q;
+	int w = 1;
+
+	if( ! isfinite( v ) || prec < 0 || prec > NUMFMT_MAXPREC
+			|| ! ( ( scaled = a*POW10[prec] ) < 1e15 )
+			|| ! _round( scaled, &n ) )
+		return _fallback( buf, plus ? "%+.*f" : "%.*f", prec, v );
+
+	if( signbit( v ) )
+		*buf++ = '-';
+	else
+	if( plus )
+		*buf++ = '+';
+	q = n / IPOW10[prec];
+	while( q >= IPOW10[w] ) // ...q < 1e15
+		w++;
+	buf = _digits( buf, q, w );
+	if( prec > 0 ) {
+		*buf++ = '.';
+		buf = _digits( buf, n, prec );
+	}
+	return buf;
+}
+
+
+void numfmt_parse( const char *fmt, struct numfmt_spec *spec ) {
+
+	char *end;
+
+	memset( spec, 0, sizeof(struct numfmt_spec) );
+	if( *fmt++ != '%' )
+		return;
+	if( *fmt == '+' ) {
+		spec->plus = true;
+		fmt++;
+	}
+	if( *fmt++ != '.' || ! ( '0' <= *fmt && *fmt <= '9' ) )
+		return;
+	spec->prec = strtol( fmt, &end, 10 );
+	if( spec->prec <= NUMFMT_MAXPREC
+			&& ( *end == 'e' || *end == 'f' ) && end[1] == 0 )
+		spec->conv = *end;
+}
+
+
+char *numfmt_double( char *buf, double v, const struct numfmt_spec *spec ) {
+	return spec->conv == 'e'
+		? numfmt_exp(   buf, v, spec->prec, spec->plus )
+		: numfmt_fixed( buf, v, spec->prec, spec->plus );
+}
+
+
+#ifdef AUTOUNIT_TEST_NUMFMT
+
+/**
+  * Compares every function against snprintf on values of all magnitudes,
+  * exact ties and the usual special cases.
+  */
+
+static int _failures = 0;
+
+static double _uniform( void ) {
+	return rand() / ( RAND_MAX + 1.0 );
+}
+
+static void _check( const char *fmt, const char *got, const char *gotend, double v, int prec ) {
+	char expect[ NUMFMT_MAXLEN ];
+	snprintf( expect, sizeof(expect), fmt, prec, v );
+	if( (size_t)(gotend - got) != strlen( expect )
+			|| strncmp( got, expect, gotend - got ) ) {
+		fprintf( stderr, "%s(%d) of %.17g: expected \"%s\", got \"%.*s\"\n",
+			fmt, prec, v, expect, (int)(gotend - got), got );
+		_failures += 1;
+	}
+}
+
+static void _test( double v ) {
+	char buf[ NUMFMT_MAXLEN ];
+	for(int prec = 0; prec <= NUMFMT_MAXPREC; prec++ ) {
+		_check( "%.*e",  buf, numfmt_exp(   buf, v, prec, false ), v, prec );
+		_check( "%+.*e", buf, numfmt_exp(   buf, v, prec, true  ), v, prec );
+		_check( "%.*f",  buf, numfmt_fixed( buf, v, prec, false ), v, prec );
+		_check( "%+.*f", buf, numfmt_fixed( buf, v, prec, true  ), v, prec );
+	}
+}
+
+int main( int argc, char *argv[] ) {
+
+	const int N = argc > 1 ? atoi( argv[1] ) : 20000;
+	const double SPECIAL[] = {
+		0.0, -0.0, 1.0, -1.0, 0.5, 0.125, 0.0125, 2.5, 1e-300, 5e-324,
+		DBL_MIN, DBL_MAX, 9.9995, 99.995, 0.0005, 1e15, 123456789.0,
+		INFINITY, -INFINITY, NAN
+	};
+	char buf[ NUMFMT_MAXLEN ];
+
+	for(unsigned i = 0; i < sizeof(SPECIAL)/sizeof(double); i++ )
+		_test( SPECIAL[i] );
+
+	srand( 1 );
+	for(int i = 0; i < N; i++ ) {
+		// Uniform in the exponent so that all magnitudes are exercised.
+		const double v = ( _uniform() < 0.5 ? -1 : +1 )
+			* pow( 10.0, 640*_uniform() - 320 );
+		_test( v );
+		_test( _uniform() );
+		_test( round( _uniform()*1e6 )/1e3 ); // ...exact decimal fractions
+	}
+
+	for(long i = -100000; i <= 100000; i += 997 ) {
+		char expect[ 32 ];
+		const char *end = numfmt_int( buf, i );
+		snprintf( expect, sizeof(expect), "%ld", i );
+		if( (size_t)(end - buf) != strlen( expect )
+				|| strncmp( buf, expect, end - buf ) ) {
+			fprintf( stderr, "numfmt_int of %ld: expected \"%s\", got \"%.*s\"\n",
+				i, expect, (int)(end - buf), buf );
+			_failures += 1;
+		}
+	}
+
+	printf( "%d failures\n", _failures );
+	return _failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
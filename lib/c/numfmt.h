@@ -0,0 +1,70 @@
+
+#ifndef __numfmt_h__
+#define __numfmt_h__
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocation-free formatting of numbers directly into a caller's buffer,
+ * producing exactly what printf (in the C locale) would for the handful
+ * of conversions below. Digits are generated from a scaled integer;
+ * values whose rounding that cannot decide with certainty (near-ties,
+ * non-finite and extreme magnitudes) are delegated to snprintf, so the
+ * output never differs.
+ *
+ * Each function writes no terminating NUL and returns a pointer just
+ * past the last character written. The buffer must have room for
+ * NUMFMT_MAXLEN characters.
+ */
+
+#define NUMFMT_MAXLEN (330) // ...for "%+.9f" of DBL_MAX
+
+/**
+ * Largest supported precision (digits after the decimal point).
+ */
+#define NUMFMT_MAXPREC (9)
+
+/**
+ * "%d" and friends.
+ */
+char *numfmt_int( char *buf, long v );
+
+/**
+ * "%.<prec>e", or "%+.<prec>e" if plus.
+ */
+char *numfmt_exp( char *buf, double v, int prec, bool plus );
+
+/**
+ * "%.<prec>f", or "%+.<prec>f" if plus.
+ */
+char *numfmt_fixed( char *buf, double v, int prec, bool plus );
+
+/**
+ * A parsed printf conversion of a single double.
+ */
+struct numfmt_spec {
+	char conv;  // 'e', 'f' or 0 if not supported by numfmt_double
+	bool plus;
+	int  prec;
+};
+
+/**
+ * Parses printf_format, which must consist of nothing but a single
+ * conversion of a double. Only "%[+].<prec>{e|f}" (with prec no greater
+ * than NUMFMT_MAXPREC) is supported; for anything else spec->conv is 0
+ * and the caller should use printf.
+ */
+void numfmt_parse( const char *printf_format, struct numfmt_spec *spec );
+
+char *numfmt_double( char *buf, double v, const struct numfmt_spec *spec );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -6,28 +6,14 @@
 #include <errno.h>
 #include <assert.h>
 
+#include "rsort.h"
 #include "rank.h"
 
-typedef struct {
-	uint32_t off;
-	union {
-		float    fval;
-		uint32_t ival;
-	} u;
-} pair_t;
-
-typedef const pair_t PAIR_T;
-
-static int _cmp_pairs( const void *pvl, const void *pvr ) {
-
-	PAIR_T *l = (PAIR_T*)pvl;
-	PAIR_T *r = (PAIR_T*)pvr;
-	if( l->u.fval == r->u.fval ) {
-		return 0;
-	} else
-		return l->u.fval < r->u.fval ? -1 : +1;
-}
-
+/**
+ * The workspace is an array of 2N pairs: the values being ranked (with
+ * their offsets) followed by the scratch space the sort requires.
+ */
+typedef struct rsort_pair pair_t;
 
 #ifdef RANK_EMIT_STDERR_WARNINGS
 static const char *DEGEN_WARNING 
@@ -50,7 +36,7 @@ static void _strided_copy( const void *dst, size_t dstride, void *src, size_t ss
 
 void *rank_alloc( int n ) {
 	assert( n > 0 );
-	return calloc( n, sizeof(pair_t) );
+	return calloc( 2*n, sizeof(pair_t) );
 }
 
 void rank_free( void *p ) {
@@ -73,14 +59,14 @@ int rank_floats( float *base, const unsigned int N, int normalize, void *workspa
 	int status = 0;
 
 	for(i = 0; i < N; i++ ) {
-		buf[i].off = i;
-		buf[i].u.fval = *pf++;
+		buf[i].value = i;
+		buf[i].key = *pf++;
 	}
 
 	// Sort to determine ranks, and simultaneously check for existance of
 	// ties. Absence of ties saves significant work in the sequel.
 	
-	qsort( buf, N, sizeof(pair_t), _cmp_pairs );
+	rsort_pairs( buf, N, buf + N );
 
 	// We're now done with the -original- floating point values that
 	// reside in the pair_t's of buf, so we OVERWRITE those values
@@ -96,7 +82,7 @@ int rank_floats( float *base, const unsigned int N, int normalize, void *workspa
 			
 			until = i + 1;
 			while( until < N 
-					&& ( buf[i].u.fval == buf[until].u.fval ) ) {
+					&& ( buf[i].key == buf[until].key ) ) {
 				status |= RANK_STATUS_TIES;
 				until++;
 			}
@@ -120,7 +106,7 @@ int rank_floats( float *base, const unsigned int N, int normalize, void *workspa
 			// then rank == i+1, the trivial (and usual) case.
 		}
 
-		base[ buf[i].off ] = rank / NORMALIZER;
+		base[ buf[i].value ] = rank / NORMALIZER;
 	}
 
 	return status;
@@ -145,15 +131,15 @@ int rank_floats_strided( float *base, const unsigned int N, int stride, int norm
 	assert( stride > 0 );
 
 	for(i = 0; i < N; i++ ) {
-		buf[i].off = i;
-		buf[i].u.fval = *pf;
+		buf[i].value = i;
+		buf[i].key = *pf;
 		pf += stride;
 	}
 
 	// Sort to determine ranks, and simultaneously check for existance of
 	// ties. Absence of ties saves significant work in the sequel.
 	
-	qsort( buf, N, sizeof(pair_t), _cmp_pairs );
+	rsort_pairs( buf, N, buf + N );
 
 	// We're now done with the -original- floating point values that
 	// reside in the pair_t's of buf, so we OVERWRITE those values
@@ -169,7 +155,7 @@ int rank_floats_strided( float *base, const unsigned int N, int stride, int norm
 			
 			until = i + 1;
 			while( until < N 
-					&& ( buf[i].u.fval == buf[until].u.fval ) ) {
+					&& ( buf[i].key == buf[until].key ) ) {
 				status |= RANK_STATUS_TIES;
 				until++;
 			}
@@ -193,13 +179,103 @@ int rank_floats_strided( float *base, const unsigned int N, int stride, int norm
 			// then rank == i+1, the trivial (and usual) case.
 		}
 
-		base[ stride*(buf[i].off) ] = rank / NORMALIZER;
+		base[ stride*(buf[i].value) ] = rank / NORMALIZER;
 	}
 
 	return status;
 }
 
 
+/**
+ * Fills order with the offsets of the non-NaN values in base[0..N) in
+ * ascending order of value (the relative order of ties is unspecified)
+ * and returns their count. This is the "sample order" of a row, from
+ * which rank_floats_masked produces the ranks of any subset of it.
+ */
+unsigned int rank_order_floats( const float *base, const unsigned int N, unsigned int *order, void *workspace ) {
+
+	pair_t *buf = (pair_t*)workspace;
+	unsigned int i, n = 0;
+
+	for(i = 0; i < N; i++ ) {
+		if( base[i] == base[i] ) { // ...i.e. not NaN
+			buf[n].value = i;
+			buf[n].key = base[i];
+			n++;
+		}
+	}
+
+	rsort_pairs( buf, n, buf + N );
+
+	for(i = 0; i < n; i++ )
+		order[i] = buf[i].value;
+	return n;
+}
+
+
+/**
+ * Ranks a subset of the values of base given their sample order (as
+ * produced by rank_order_floats) in a single linear walk; no sorting.
+ *
+ * Value base[i] is in the subset iff position[i] >= 0, in which case its
+ * rank is stored in out[ position[i] ]. Ties are averaged exactly as in
+ * rank_floats, so the result is identical to copying the subset into out
+ * in position order and calling rank_floats on it.
+ */
+int rank_floats_masked( const float *base,
+		const unsigned int *order, const unsigned int N,
+		const int *position,
+		float *out ) {
+
+	unsigned int i, k = 0, first = 0;
+	unsigned int run = 0; // ...index in order at which current tie run began
+	int status = 0;
+	float prior = 0.0;
+
+	// k counts subset members seen so far; [first,k) are the subset
+	// ranks of the current run of ties. When a run closes its members
+	// are found again by re-walking order from run, so every element
+	// of order is visited at most twice.
+
+	for(i = 0; i <= N; i++ ) {
+
+		const int P = i < N ? position[ order[i] ] : 0;
+
+		if( i < N && P < 0 )
+			continue;
+
+		if( i == N || k == 0 || base[ order[i] ] != prior ) {
+
+			// Close the run [first,k) of tied subset members that
+			// began at order index run.
+
+			if( k > first ) {
+				const float RANK
+					= (1.0+first) + ((k-first)-1)/2.0;
+				if( k - first > 1 )
+					status |= RANK_STATUS_TIES;
+				for(unsigned int j = run; j < i; j++ ) {
+					const int Q = position[ order[j] ];
+					if( Q >= 0 )
+						out[ Q ] = RANK;
+				}
+			}
+			if( i == N )
+				break;
+			first = k;
+			run   = i;
+			prior = base[ order[i] ];
+		}
+		k++;
+	}
+
+	if( k > 0 && first == 0 )
+		status |= RANK_STATUS_CONST;
+
+	return status;
+}
+
+
 #ifdef AUTOUNIT_TEST_RANK
 
 #include <stdio.h>
@@ -326,5 +402,71 @@ int main( int argc, char *argv[] ) {
 	return EXIT_SUCCESS;
 }
 
+#elif defined(AUTOUNIT_TEST_RANK_MASKED)
+
+/**
+ * Verifies that rank_floats_masked reproduces rank_floats on random
+ * subsets of random, tie-rich vectors containing NaNs:
+ * aut_rank_masked [ <length> [ <max value> [ <trials> ] ] ]
+ */
+
+#include <string.h>
+#include <math.h>
+
+int main( int argc, char *argv[] ) {
+
+	const int N
+		= argc > 1 ? atoi(argv[1]) : 100;
+	const int MAX
+		= argc > 2 ? atoi(argv[2]) : 20;
+	const int TRIALS
+		= argc > 3 ? atoi(argv[3]) : 1000;
+	float *values  = calloc( N, sizeof(float) );
+	float *subset  = calloc( N, sizeof(float) );
+	float *masked  = calloc( N, sizeof(float) );
+	unsigned int *order = calloc( N, sizeof(unsigned int) );
+	int *position  = calloc( N, sizeof(int) );
+	void *workspace = rank_alloc( N );
+	int t, failures = 0;
+
+	for(t = 0; t < TRIALS; t++ ) {
+
+		unsigned int count;
+		int i, n, s1, s2;
+
+		for(i = 0; i < N; i++ )
+			values[i] = rand() % 10 == 0 ? NAN : (float)(rand() % (MAX+1));
+
+		count = rank_order_floats( values, N, order, workspace );
+
+		for(n = 0, i = 0; i < N; i++ ) {
+			if( isnan(values[i]) || rand() % 3 == 0 )
+				position[i] = -1;
+			else {
+				subset[n] = values[i];
+				position[i] = n++;
+			}
+		}
+
+		s1 = n > 0 ? rank_floats( subset, n, 0, workspace ) : 0;
+		s2 = rank_floats_masked( values, order, count, position, masked );
+
+		if( s1 != s2 || memcmp( subset, masked, n*sizeof(float) ) ) {
+			fprintf( stdout, "trial %d: mismatch (status %d != %d)\n", t, s2, s1 );
+			failures += 1;
+		}
+	}
+	fprintf( stdout, "%d failures\n", failures );
+
+	rank_free( workspace );
+	free( position );
+	free( order );
+	free( masked );
+	free( subset );
+	free( values );
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 #endif
 
@@ -17,6 +17,9 @@ int   rank_floats( float *base, const unsigned int N, int normalize, void *buf )
 int   rank_floats_strided( float *base, const unsigned int N, int stride, int normalize, void *buf );
 void  rank_free( void * );
 
+unsigned int rank_order_floats( const float *base, const unsigned int N, unsigned int *order, void *buf );
+int   rank_floats_masked( const float *base, const unsigned int *order, const unsigned int N, const int *position, float *out );
+
 #ifdef __cplusplus
 }
 #endif
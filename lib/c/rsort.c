@@ -0,0 +1,246 @@
+
+/**
+ * LSD radix sort of (float, uint32) pairs.
+ *
+ * Floats are mapped to unsigned integers that order the same way: flip
+ * all bits of negatives, and only the sign bit of non-negatives. The
+ * integers are then sorted 11 bits at a time in 3 stable counting
+ * passes, all of whose histograms are built in a single initial pass.
+ * Passes in which every key has the same digit (e.g. the high bits of
+ * values of similar magnitude) are skipped.
+ *
+ * Below INSERTION_MAX elements insertion sort is faster.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rsort.h"
+
+#define DIGIT_BITS (11)
+#define RADIX (1<<DIGIT_BITS)
+#define PASSES (3) // ...ceil(32/DIGIT_BITS)
+
+#define INSERTION_MAX (48)
+
+/**
+  * Keys are encoded in place during sorting; these access the bits of a
+  * key without ever loading them as a float.
+  */
+static inline uint32_t _get( const struct rsort_pair *p ) {
+	uint32_t u;
+	memcpy( &u, &p->key, sizeof(u) );
+	return u;
+}
+
+static inline void _set( struct rsort_pair *p, uint32_t u ) {
+	memcpy( &p->key, &u, sizeof(u) );
+}
+
+
+static inline uint32_t _encode( uint32_t u ) {
+	if( u == 0x80000000U ) u = 0; // ...so that -0.0 == +0.0
+	return u & 0x80000000U ? ~u : u ^ 0x80000000U;
+}
+
+
+static inline uint32_t _decode( uint32_t u ) {
+	return u & 0x80000000U ? u ^ 0x80000000U : ~u;
+}
+
+
+static void _insertion_sort( struct rsort_pair *a, unsigned int n ) {
+
+	for(unsigned int i = 1; i < n; i++ ) {
+		const struct rsort_pair x = a[i];
+		unsigned int j = i;
+		while( j > 0 && x.key < a[j-1].key ) {
+			a[j] = a[j-1];
+			j--;
+		}
+		a[j] = x;
+	}
+}
+
+
+void *rsort_alloc( unsigned int n ) {
+	return calloc( n > 0 ? n : 1, sizeof(struct rsort_pair) );
+}
+
+
+void rsort_free( void *p ) {
+	if( p ) free( p );
+}
+
+
+void rsort_pairs( struct rsort_pair *a, unsigned int n, void *scratch ) {
+
+	uint32_t count[ PASSES ][ RADIX ];
+	struct rsort_pair *src = a;
+	struct rsort_pair *dst = (struct rsort_pair *)scratch;
+	unsigned int i;
+	int p;
+
+	if( n <= INSERTION_MAX ) {
+		// NaNs would confuse insertion sort's comparisons; they are
+		// rare enough not to merit more than falling through to the
+		// general case.
+		for(i = 0; i < n; i++ ) {
+			if( a[i].key != a[i].key )
+				break;
+		}
+		if( i == n ) {
+			_insertion_sort( a, n );
+			return;
+		}
+	}
+
+	// Encode keys in place and build all histograms at once.
+
+	memset( count, 0, sizeof(count) );
+	for(i = 0; i < n; i++ ) {
+		const uint32_t U = _encode( _get( a+i ) );
+		_set( a+i, U );
+		count[0][ U & (RADIX-1) ]++;
+		count[1][ (U >> DIGIT_BITS) & (RADIX-1) ]++;
+		count[2][ U >> (2*DIGIT_BITS) ]++;
+	}
+
+	for(p = 0; p < PASSES; p++ ) {
+
+		const int SHIFT = p*DIGIT_BITS;
+		uint32_t *c = count[p];
+		uint32_t sum = 0;
+
+		// Skip passes that would not change the order.
+
+		if( c[ (_get( src ) >> SHIFT) & (RADIX-1) ] == n )
+			continue;
+
+		// Histogram -> starting offsets
+
+		for(i = 0; i < RADIX; i++ ) {
+			const uint32_t t = c[i];
+			c[i] = sum;
+			sum += t;
+		}
+
+		for(i = 0; i < n; i++ ) {
+			const uint32_t D = (_get( src+i ) >> SHIFT) & (RADIX-1);
+			memcpy( dst + c[D]++, src + i, sizeof(struct rsort_pair) );
+		}
+
+		// Swap roles of buffers.
+		{
+			struct rsort_pair *t = src;
+			src = dst;
+			dst = t;
+		}
+	}
+
+	// Decode keys, landing the result in a if it isn't already there.
+
+	for(i = 0; i < n; i++ ) {
+		a[i].value = src[i].value;
+		_set( a+i, _decode( _get( src+i ) ) );
+	}
+}
+
+
+#ifdef _BENCHMARK_RSORT_
+
+/**
+ * Compares rsort_pairs against qsort of the same pairs (comparing their
+ * keys directly) on random keys with ties at each of the given lengths,
+ * verifying the results agree:
+ * bench_rsort [ <repetitions> [ <length> ... ] ]
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+static int _cmp_pairs( const void *pvl, const void *pvr ) {
+	const struct rsort_pair *l = (const struct rsort_pair *)pvl;
+	const struct rsort_pair *r = (const struct rsort_pair *)pvr;
+	if( l->key == r->key )
+		return 0;
+	else
+		return l->key < r->key ? -1 : +1;
+}
+
+
+static double _now( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+
+static int _bench( unsigned int n, int reps ) {
+
+	struct rsort_pair *data = calloc( n, sizeof(struct rsort_pair) );
+	struct rsort_pair *q    = calloc( n, sizeof(struct rsort_pair) );
+	struct rsort_pair *r    = calloc( n, sizeof(struct rsort_pair) );
+	void *scratch = rsort_alloc( n );
+	double tq = 0.0, tr = 0.0, t0;
+	unsigned int i;
+	int k, failures = 0;
+
+	for(k = 0; k < reps; k++ ) {
+
+		for(i = 0; i < n; i++ ) {
+			// Roughly half the values are rounded to produce ties.
+			const float x = (float)rand() / RAND_MAX * 200.0f - 100.0f;
+			data[i].key   = rand() % 2 ? x : (float)(int)x;
+			data[i].value = i;
+		}
+		memcpy( q, data, n*sizeof(struct rsort_pair) );
+		memcpy( r, data, n*sizeof(struct rsort_pair) );
+
+		t0 = _now();
+		qsort( q, n, sizeof(struct rsort_pair), _cmp_pairs );
+		tq += _now() - t0;
+
+		t0 = _now();
+		rsort_pairs( r, n, scratch );
+		tr += _now() - t0;
+
+		for(i = 0; i < n; i++ ) {
+			if( q[i].key != r[i].key ) {
+				failures++;
+				break;
+			}
+		}
+	}
+
+	printf( "%6u\t%10.2f\t%10.2f\t%6.2f\t%s\n", n,
+		1e6*tq/reps, 1e6*tr/reps, tq/tr, failures ? "FAILED" : "ok" );
+
+	rsort_free( scratch );
+	free( r );
+	free( q );
+	free( data );
+	return failures;
+}
+
+
+int main( int argc, char *argv[] ) {
+
+	static const unsigned int DEFAULT_N[] = { 10, 100, 500, 1000, 2000, 5000, 10000 };
+	const int REPS = argc > 1 ? atoi( argv[1] ) : 200;
+	int failures = 0;
+
+	printf( "#N\tqsort(us)\trsort(us)\tspeedup\n" );
+	if( argc > 2 ) {
+		for(int i = 2; i < argc; i++ )
+			failures += _bench( atoi( argv[i] ), REPS );
+	} else {
+		for(size_t i = 0; i < sizeof(DEFAULT_N)/sizeof(DEFAULT_N[0]); i++ )
+			failures += _bench( DEFAULT_N[i], REPS );
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
+
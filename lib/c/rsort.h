@@ -0,0 +1,40 @@
+
+#ifndef __rsort_h__
+#define __rsort_h__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A float sort key with an arbitrary 32-bit payload (typically the
+ * original offset of the key or a category label).
+ */
+struct rsort_pair {
+	float    key;
+	uint32_t value;
+};
+
+/**
+ * Scratch space sufficient to sort up to n pairs.
+ */
+void *rsort_alloc( unsigned int n );
+void  rsort_free( void * );
+
+/**
+ * Sorts a[0..n) in ascending order of key, stably. Keys compare as
+ * floats do (so -0.0 and +0.0 are ties, and either may be returned as
+ * +0.0). NaNs, which have no place in such an order, end up at one end
+ * or the other. For non-NaN keys the result is that of qsort with a
+ * comparator on key alone, up to the order of equal keys.
+ */
+void  rsort_pairs( struct rsort_pair *a, unsigned int n, void *scratch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -21,6 +21,9 @@
   */
 void mtm_free_matrix( struct mtm_matrix *m ) {
 	if( m ) {
+		if( m->present )
+			free( m->present );
+		m->present = NULL;
 		if( m->storage )
 			free( m->storage );
 		m->storage = NULL;
@@ -28,6 +31,28 @@ void mtm_free_matrix( struct mtm_matrix *m ) {
 }
 
 
+/**
+  * Presence bitmaps are derived, not stored in the file, so they are
+  * built here. Failure is not fatal; see mtmatrix.h.
+  */
+static void _build_present_bitmaps( struct mtm_matrix *m ) {
+
+	m->present_words = MTM_BITMAP_WORDS( m->columns );
+	m->present
+		= malloc( (size_t)m->rows * m->present_words * sizeof(mtm_bitmap_t) );
+
+	if( m->present ) {
+		for(int r = 0; r < m->rows; r++ ) {
+			mtm_present_bitmap(
+				m->data + r*m->columns,
+				m->columns,
+				m->desc[r].integral,
+				m->present + r*m->present_words );
+		}
+	}
+}
+
+
 int mtm_load_header( FILE *fp, struct mtm_matrix_header *header ) {
 
 	if( header == NULL || fp == NULL )
@@ -55,6 +80,9 @@ int mtm_load_matrix( FILE *fp, struct mtm_matrix *matrix, struct mtm_matrix_head
 	if( matrix == NULL )
 		return MTM_E_NULLPTR;
 
+	matrix->present       = NULL;
+	matrix->present_words = 0;
+
 	if( header == NULL )
 		header = alloca( sizeof(struct mtm_matrix_header) );
 
@@ -121,6 +149,8 @@ int mtm_load_matrix( FILE *fp, struct mtm_matrix *matrix, struct mtm_matrix_head
 	if( matrix->row_id != NULL && matrix->row_map != NULL )
 		mtm_resolve_rownames( matrix, (signed long)matrix->row_id );
 
+	_build_present_bitmaps( matrix );
+
 	matrix->lexigraphic_order
 		= ((header->flags & MTMHDR_ROW_LABELS_LEXORD) != 0);
 
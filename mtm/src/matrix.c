@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
 #include <assert.h>
 
 #include "mtmatrix.h"
@@ -97,6 +98,24 @@ static bool _sorted_by_row_offset( MTM_ROW_ID_T *map, int n ) {
 
 #endif
 
+void mtm_present_bitmap( MTM_ROW_PTR row, int columns, bool integral, mtm_bitmap_t *bitmap ) {
+
+	memset( bitmap, 0, MTM_BITMAP_WORDS(columns)*sizeof(mtm_bitmap_t) );
+
+	if( integral ) {
+		for(int i = 0; i < columns; i++ ) {
+			if( row[i] != NAN_AS_UINT )
+				bitmap[ i/64 ] |= ((mtm_bitmap_t)1) << (i%64);
+		}
+	} else {
+		for(int i = 0; i < columns; i++ ) {
+			if( ! isnan( ((const mtm_fp_t*)row)[i] ) )
+				bitmap[ i/64 ] |= ((mtm_bitmap_t)1) << (i%64);
+		}
+	}
+}
+
+
 /**
   * mtm_fetch_by_name and mtm_fetch_by_offset are essentially convenience 
   * functions. They gather into the struct mtm_feature all the (scattered)
@@ -125,6 +144,8 @@ int  mtm_fetch_by_name( struct mtm_matrix *m, struct mtm_feature *f ) {
 		f->offset = ROW;
 		f->desc   = m->desc[ ROW ];
 		f->data   = m->data + ROW*m->columns;
+		f->present
+			= m->present ? m->present + ROW*m->present_words : NULL;
 		return 0;
 	}
 	return MTM_E_NO_SUCH_FEATURE;
@@ -146,6 +167,8 @@ int  mtm_fetch_by_offset( struct mtm_matrix *m, struct mtm_feature *f ) {
 		f->name = m->row_map ? m->row_map[ ROW ].string : NULL;
 		f->desc = m->desc[ ROW ];
 		f->data = m->data + ROW*m->columns;
+		f->present
+			= m->present ? m->present + ROW*m->present_words : NULL;
 		return 0;
 	}
 	return MTM_E_NO_SUCH_FEATURE;
@@ -26,6 +26,8 @@
   * how it is sorted.
   */
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -143,6 +145,17 @@ typedef mtm_descriptor_t *mtm_descriptor_ptr;
 
 #define MTM_MAX_MISSING_VALUES (65535)
 
+/**
+  * Rows' missing data is also summarized in packed bitmaps in which bit
+  * (i % 64) of word (i / 64) is set iff column i is present (NOT "NA").
+  * Bits beyond the last column are always clear, so the number of
+  * samples two rows have in common is the population count of the
+  * bitwise AND of their bitmaps.
+  */
+typedef uint64_t mtm_bitmap_t;
+
+#define MTM_BITMAP_WORDS(columns) (((columns)+63)/64)
+
 ////////////////////////////////////////////////////////////////////////////
 
 struct mtm_row {
@@ -222,6 +235,15 @@ struct mtm_matrix {
 	  * struct containing a file handle, offset, and length info.
 	  */
 	void *storage;
+
+	/**
+	  * Presence bitmaps (see mtm_bitmap_t) of all rows, built when the
+	  * matrix is loaded. Row r's bitmap begins at present + r*present_words.
+	  * This may be NULL (if allocation failed), so consumers must be
+	  * prepared to work without it.
+	  */
+	mtm_bitmap_t *present;
+	int present_words;
 };
 
 void mtm_resolve_rownames( struct mtm_matrix *m, signed long base );
@@ -263,8 +285,18 @@ struct mtm_feature {
 	const char           *name;
 	struct mtm_descriptor desc;
 	MTM_ROW_PTR           data;
+	/**
+	  * The row's presence bitmap or NULL if not available.
+	  */
+	const mtm_bitmap_t   *present;
 };
 
+/**
+  * Fill the MTM_BITMAP_WORDS(columns) words at bitmap with the presence
+  * bitmap of the given row data.
+  */
+void mtm_present_bitmap( MTM_ROW_PTR row, int columns, bool integral, mtm_bitmap_t *bitmap );
+
 int  mtm_fetch_by_name( struct mtm_matrix *m, struct mtm_feature *f );
 int  mtm_fetch_by_offset( struct mtm_matrix *m, struct mtm_feature *f );
 const char *mtm_sclass_name( unsigned int );
@@ -152,6 +152,14 @@ static int _merge_tmpfiles(
 			_pad_to_pagesize( fp );
 			section[ i ].offset = ftell( fp );
 
+			// The padding (and the data before it) may still be buffered
+			// in fp, but _sendfile writes to the descriptor.
+
+			if( fflush( fp ) ) {
+				warn( "%s:%d:%s: fflush", __FILE__, __LINE__, __func__ );
+				return MTM_E_IO;
+			}
+
 			if( _sendfile(
 				fileno( fp ),
 				fileno( section_fp[i] ),
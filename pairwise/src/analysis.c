@@ -6,9 +6,9 @@
  * 3) continuous, categorical 
  * 4) categorical, categorical
  *
- * Importantly (for performance) each (statically-allocated) class 
- * pre-allocates all the buffer space it will require. And nothing
- * is freed until process exit.
+ * Importantly (for performance) each class instance, all of which are
+ * owned by a covan_ctx_t, pre-allocates all the buffer space it will
+ * require. And nothing is freed until the context is destroyed.
  * 
  * Re: performance, it may appear wasteful that I'm actually copying
  * values from the input arrays *into* the class instances; it's
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
@@ -43,76 +44,585 @@
 #include "args.h"
 #include "mtsclass.h"
 #include "limits.h"
+#include "rowcache.h"
+#include "corblock.h"
+#include "telemetry.h"
 
 
 /**
-  * Most arrays are pre-allocated and sized according to this variable.
+  * The waste tests of a continuous row depend only on the row and on which
+  * of its partner's values are missing, and many partners (e.g. rows from
+  * the same platform) share NA patterns. So waste results are cached in a
+  * direct-mapped table keyed by the row and a hash of its partner's
+  * presence bitmap. Hits are verified against a copy of that bitmap.
   */
-static int max_sample_count = 0;
+struct WasteEntry {
+	int row; // ...or -1 if the slot is empty
+	uint64_t hash;
+	signed unused;
+	struct Statistic result;
+};
 
 /**
- * These classes handle the actual feature1 vs feature2 analyses.
- */
-static void *_caccum = NULL;
-static void *_maccum = NULL;
-static void *_naccum = NULL;
+  * Bound on the memory spent on copies of bitmaps in the waste cache.
+  */
+#define WASTE_CACHE_MASK_BYTES (32*1024*1024)
+
 
 /**
- * These classes handle comparisons between the two groups WITHIN a
- * single feature distinguished according to whether the corresponding
- * covariate (in the other feature) is present (not "NA"). In continuous/
- * continuous comparisons are both used, in continuous/categorical
- * comparisons one or the other is used, and in cat/cat neither is used.
- *
- * Notice that in general counts by category in categorical/continuous
- * pairs are generally unavailable with one exception: the category 0's
- * count is always output by the Kruskal-Wallis test. This is motivated
- * primarily by the application defined above. As a result, it is 
- * ESSENTIAL THAT SAMPLES PRESENT IN FEAT1 BUT MISSING IN FEAT2 ARE
- * TAGGED WITH 0 IN _Lwaste (vica versa for 2).
- */
-static void *_Lwaste = NULL;
-static void *_Rwaste = NULL;
+  * All working memory required by covariate analysis. Nothing in here is
+  * shared between contexts, so distinct contexts may be used concurrently.
+  */
+struct CovariateAnalysisContext {
+
+	/**
+	  * Most arrays are pre-allocated and sized according to this variable.
+	  */
+	int max_sample_count;
+
+	/**
+	 * These classes handle the actual feature1 vs feature2 analyses.
+	 */
+	void *caccum;
+	void *maccum;
+	void *naccum;
+
+	/**
+	 * These classes handle comparisons between the two groups WITHIN a
+	 * single feature distinguished according to whether the corresponding
+	 * covariate (in the other feature) is present (not "NA"). In continuous/
+	 * continuous comparisons are both used, in continuous/categorical
+	 * comparisons one or the other is used, and in cat/cat neither is used.
+	 *
+	 * Notice that in general counts by category in categorical/continuous
+	 * pairs are generally unavailable with one exception: the category 0's
+	 * count is always output by the Kruskal-Wallis test. This is motivated
+	 * primarily by the application defined above. As a result, it is 
+	 * ESSENTIAL THAT SAMPLES PRESENT IN FEAT1 BUT MISSING IN FEAT2 ARE
+	 * TAGGED WITH 0 IN Lwaste (vica versa for 2).
+	 */
+	void *Lwaste;
+	void *Rwaste;
+
+	/**
+	  * Set by covan_ctx_set_threshold; 0 when p-values are exact.
+	  */
+	double threshold;
+
+	/**
+	  * Optional, shared, read-only per-row precomputations.
+	  */
+	const struct RowCache *cache;
+
+	/**
+	  * Set by covan_ctx_set_telemetry; NULL when nothing is timed.
+	  */
+	struct telemetry *telemetry;
+
+	/**
+	  * Spearman rho of pairs of complete continuous rows computed in bulk
+	  * by covan_ctx_prefetch: rho[ (l-first)*cache->rows + r ] is valid
+	  * for l in [first,last) and r >= first whenever both rows have
+	  * centered ranks in the cache.
+	  */
+	struct {
+		int first, last;
+		int capacity; // ...left rows
+		double  *rho;
+		int64_t *dot;
+		const int16_t **L, **R;
+		int *lrow, *rrow;
+	} panel;
+
+	/**
+	  * Waste results by row and partner NA pattern (see WasteEntry).
+	  * Allocated along with the row cache; slots is 0 otherwise.
+	  */
+	struct {
+		int slots; // ...a power of 2
+		int words; // ...per bitmap
+		struct WasteEntry *entry;
+		mtm_bitmap_t *mask;
+	} wcache;
+};
+
+/**
+  * The context behind the original (non-reentrant) API.
+  */
+static covan_ctx_t *_default = NULL;
+
+/**
+  * The Spearman rho of two complete rows from the exact dot product of
+  * their centered ranks. All correlations of rows with centered ranks,
+  * in bulk or not, are computed this way so that a pair's result does
+  * not depend on how it was reached.
+  */
+static inline double _centered_rho( int64_t dot,
+		const struct CachedRow *l, const struct CachedRow *r ) {
+	return dot / sqrt( l->centered_ss * r->centered_ss );
+}
+
+
+static void _panel_free( covan_ctx_t *ctx ) {
+
+	if( ctx->panel.rrow ) free( ctx->panel.rrow );
+	if( ctx->panel.lrow ) free( ctx->panel.lrow );
+	if( ctx->panel.R )    free( ctx->panel.R );
+	if( ctx->panel.L )    free( ctx->panel.L );
+	if( ctx->panel.dot )  free( ctx->panel.dot );
+	if( ctx->panel.rho )  free( ctx->panel.rho );
+	memset( &ctx->panel, 0, sizeof(ctx->panel) );
+}
+
+
+static int _panel_reserve( covan_ctx_t *ctx, int capacity ) {
+
+	const int ROWS = ctx->cache->rows;
+
+	if( capacity <= ctx->panel.capacity )
+		return 0;
+
+	_panel_free( ctx );
+
+	ctx->panel.rho  = malloc( capacity * ROWS * sizeof(double) );
+	ctx->panel.dot  = malloc( capacity * ROWS * sizeof(int64_t) );
+	ctx->panel.L    = malloc( capacity * sizeof(int16_t*) );
+	ctx->panel.R    = malloc( ROWS * sizeof(int16_t*) );
+	ctx->panel.lrow = malloc( capacity * sizeof(int) );
+	ctx->panel.rrow = malloc( ROWS * sizeof(int) );
+
+	if( NULL == ctx->panel.rho
+		|| NULL == ctx->panel.dot
+		|| NULL == ctx->panel.L
+		|| NULL == ctx->panel.R
+		|| NULL == ctx->panel.lrow
+		|| NULL == ctx->panel.rrow ) {
+		_panel_free( ctx );
+		return -1;
+	}
+	ctx->panel.capacity = capacity;
+	return 0;
+}
+
+static void _wcache_free( covan_ctx_t *ctx ) {
+
+	if( ctx->wcache.mask )  free( ctx->wcache.mask );
+	if( ctx->wcache.entry ) free( ctx->wcache.entry );
+	memset( &ctx->wcache, 0, sizeof(ctx->wcache) );
+}
+
+
+/**
+  * Sizes the waste cache to about twice the number of rows (since every
+  * row recurs with each distinct NA pattern), within the memory bound.
+  * Failure merely leaves caching disabled.
+  */
+static void _wcache_create( covan_ctx_t *ctx, int rows ) {
+
+	const int WORDS = MTM_BITMAP_WORDS( ctx->max_sample_count );
+	int slots = 1024;
+
+	while( slots < 2*rows
+			&& 2*(size_t)slots*WORDS*sizeof(mtm_bitmap_t) <= WASTE_CACHE_MASK_BYTES )
+		slots *= 2;
+
+	ctx->wcache.entry = malloc( slots * sizeof(struct WasteEntry) );
+	ctx->wcache.mask  = malloc( (size_t)slots * WORDS * sizeof(mtm_bitmap_t) );
+	if( NULL == ctx->wcache.entry || NULL == ctx->wcache.mask ) {
+		_wcache_free( ctx );
+		return;
+	}
+	for(int i = 0; i < slots; i++ )
+		ctx->wcache.entry[i].row = -1;
+	ctx->wcache.slots = slots;
+	ctx->wcache.words = WORDS;
+}
+
+
+static uint64_t _mask_hash( const mtm_bitmap_t *m, int words ) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for(int w = 0; w < words; w++ ) {
+		h = ( h ^ m[w] ) * 0x100000001b3ULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+
+static int _wcache_slot( const covan_ctx_t *ctx, int row, uint64_t hash ) {
+	uint64_t k = hash + (uint64_t)row * 0x9e3779b97f4a7c15ULL;
+	k ^= k >> 32;
+	return (int)( k & (ctx->wcache.slots-1) );
+}
+
+
+/**
+  * Returns whether f's waste against partner can be cached, in which
+  * case *hash is set to the key for partner's NA pattern.
+  */
+static bool _wcache_applies( const covan_ctx_t *ctx,
+		const struct mtm_feature *f,
+		const struct mtm_feature *partner,
+		uint64_t *hash ) {
+
+	const struct CachedRow *c;
+
+	if( ctx->wcache.slots > 0 && partner->present
+			&& ( c = rowcache_lookup( ctx->cache, f ) ) && c->order ) {
+		*hash = _mask_hash( partner->present, ctx->wcache.words );
+		return true;
+	}
+	return false;
+}
+
+
+static const struct WasteEntry *_wcache_find( const covan_ctx_t *ctx,
+		const struct mtm_feature *f,
+		const struct mtm_feature *partner,
+		uint64_t hash ) {
+
+	const int SLOT = _wcache_slot( ctx, f->offset, hash );
+	const struct WasteEntry *e = ctx->wcache.entry + SLOT;
+
+	if( e->row == f->offset && e->hash == hash
+			&& memcmp( ctx->wcache.mask + (size_t)SLOT*ctx->wcache.words,
+				partner->present,
+				ctx->wcache.words*sizeof(mtm_bitmap_t) ) == 0 )
+		return e;
+	return NULL;
+}
+
+
+static void _wcache_store( covan_ctx_t *ctx,
+		const struct mtm_feature *f,
+		const struct mtm_feature *partner,
+		uint64_t hash,
+		signed unused,
+		const struct Statistic *result ) {
+
+	const int SLOT = _wcache_slot( ctx, f->offset, hash );
+	struct WasteEntry *e = ctx->wcache.entry + SLOT;
+
+	e->row    = f->offset;
+	e->hash   = hash;
+	e->unused = unused;
+	e->result = *result;
+	memcpy( ctx->wcache.mask + (size_t)SLOT*ctx->wcache.words,
+		partner->present,
+		ctx->wcache.words*sizeof(mtm_bitmap_t) );
+}
 
 ////////////////////////////////////////////////////////////////////////////
 // Public API
 ////////////////////////////////////////////////////////////////////////////
 
-void covan_fini( void ) {
-
-	if( _Rwaste ) { mix_destroy( _Rwaste ); _Rwaste = NULL; }
-	if( _Lwaste ) { mix_destroy( _Lwaste ); _Lwaste = NULL; }
-	if( _naccum ) { con_destroy( _naccum ); _naccum = NULL; }
-	if( _maccum ) { mix_destroy( _maccum ); _maccum = NULL; }
-	if( _caccum ) { cat_destroy( _caccum ); _caccum = NULL; }
+void covan_ctx_destroy( covan_ctx_t *ctx ) {
+
+	if( ctx ) {
+		_wcache_free( ctx );
+		_panel_free( ctx );
+		if( ctx->Rwaste ) mix_destroy( ctx->Rwaste );
+		if( ctx->Lwaste ) mix_destroy( ctx->Lwaste );
+		if( ctx->naccum ) con_destroy( ctx->naccum );
+		if( ctx->maccum ) mix_destroy( ctx->maccum );
+		if( ctx->caccum ) cat_destroy( ctx->caccum );
+		free( ctx );
+	}
 }
 
 /**
  * This must pre-allocate all the memory we might need for every combination
  * of data types.
  */
-int covan_init( int columns ) {
+covan_ctx_t *covan_ctx_create( int columns ) {
+
+	covan_ctx_t *ctx
+		= calloc( 1, sizeof(covan_ctx_t) );
 
-	max_sample_count = columns; // EVERYTHING depends on this.
+	if( NULL == ctx )
+		return NULL;
 
-	_caccum = cat_create( MAX_CATEGORY_COUNT, MAX_CATEGORY_COUNT );
-	_maccum = mix_create( max_sample_count,   MAX_CATEGORY_COUNT );
-	_naccum = con_create( max_sample_count );
+	ctx->max_sample_count = columns; // EVERYTHING depends on this.
 
-	_Lwaste = mix_create( max_sample_count,   MAX_CATEGORY_COUNT );
-	_Rwaste = mix_create( max_sample_count,   MAX_CATEGORY_COUNT );
+	ctx->caccum = cat_create( MAX_CATEGORY_COUNT, MAX_CATEGORY_COUNT );
+	ctx->maccum = mix_create( columns, MAX_CATEGORY_COUNT );
+	ctx->naccum = con_create( columns );
 
-	cat_setMinCellCount( _caccum, arg_min_cell_count );
+	ctx->Lwaste = mix_create( columns, MAX_CATEGORY_COUNT );
+	ctx->Rwaste = mix_create( columns, MAX_CATEGORY_COUNT );
+
+	if( NULL == ctx->caccum
+		|| NULL == ctx->maccum 
+		|| NULL == ctx->naccum
+		|| NULL == ctx->Lwaste
+		|| NULL == ctx->Rwaste ) {
+		covan_ctx_destroy( ctx );
+		return NULL;
+	}
+
+	cat_setMinCellCount( ctx->caccum, arg_min_cell_count );
+	if( cat_setSampleCapacity( ctx->caccum, columns ) ) {
+		covan_ctx_destroy( ctx );
+		return NULL;
+	}
+
+	return ctx;
+}
+
+
+void covan_ctx_use_rowcache( covan_ctx_t *ctx, const struct RowCache *cache ) {
+	_wcache_free( ctx );
+	_panel_free( ctx );
+	ctx->cache = cache;
+	if( cache )
+		_wcache_create( ctx, cache->rows );
+}
+
+
+void covan_ctx_set_threshold( covan_ctx_t *ctx, double p ) {
+	ctx->threshold = ( 0.0 < p && p < 1.0 ) ? p : 0.0;
+	con_setSignificanceThreshold( ctx->naccum, p );
+	mix_setSignificanceThreshold( ctx->maccum, p );
+	cat_setSignificanceThreshold( ctx->caccum, p );
+}
+
+
+void covan_ctx_set_telemetry( covan_ctx_t *ctx, struct telemetry *tm ) {
+	ctx->telemetry = tm;
+	con_setTelemetry( ctx->naccum, tm );
+	mix_setTelemetry( ctx->maccum, tm );
+	mix_setTelemetry( ctx->Lwaste, tm );
+	mix_setTelemetry( ctx->Rwaste, tm );
+	cat_setTelemetry( ctx->caccum, tm );
+}
+
+
+int covan_ctx_prefetch( covan_ctx_t *ctx, int first, int last ) {
+
+	const struct RowCache *c = ctx->cache;
+	int nl = 0, nr = 0, i, j;
+
+	ctx->panel.first = ctx->panel.last = 0; // ...invalidate
+
+	if( NULL == c || NULL == c->centered_storage )
+		return 0;
+	if( last > c->rows )
+		last = c->rows;
+	if( ! ( first < last ) )
+		return 0;
+	if( _panel_reserve( ctx, last - first ) )
+		return -1;
+
+	for(i = first; i < last; i++ ) {
+		if( c->row[i].centered ) {
+			ctx->panel.L[ nl ]    = c->row[i].centered;
+			ctx->panel.lrow[ nl ] = i;
+			nl += 1;
+		}
+	}
+	if( nl == 0 )
+		return 0;
+
+	for(j = first; j < c->rows; j++ ) {
+		if( c->row[j].centered ) {
+			ctx->panel.R[ nr ]    = c->row[j].centered;
+			ctx->panel.rrow[ nr ] = j;
+			nr += 1;
+		}
+	}
+
+	uint64_t mark = tm_start( ctx->telemetry );
+
+	corblock_dot( ctx->panel.L, nl, ctx->panel.R, nr, c->columns, ctx->panel.dot );
+
+	for(i = 0; i < nl; i++ ) {
+		const struct CachedRow *l = c->row + ctx->panel.lrow[i];
+		double *rho = ctx->panel.rho + ( ctx->panel.lrow[i] - first )*c->rows;
+		const int64_t *dot = ctx->panel.dot + i*nr;
+		for(j = 0; j < nr; j++ ) {
+			const struct CachedRow *r = c->row + ctx->panel.rrow[j];
+			rho[ ctx->panel.rrow[j] ]
+				= _centered_rho( dot[j], l, r );
+		}
+	}
+
+	tm_lap( ctx->telemetry, TM_STATISTIC, &mark );
+
+	ctx->panel.first = first;
+	ctx->panel.last  = last;
+	return 0;
+}
+
+
+void covan_fini( void ) {
+
+	covan_ctx_destroy( _default );
+	_default = NULL;
+}
+
+
+int covan_init( int columns ) {
 
 	// DON'T register covan_fini call here because Python extension
 	// will do explicit covan_fini; executable's main must register 
 	// covan_fini.
 
-	return NULL == _caccum
-		|| NULL == _maccum 
-		|| NULL == _naccum
-		|| NULL == _Lwaste
-		|| NULL == _Rwaste ? -1 : 0;
+	covan_ctx_destroy( _default );
+	_default = covan_ctx_create( columns );
+	return NULL == _default ? -1 : 0;
+}
+
+
+void covan_use_rowcache( const struct RowCache *cache ) {
+	covan_ctx_use_rowcache( _default, cache );
+}
+
+
+int covan_prefetch( int first, int last ) {
+	return covan_ctx_prefetch( _default, first, last );
+}
+
+
+void covan_set_threshold( double p ) {
+	covan_ctx_set_threshold( _default, p );
+}
+
+
+void covan_set_telemetry( struct telemetry *tm ) {
+	covan_ctx_set_telemetry( _default, tm );
+}
+
+
+int covan_exec( 
+		const struct feature_pair *pair,
+		struct CovariateAnalysis *covan ) {
+
+	return covan_ctx_exec( _default, pair, covan );
+}
+
+
+/**
+  * The number of non-missing values in f's row.
+  */
+static unsigned _present_count( const struct mtm_feature *f, int n ) {
+
+	unsigned count = 0;
+
+	if( f->present ) {
+		for(int w = 0; w < MTM_BITMAP_WORDS(n); w++ )
+			count += __builtin_popcountll( f->present[w] );
+	} else
+	if( f->desc.integral ) {
+		for(int i = 0; i < n; i++ )
+			if( NAN_AS_UINT != f->data[i] ) count++;
+	} else {
+		for(int i = 0; i < n; i++ )
+			if( ! isnan( ((const float*)f->data)[i] ) ) count++;
+	}
+	return count;
+}
+
+
+/**
+  * Counts the contingency table of two categorical rows from their
+  * per-category bitsets (see rowcache.h): cell (i,j) is the popcount of
+  * the AND of the left row's i'th and right row's j'th bitsets. The
+  * common 2x2 case is done in a single sweep.
+  */
+static void _push_table_bitsliced( covan_ctx_t *ctx,
+		const mtm_bitmap_t *L, unsigned int LC,
+		const mtm_bitmap_t *R, unsigned int RC ) {
+
+	const int W = ctx->cache->words;
+
+	if( LC == 2 && RC == 2 ) {
+		const mtm_bitmap_t *L0 = L, *L1 = L + W;
+		const mtm_bitmap_t *R0 = R, *R1 = R + W;
+		unsigned int n00 = 0, n01 = 0, n10 = 0, n11 = 0;
+		for(int w = 0; w < W; w++ ) {
+			n00 += __builtin_popcountll( L0[w] & R0[w] );
+			n01 += __builtin_popcountll( L0[w] & R1[w] );
+			n10 += __builtin_popcountll( L1[w] & R0[w] );
+			n11 += __builtin_popcountll( L1[w] & R1[w] );
+		}
+		cat_push_count( ctx->caccum, 0, 0, n00 );
+		cat_push_count( ctx->caccum, 0, 1, n01 );
+		cat_push_count( ctx->caccum, 1, 0, n10 );
+		cat_push_count( ctx->caccum, 1, 1, n11 );
+		return;
+	}
+
+	for(unsigned int i = 0; i < LC; i++ ) {
+		for(unsigned int j = 0; j < RC; j++ ) {
+			const mtm_bitmap_t *Li = L + i*W;
+			const mtm_bitmap_t *Rj = R + j*W;
+			unsigned int n = 0;
+			for(int w = 0; w < W; w++ )
+				n += __builtin_popcountll( Li[w] & Rj[w] );
+			cat_push_count( ctx->caccum, i, j, n );
+		}
+	}
+}
+
+
+/**
+  * Accumulates a continuous row's waste by walking its cached sample
+  * order so that the waste is ranked without sorting (see mix_push).
+  * Returns the number of present values whose (continuous) partner is
+  * missing.
+  */
+static unsigned _push_waste_presorted( void *waste,
+		const struct mtm_feature *f,
+		const struct mtm_feature *partner,
+		const struct CachedRow *fc ) {
+
+	unsigned unused = 0;
+
+	for(unsigned k = 0; k < fc->order_count; k++ ) {
+		const unsigned int i = fc->order[k];
+		const bool COMMON = ! isnan( ((const float*)partner->data)[i] );
+		mix_push( waste, ((const float*)f->data)[i], COMMON ? 1 : 0 );
+		if( ! COMMON )
+			unused++;
+	}
+	return unused;
+}
+
+
+/**
+  * Accumulates a categorical-continuous pair by walking the continuous
+  * row's cached sample order, so that both the covariate and the waste
+  * accumulators receive samples already sorted and rank them without
+  * sorting (see mix_push). Returns the number of present continuous
+  * values whose categorical partner is missing. waste may be NULL if
+  * the waste result is already known.
+  */
+static unsigned _push_mixed_presorted( covan_ctx_t *ctx,
+		const struct mtm_feature *cat,
+		const struct mtm_feature *con,
+		const struct CachedRow *cc,
+		void *waste ) {
+
+	unsigned unused = 0;
+
+	for(unsigned k = 0; k < cc->order_count; k++ ) {
+
+		const unsigned int i
+			= cc->order[k];
+		const float F
+			= ((const float*)con->data)[i];
+		const unsigned int C
+			= cat->data[i];
+
+		if( NAN_AS_UINT != C ) {
+			mix_push( ctx->maccum, F, C );
+			if( waste ) mix_push( waste, F, 1 );
+		} else {
+			if( waste ) mix_push( waste, F, 0 );
+			unused++;
+		}
+	}
+	return unused;
 }
 
 
@@ -145,7 +655,8 @@ int covan_init( int columns ) {
  * 5. An "auxiliary" Spearman rho is always computed unless one of 
  *    covariates is categorical with > 2 categories.
  */
-int covan_exec( 
+int covan_ctx_exec( 
+		covan_ctx_t *ctx,
 		const struct feature_pair *pair,
 		struct CovariateAnalysis *covan ) {
 
@@ -158,6 +669,10 @@ int covan_exec(
 	unsigned unused2 = 0;
 	unsigned count   = 0;
 
+	// Everything preceding a test is filtering (see telemetry.h).
+
+	uint64_t mark = tm_start( ctx->telemetry );
+
 	/**
 	  * Insure all string args are initialized to -something- so that 
 	  * emitters need be slowed by pervasive NULL checks...
@@ -172,9 +687,10 @@ int covan_exec(
 	strcpy( covan->result.log, "-" );
 
 	// Because we don't anticipate ordinal features yet...
+	// (Empty categorical rows have no categories, but they are constant.)
 
-	assert( (pair->l.desc.integral > 0) == (LC > 0) );
-	assert( (pair->r.desc.integral > 0) == (RC > 0) );
+	assert( (pair->l.desc.integral > 0) == (LC > 0) || pair->l.desc.constant );
+	assert( (pair->r.desc.integral > 0) == (RC > 0) || pair->r.desc.constant );
 
 	covan->stat_class.left
 		= pair->l.desc.categorical
@@ -199,11 +715,47 @@ int covan_exec(
 		return -1;
 	}
 
+	/**
+	  * When both rows carry presence bitmaps the exact number of samples
+	  * they have in common is available without touching the data. Pairs
+	  * that cannot possibly satisfy the minimum sample size are rejected
+	  * here; only the waste counts are reported for them.
+	  */
+	if( pair->l.present && pair->r.present ) {
+		const mtm_bitmap_t *L = pair->l.present;
+		const mtm_bitmap_t *R = pair->r.present;
+		const int W = MTM_BITMAP_WORDS( ctx->max_sample_count );
+		unsigned both = 0;
+		for(int w = 0; w < W; w++ )
+			both += __builtin_popcountll( L[w] & R[w] );
+		if( both < arg_min_sample_count ) {
+			for(int w = 0; w < W; w++ ) {
+				unused1 += __builtin_popcountll( L[w] & ~R[w] );
+				unused2 += __builtin_popcountll( R[w] & ~L[w] );
+			}
+			covan->waste[0].unused = unused1;
+			covan->waste[1].unused = unused2;
+			covan->status = COVAN_E_SAMPLES_SIZE;
+			tm_lap( ctx->telemetry, TM_FILTER, &mark );
+			return -1;
+		}
+	}
+
+	// Waste results already known for this pair's NA patterns...
+
+	uint64_t lhash = 0, rhash = 0;
+	const bool LCACHED = _wcache_applies( ctx, &pair->l, &pair->r, &lhash );
+	const bool RCACHED = _wcache_applies( ctx, &pair->r, &pair->l, &rhash );
+	const struct WasteEntry *lhit
+		= LCACHED ? _wcache_find( ctx, &pair->l, &pair->r, lhash ) : NULL;
+	const struct WasteEntry *rhit
+		= RCACHED ? _wcache_find( ctx, &pair->r, &pair->l, rhash ) : NULL;
+
 	// At this point there should be no other returns until function's end!
 	// Collect and report whatever we can...
 
-	mix_clear( _Lwaste, 2 ); // Secondary analyses ALWAYS involve...
-	mix_clear( _Rwaste, 2 ); // ...only categories {0,1}.
+	mix_clear( ctx->Lwaste, 2 ); // Secondary analyses ALWAYS involve...
+	mix_clear( ctx->Rwaste, 2 ); // ...only categories {0,1}.
 
 	// No matter what tests are executed there are only three fundamental
 	// cases:
@@ -214,41 +766,114 @@ int covan_exec(
 
 	if( covan->stat_class.left == covan->stat_class.right ) {
 
+		const struct CachedRow *lc = rowcache_lookup( ctx->cache, &pair->l );
+		const struct CachedRow *rc = rowcache_lookup( ctx->cache, &pair->r );
+
+		if( covan->stat_class.left == MTM_STATCLASS_CONTINUOUS
+				&& lc && lc->rank
+				&& rc && rc->rank ) {
+
+			// Both rows are complete, so there is nothing to filter, no
+			// waste to characterize, and both rows are already ranked.
+
+			count = ctx->max_sample_count;
+
+			tm_lap( ctx->telemetry, TM_FILTER, &mark );
+
+			if( ! ( count > 2 ) ) {
+				covan->status |= COVAN_E_COVAR_DEGEN;
+			} else
+			if( count >= arg_min_sample_count ) {
+				if( lc->centered && rc->centered ) {
+					double rho;
+					if( ctx->panel.first <= pair->l.offset
+							&& pair->l.offset   <  ctx->panel.last
+							&& ctx->panel.first <= pair->r.offset )
+						rho = ctx->panel.rho[
+							( pair->l.offset - ctx->panel.first )*ctx->cache->rows
+							+ pair->r.offset ];
+					else {
+						int64_t dot;
+						corblock_dot( &lc->centered, 1, &rc->centered, 1, count, &dot );
+						rho = _centered_rho( dot, lc, rc );
+						tm_lap( ctx->telemetry, TM_STATISTIC, &mark );
+					}
+					con_spearman_from_rho( ctx->naccum, rho,
+						lc->rank_status,
+						rc->rank_status, count, &covan->result );
+				} else
+					con_spearman_correlation_ranked( ctx->naccum,
+						lc->rank, lc->rank_status,
+						rc->rank, rc->rank_status, count, &covan->result );
+				covan->sign = covan->result.value;
+			} else
+				covan->status |= COVAN_E_SAMPLES_SIZE;
+
+		} else
 		if( covan->stat_class.left == MTM_STATCLASS_CONTINUOUS ) {
 
-			con_clear( _naccum );
+			// When both rows' sample orders are cached, only which samples
+			// are common is recorded here, and the common samples are
+			// later ranked without sorting.
 
-			for(int i = 0; i < max_sample_count; i++ ) {
+			const bool PRESORTED
+				= lc && lc->order && rc && rc->order;
+
+			con_clear( ctx->naccum );
+
+			for(int i = 0; i < ctx->max_sample_count; i++ ) {
 
 				const float F1
 					= ((const float*)pair->l.data)[i];
 				const float F2
 					= ((const float*)pair->r.data)[i];
 
+				if( PRESORTED ) {
+					con_mark( ctx->naccum, i, ! ( isnan(F1) || isnan(F2) ) );
+					continue; // ...waste is accumulated below.
+				}
+
 				if( ! isnan(F1) ) {
 					if( ! isnan(F2) ) {
-						con_push( _naccum, F1, F2 );
-						mix_push( _Lwaste, F1, 1 );
-						mix_push( _Rwaste, F2, 1 );
+						con_push( ctx->naccum, F1, F2 );
+						mix_push( ctx->Lwaste, F1, 1 );
+						mix_push( ctx->Rwaste, F2, 1 );
 					} else {
-						mix_push( _Lwaste, F1, 0 );
+						mix_push( ctx->Lwaste, F1, 0 );
 						unused1++;
 					}
 				} else { // F1 is N/A
 					if( ! isnan(F2) ) {
-						mix_push( _Rwaste, F2, 0 );
+						mix_push( ctx->Rwaste, F2, 0 );
 						unused2++;
 					}
 				}
 			}
 
-			count = con_size( _naccum );
+			if( PRESORTED ) {
+				unused1 = lhit
+					? lhit->unused
+					: _push_waste_presorted( ctx->Lwaste, &pair->l, &pair->r, lc );
+				unused2 = rhit
+					? rhit->unused
+					: _push_waste_presorted( ctx->Rwaste, &pair->r, &pair->l, rc );
+			}
+
+			count = con_size( ctx->naccum );
 
-			if( ! con_complete( _naccum ) ) {
+			tm_lap( ctx->telemetry, TM_FILTER, &mark );
+
+			if( ! con_complete( ctx->naccum ) ) {
 				covan->status |= COVAN_E_COVAR_DEGEN;
 			} else
 			if( count >= arg_min_sample_count ) {
-				con_spearman_correlation( _naccum, &covan->result );
+				if( PRESORTED )
+					con_spearman_correlation_presorted( ctx->naccum,
+						(const float*)pair->l.data, lc->order, lc->order_count,
+						(const float*)pair->r.data, rc->order, rc->order_count,
+						&covan->result );
+				else
+					con_spearman_correlation( ctx->naccum, &covan->result );
 				// TODO: Following line won't be necessary after output formatting is re-implemented for V2.0.
 				covan->sign = covan->result.value;
 			} else
@@ -258,13 +883,24 @@ int covan_exec(
 
 			assert( covan->stat_class.left == MTM_STATCLASS_CATEGORICAL );
 
-			cat_clear( _caccum, LC, RC );
+			cat_clear( ctx->caccum, LC, RC );
 
 			// Note that cardinality of univariate features says NOTHING about 
 			// the final table after pairs with NA's are removed; it could be
 			// empty! That will fall out below though.
 
-			for(int i = 0; i < max_sample_count; i++ ) {
+			if( lc && lc->category && rc && rc->category ) {
+
+				_push_table_bitsliced( ctx,
+					lc->category, LC,
+					rc->category, RC );
+				unused1 = _present_count( &pair->l, ctx->max_sample_count )
+						- cat_size( ctx->caccum );
+				unused2 = _present_count( &pair->r, ctx->max_sample_count )
+						- cat_size( ctx->caccum );
+
+			} else
+			for(int i = 0; i < ctx->max_sample_count; i++ ) {
 
 				const unsigned int F1 
 					= pair->l.data[i];
@@ -278,7 +914,7 @@ int covan_exec(
 
 				if( NAN_AS_UINT != F1 ) {
 					if( NAN_AS_UINT != F2 ) {
-						cat_push( _caccum, F1, F2 );
+						cat_push( ctx->caccum, F1, F2 );
 					} else { 
 						unused1++;
 					}
@@ -289,19 +925,22 @@ int covan_exec(
 				}
 			}
 
-			count = cat_size( _caccum );
+			count = cat_size( ctx->caccum );
+
+			tm_lap( ctx->telemetry, TM_FILTER, &mark );
 
-			if( ! cat_complete( _caccum ) ) {
+			if( ! cat_complete( ctx->caccum ) ) {
 				covan->status |= COVAN_E_COVAR_DEGEN;
 			} else {
-				cat_cullBadCells( _caccum, covan->result.log, MAXLEN_STATRESULT_LOG );
+				cat_cullBadCells( ctx->caccum, covan->result.log, MAXLEN_STATRESULT_LOG );
+				tm_lap( ctx->telemetry, TM_FILTER, &mark );
 				// ...cullBadCells won't allow the table to become degenerate. 
 				if( count >= arg_min_sample_count ) {
-					if( cat_is2x2( _caccum ) ) {
-						cat_fisher_exact( _caccum, &covan->result );
-						covan->sign = cat_spearman_rho( _caccum );
+					if( cat_is2x2( ctx->caccum ) ) {
+						cat_fisher_exact( ctx->caccum, &covan->result );
+						covan->sign = cat_spearman_rho( ctx->caccum );
 					} else {
-						cat_chi_square( _caccum, &covan->result );
+						cat_chi_square( ctx->caccum, &covan->result );
 					}
 				} else
 					covan->status |= COVAN_E_SAMPLES_SIZE;
@@ -310,13 +949,23 @@ int covan_exec(
 
 	} else { // features are not of same class
 
+		const struct CachedRow *cc;
+
 		if( covan->stat_class.left == MTM_STATCLASS_CATEGORICAL ) {
 
 			assert( covan->stat_class.right == MTM_STATCLASS_CONTINUOUS );
 
-			mix_clear( _maccum, LC );
+			mix_clear( ctx->maccum, LC );
 
-			for(int i = 0; i < max_sample_count; i++ ) {
+			if( ( cc = rowcache_lookup( ctx->cache, &pair->r ) ) && cc->order ) {
+
+				unused2 = _push_mixed_presorted( ctx,
+						&pair->l, &pair->r, cc, rhit ? NULL : ctx->Rwaste );
+				unused1 = _present_count( &pair->l, ctx->max_sample_count )
+						- mix_size( ctx->maccum );
+
+			} else
+			for(int i = 0; i < ctx->max_sample_count; i++ ) {
 
 				const unsigned int F1 
 					= pair->l.data[i];
@@ -325,10 +974,10 @@ int covan_exec(
 
 				if( ! isnan(F2) ) {
 					if( NAN_AS_UINT != F1 ) {
-						mix_push( _maccum, F2, F1 );
-						mix_push( _Rwaste, F2, 1 );
+						mix_push( ctx->maccum, F2, F1 );
+						mix_push( ctx->Rwaste, F2, 1 );
 					} else {
-						mix_push( _Rwaste, F2, 0 );
+						mix_push( ctx->Rwaste, F2, 0 );
 						unused2++;
 					}
 				} else { // F2 is N/A
@@ -343,9 +992,17 @@ int covan_exec(
 			assert( covan->stat_class.left == MTM_STATCLASS_CONTINUOUS && 
 					covan->stat_class.right == MTM_STATCLASS_CATEGORICAL );
 
-			mix_clear( _maccum, RC );
+			mix_clear( ctx->maccum, RC );
 
-			for(int i = 0; i < max_sample_count; i++ ) {
+			if( ( cc = rowcache_lookup( ctx->cache, &pair->l ) ) && cc->order ) {
+
+				unused1 = _push_mixed_presorted( ctx,
+						&pair->r, &pair->l, cc, lhit ? NULL : ctx->Lwaste );
+				unused2 = _present_count( &pair->r, ctx->max_sample_count )
+						- mix_size( ctx->maccum );
+
+			} else
+			for(int i = 0; i < ctx->max_sample_count; i++ ) {
 
 				const float F1 
 					= ((const float*)pair->l.data)[i];
@@ -354,10 +1011,10 @@ int covan_exec(
 
 				if( ! isnan(F1) ) {
 					if( NAN_AS_UINT != F2 ) {
-						mix_push( _maccum, F1, F2 );
-						mix_push( _Lwaste, F1, 1 );
+						mix_push( ctx->maccum, F1, F2 );
+						mix_push( ctx->Lwaste, F1, 1 );
 					} else {
-						mix_push( _Lwaste, F1, 0 );
+						mix_push( ctx->Lwaste, F1, 0 );
 						unused1++;
 					}
 				} else { // F1 is N/A
@@ -368,15 +1025,17 @@ int covan_exec(
 			}
 		}
 
-		count = mix_size( _maccum );
+		count = mix_size( ctx->maccum );
 
-		if( ! mix_complete( _maccum ) ) {
+		tm_lap( ctx->telemetry, TM_FILTER, &mark );
+
+		if( ! mix_complete( ctx->maccum ) ) {
 			covan->status |= COVAN_E_COVAR_DEGEN;
 		} else
 		if( count >= arg_min_sample_count ) {
-			mix_kruskal_wallis( _maccum, &covan->result );
-			if( mix_categoricalIsBinary( _maccum ) )
-				covan->sign = mix_spearman_rho( _maccum );
+			mix_kruskal_wallis( ctx->maccum, &covan->result );
+			if( mix_categoricalIsBinary( ctx->maccum ) )
+				covan->sign = mix_spearman_rho( ctx->maccum );
 		} else
 			covan->status |= COVAN_E_SAMPLES_SIZE;
 	}
@@ -392,15 +1051,670 @@ int covan_exec(
 	covan->waste[0].unused = unused1;
 	covan->waste[1].unused = unused2;
 
+	// Pairs that will be discarded as insignificant need nothing more.
+
+	if( ctx->threshold > 0.0
+			&& ! ( covan->result.probability <= ctx->threshold ) )
+		return covan->status ? -1 : 0;
+
 	// Characterize how the unused parts of the two samples might have
 	// affected the statistics computed on their "overlap".
 
-	if( mix_complete( _Lwaste ) )
-		mix_kruskal_wallis( _Lwaste, &(covan->waste[0].result) );
+	if( lhit )
+		covan->waste[0].result = lhit->result;
+	else
+	if( mix_complete( ctx->Lwaste ) )
+		mix_kruskal_wallis( ctx->Lwaste, &(covan->waste[0].result) );
+
+	if( rhit )
+		covan->waste[1].result = rhit->result;
+	else
+	if( mix_complete( ctx->Rwaste ) )
+		mix_kruskal_wallis( ctx->Rwaste, &(covan->waste[1].result) );
+
+	// ...and only now, since storing may evict either hit, cache new ones.
 
-	if( mix_complete( _Rwaste ) )
-		mix_kruskal_wallis( _Rwaste, &(covan->waste[1].result) );
+	if( LCACHED && ! lhit )
+		_wcache_store( ctx, &pair->l, &pair->r, lhash, unused1, &covan->waste[0].result );
+	if( RCACHED && ! rhit )
+		_wcache_store( ctx, &pair->r, &pair->l, rhash, unused2, &covan->waste[1].result );
 
 	return covan->status ? -1 : 0;
 }
 
+
+
+#ifdef _UNITTEST_ANALYSIS_
+
+/**
+  * The application defines these in main.c.
+  */
+unsigned arg_min_cell_count   = 5;
+unsigned arg_min_mixb_count   = 1;
+unsigned arg_min_sample_count = 2;
+
+/**
+  * Bound on the difference between the Spearman rho of two complete rows
+  * computed from their centered ranks (see corblock.h) and that computed
+  * from scratch by con_spearman_correlation. (Observed differences are in
+  * the order of 1e-17.)
+  */
+#define RHO_TOLERANCE (1e-12)
+
+
+/**
+  * Describes row i of m (from its data) as the mtm loader would: its
+  * descriptor and its presence bitmap. Integral rows are categorical.
+  */
+static void _ut_describe( struct mtm_matrix *m, int i, bool integral ) {
+
+	struct mtm_descriptor *d = m->desc + i;
+	const mtm_int_t *row = m->data + i*m->columns;
+	mtm_bitmap_t *p = m->present + i*m->present_words;
+	int first = -1;
+	bool varies = false;
+
+	memset( d, 0, sizeof(*d) );
+	d->integral = d->categorical = integral;
+	mtm_present_bitmap( row, m->columns, integral, p );
+
+	for(int j = 0; j < m->columns; j++ ) {
+		if( integral ? NAN_AS_UINT == row[j] : isnan( ((const float*)row)[j] ) ) {
+			d->missing += 1;
+			continue;
+		}
+		if( integral && row[j] >= d->cardinality )
+			d->cardinality = row[j] + 1;
+		if( first < 0 )
+			first = j;
+		else
+		if( row[j] != row[first] )
+			varies = true;
+	}
+	d->constant = ! varies;
+}
+
+
+static void _ut_feature( const struct mtm_matrix *m, int i, struct mtm_feature *f ) {
+	f->offset  = i;
+	f->name    = "";
+	f->desc    = m->desc[i];
+	f->data    = m->data + i*m->columns;
+	f->present = m->present + i*m->present_words;
+}
+
+
+static struct mtm_matrix *_ut_matrix( int rows, int columns ) {
+
+	struct mtm_matrix *m = calloc( 1, sizeof(struct mtm_matrix) );
+
+	if( m ) {
+		m->rows    = rows;
+		m->columns = columns;
+		m->present_words = MTM_BITMAP_WORDS( columns );
+		m->data    = calloc( (size_t)rows*columns, sizeof(mtm_int_t) );
+		m->desc    = calloc( rows, sizeof(struct mtm_descriptor) );
+		m->present = calloc( (size_t)rows*m->present_words, sizeof(mtm_bitmap_t) );
+		if( NULL == m->data || NULL == m->desc || NULL == m->present ) {
+			printf( "setup failed\n" );
+			exit( EXIT_FAILURE );
+		}
+	}
+	return m;
+}
+
+
+static void _ut_matrix_free( struct mtm_matrix *m ) {
+	free( m->present );
+	free( m->desc );
+	free( m->data );
+	free( m );
+}
+
+
+/**
+  * Every pair of complete continuous rows, half of them with many ties,
+  * is analyzed both by a context using the row cache, whose rho come from
+  * covan_ctx_prefetch's panel for the first half of the rows and from a
+  * single corblock_dot otherwise, and by one without, which computes them
+  * with con_spearman_correlation.
+  */
+static int _ut_complete_rho( int columns ) {
+
+	const int ROWS = 16;
+	struct mtm_matrix *m = _ut_matrix( ROWS, columns );
+	covan_ctx_t *cached = covan_ctx_create( columns );
+	covan_ctx_t *fresh  = covan_ctx_create( columns );
+	struct RowCache *c;
+	int failures = 0;
+
+	for(int i = 0; i < ROWS; i++ ) {
+		float *row = (float*)( m->data + i*columns );
+		for(int j = 0; j < columns; j++ )
+			row[j] = i % 2 ? (float)( rand() % 5 ) : (float)rand() / RAND_MAX;
+		_ut_describe( m, i, false );
+	}
+	c = rowcache_create( m, SIZE_MAX );
+	if( c == NULL || cached == NULL || fresh == NULL ) {
+		printf( "setup failed\n" );
+		return 1;
+	}
+	covan_ctx_use_rowcache( cached, c );
+	covan_ctx_prefetch( cached, 0, ROWS/2 );
+
+	for(int l = 0; l < ROWS; l++ ) {
+		for(int r = l+1; r < ROWS; r++ ) {
+			struct feature_pair pair;
+			struct CovariateAnalysis a, b;
+			memset( &a, 0, sizeof(a) );
+			memset( &b, 0, sizeof(b) );
+			_ut_feature( m, l, &pair.l );
+			_ut_feature( m, r, &pair.r );
+			covan_ctx_exec( cached, &pair, &a );
+			covan_ctx_exec( fresh,  &pair, &b );
+			if( a.status != b.status
+					|| a.result.sample_count != b.result.sample_count
+					|| ! ( fabs( a.result.value - b.result.value ) <= RHO_TOLERANCE ) ) {
+				printf( "rows %d,%d: rho %.17g (cached) vs. %.17g\n",
+					l, r, a.result.value, b.result.value );
+				failures += 1;
+			}
+		}
+	}
+	covan_ctx_destroy( fresh );
+	covan_ctx_destroy( cached );
+	rowcache_destroy( c );
+	_ut_matrix_free( m );
+	return failures;
+}
+
+
+/**
+  * Rows of continuous and categorical values with random numbers of NAs,
+  * including none and all, are paired with presence bitmaps and without.
+  * The overlap counted from the bitmaps must be the number of columns
+  * scanned in which both rows are present, and pairs must be rejected
+  * before analysis exactly when that is below the minimum sample count,
+  * with the waste counts a full scan would produce.
+  * Pairs of constant rows are rejected before their overlap counts.
+  */
+static int _ut_overlap( int columns ) {
+
+	const int ROWS = 24;
+	const unsigned MIN_SAMPLES = arg_min_sample_count;
+	struct mtm_matrix *m = _ut_matrix( ROWS, columns );
+	covan_ctx_t *ctx = covan_ctx_create( columns );
+	int failures = 0;
+
+	if( ctx == NULL ) {
+		printf( "setup failed\n" );
+		return 1;
+	}
+
+	for(int i = 0; i < ROWS; i++ ) {
+		const bool INTEGRAL = i % 3 == 2;
+		const int NA_PERCENT = i % 8 == 0 ? 0 : i % 8 == 1 ? 100 : rand() % 100;
+		for(int j = 0; j < columns; j++ ) {
+			if( rand() % 100 < NA_PERCENT ) {
+				if( INTEGRAL )
+					m->data[ i*columns + j ] = NAN_AS_UINT;
+				else
+					((float*)m->data)[ i*columns + j ] = NAN;
+			} else {
+				if( INTEGRAL )
+					m->data[ i*columns + j ] = rand() % 3;
+				else
+					((float*)m->data)[ i*columns + j ] = (float)rand() / RAND_MAX;
+			}
+		}
+		_ut_describe( m, i, INTEGRAL );
+		for(int j = columns; j < m->present_words*64; j++ ) {
+			if( m->present[ i*m->present_words + j/64 ] & (((mtm_bitmap_t)1) << (j%64)) ) {
+				printf( "row %d: bit %d beyond the last column is set\n", i, j );
+				failures += 1;
+				break;
+			}
+		}
+	}
+
+	for(int l = 0; l < ROWS; l++ ) {
+		for(int r = 0; r < ROWS; r++ ) {
+
+			const bool INTEGRAL_L = m->desc[l].integral;
+			const bool INTEGRAL_R = m->desc[r].integral;
+			struct feature_pair pair;
+			struct CovariateAnalysis a, b;
+			unsigned both = 0, counted = 0;
+			int unused[2] = {0,0};
+
+			_ut_feature( m, l, &pair.l );
+			_ut_feature( m, r, &pair.r );
+
+			for(int j = 0; j < columns; j++ ) {
+				const bool LP = INTEGRAL_L
+					? NAN_AS_UINT != pair.l.data[j]
+					: ! isnan( ((const float*)pair.l.data)[j] );
+				const bool RP = INTEGRAL_R
+					? NAN_AS_UINT != pair.r.data[j]
+					: ! isnan( ((const float*)pair.r.data)[j] );
+				if( LP && RP )
+					both += 1;
+				else
+				if( LP )
+					unused[0] += 1;
+				else
+				if( RP )
+					unused[1] += 1;
+			}
+			for(int w = 0; w < m->present_words; w++ )
+				counted += __builtin_popcountll( pair.l.present[w] & pair.r.present[w] );
+			if( counted != both ) {
+				printf( "rows %d,%d: bitmaps overlap in %u columns, not %u\n", l, r, counted, both );
+				failures += 1;
+			}
+
+			if( m->desc[l].constant || m->desc[r].constant )
+				continue;
+
+			// A minimum of one more than the overlap, but not the overlap itself,
+			// must reject the pair.
+
+			for(unsigned min = both; min <= both+1; min++ ) {
+
+				arg_min_sample_count = min;
+				memset( &a, 0, sizeof(a) );
+				memset( &b, 0, sizeof(b) );
+				_ut_feature( m, l, &pair.l );
+				_ut_feature( m, r, &pair.r );
+				covan_ctx_exec( ctx, &pair, &a );
+				pair.l.present = pair.r.present = NULL;
+				covan_ctx_exec( ctx, &pair, &b );
+
+				if( a.waste[0].unused != unused[0] || a.waste[1].unused != unused[1]
+						|| b.waste[0].unused != unused[0] || b.waste[1].unused != unused[1] ) {
+					printf( "rows %d,%d: waste counts %d,%d and %d,%d, not %d,%d\n", l, r,
+						a.waste[0].unused, a.waste[1].unused,
+						b.waste[0].unused, b.waste[1].unused,
+						unused[0], unused[1] );
+					failures += 1;
+				}
+				if( ( both < min ) != ( a.status == COVAN_E_SAMPLES_SIZE ) ) {
+					printf( "rows %d,%d: overlap %u%s rejected at %u\n", l, r, both,
+						a.status == COVAN_E_SAMPLES_SIZE ? "" : " not", min );
+					failures += 1;
+				} else
+				if( a.status != COVAN_E_SAMPLES_SIZE
+						&& memcmp( &a.result, &b.result, sizeof(a.result) ) ) {
+					printf( "rows %d,%d: results differ with bitmaps\n", l, r );
+					failures += 1;
+				}
+			}
+		}
+	}
+
+	arg_min_sample_count = MIN_SAMPLES;
+	covan_ctx_destroy( ctx );
+	_ut_matrix_free( m );
+	return failures;
+}
+
+
+/**
+  * Incomplete continuous rows with many ties and categorical rows are
+  * paired by a context that walks the cached sample orders, so that its
+  * Kruskal-Wallis accumulators receive samples already sorted and rank
+  * them in a single pass, and by one that pushes samples in column order
+  * and sorts them. (The waste cache is disabled.) Every pair, including
+  * its waste tests, must have the same results.
+  */
+static int _ut_presorted( int columns ) {
+
+	const int ROWS = 24;
+	struct mtm_matrix *m = _ut_matrix( ROWS, columns );
+	covan_ctx_t *cached = covan_ctx_create( columns );
+	covan_ctx_t *fresh  = covan_ctx_create( columns );
+	struct RowCache *c;
+	int failures = 0;
+
+	for(int i = 0; i < ROWS; i++ ) {
+		const bool INTEGRAL = i % 3 == 2;
+		for(int j = 0; j < columns; j++ ) {
+			if( rand() % 4 == 0 ) {
+				if( INTEGRAL )
+					m->data[ i*columns + j ] = NAN_AS_UINT;
+				else
+					((float*)m->data)[ i*columns + j ] = NAN;
+			} else {
+				if( INTEGRAL )
+					m->data[ i*columns + j ] = rand() % ( i % 2 ? 2 : 4 );
+				else
+					((float*)m->data)[ i*columns + j ] = (float)( rand() % ( i % 2 ? 3 : 50 ) );
+			}
+		}
+		_ut_describe( m, i, INTEGRAL );
+	}
+	c = rowcache_create( m, SIZE_MAX );
+	if( c == NULL || cached == NULL || fresh == NULL ) {
+		printf( "setup failed\n" );
+		return 1;
+	}
+	covan_ctx_use_rowcache( cached, c );
+	_wcache_free( cached );
+
+	for(int l = 0; l < ROWS; l++ ) {
+		for(int r = 0; r < ROWS; r++ ) {
+			struct feature_pair pair;
+			struct CovariateAnalysis a, b;
+			if( l == r || ( m->desc[l].integral && m->desc[r].integral ) )
+				continue;
+			memset( &a, 0, sizeof(a) );
+			memset( &b, 0, sizeof(b) );
+			_ut_feature( m, l, &pair.l );
+			_ut_feature( m, r, &pair.r );
+			covan_ctx_exec( cached, &pair, &a );
+			covan_ctx_exec( fresh,  &pair, &b );
+			if( memcmp( &a, &b, sizeof(a) ) ) {
+				printf( "rows %d,%d: %s %g (p %g) presorted vs. %g (p %g)\n", l, r,
+					a.result.name, a.result.value, a.result.probability,
+					b.result.value, b.result.probability );
+				failures += 1;
+			}
+		}
+	}
+
+	covan_ctx_destroy( fresh );
+	covan_ctx_destroy( cached );
+	rowcache_destroy( c );
+	_ut_matrix_free( m );
+	return failures;
+}
+
+
+/**
+  * Pairs of incomplete continuous rows and categorical rows, in groups
+  * of 4 sharing an NA pattern, are analyzed by a context caching waste
+  * results and by one that doesn't. Results must be identical whether
+  * they were hits or not: with the cache at its size, with a single slot
+  * (so that every entry evicts another), and with every slot holding an
+  * entry for the key being looked up but for another bitmap (as if the
+  * hashes of two NA patterns collided).
+  */
+static int _ut_waste_cache( int columns ) {
+
+	const int ROWS = 24;
+	struct mtm_matrix *m = _ut_matrix( ROWS, columns );
+	covan_ctx_t *cached = covan_ctx_create( columns );
+	covan_ctx_t *fresh  = covan_ctx_create( columns );
+	struct RowCache *c;
+	int failures = 0, hits = 0, collisions = 0, slots;
+
+	for(int i = 0; i < ROWS; i++ ) {
+		const bool INTEGRAL = i % 4 == 3;
+		for(int j = 0; j < columns; j++ ) {
+			// Rows 4k..4k+3 are missing the same samples.
+			const bool NA = i % 4 == 0
+				? rand() % 5 == 0
+				: isnan( ((float*)m->data)[ (i - i%4)*columns + j ] );
+			if( INTEGRAL )
+				m->data[ i*columns + j ] = NA ? NAN_AS_UINT : (unsigned)( rand() % 3 );
+			else
+				((float*)m->data)[ i*columns + j ] = NA ? NAN : (float)( rand() % 20 );
+		}
+		_ut_describe( m, i, INTEGRAL );
+	}
+	c = rowcache_create( m, SIZE_MAX );
+	if( c == NULL || cached == NULL || fresh == NULL ) {
+		printf( "setup failed\n" );
+		return 1;
+	}
+	covan_ctx_use_rowcache( cached, c );
+	covan_ctx_use_rowcache( fresh, c );
+	_wcache_free( fresh );
+	slots = cached->wcache.slots;
+
+	for(int pass = 0; pass < 3; pass++ ) {
+
+		cached->wcache.slots = pass == 1 ? 1 : slots;
+
+		for(int l = 0; l < ROWS; l++ ) {
+			for(int r = 0; r < ROWS; r++ ) {
+
+				struct feature_pair pair;
+				struct CovariateAnalysis a, b;
+				uint64_t hash;
+
+				if( l == r )
+					continue;
+				_ut_feature( m, l, &pair.l );
+				_ut_feature( m, r, &pair.r );
+
+				if( _wcache_applies( cached, &pair.l, &pair.r, &hash ) ) {
+					if( pass == 2 ) {
+						// Plant an entry for this key with another bitmap.
+						const int SLOT = _wcache_slot( cached, l, hash );
+						mtm_bitmap_t *mask = cached->wcache.mask + (size_t)SLOT*cached->wcache.words;
+						struct WasteEntry *e = cached->wcache.entry + SLOT;
+						e->row  = l;
+						e->hash = hash;
+						e->unused = -1;
+						memcpy( mask, pair.r.present, cached->wcache.words*sizeof(mtm_bitmap_t) );
+						mask[0] ^= 1;
+						collisions += 1;
+					} else
+					if( _wcache_find( cached, &pair.l, &pair.r, hash ) )
+						hits += 1;
+				}
+
+				memset( &a, 0, sizeof(a) );
+				memset( &b, 0, sizeof(b) );
+				covan_ctx_exec( cached, &pair, &a );
+				covan_ctx_exec( fresh,  &pair, &b );
+				if( memcmp( &a, &b, sizeof(a) ) ) {
+					printf( "pass %d, rows %d,%d: waste %d,%d (%g,%g) cached vs. %d,%d (%g,%g)\n",
+						pass, l, r,
+						a.waste[0].unused, a.waste[1].unused,
+						a.waste[0].result.probability, a.waste[1].result.probability,
+						b.waste[0].unused, b.waste[1].unused,
+						b.waste[0].result.probability, b.waste[1].result.probability );
+					failures += 1;
+				}
+			}
+		}
+	}
+	if( hits == 0 || collisions == 0 ) {
+		printf( "waste cache: %d hits, %d collisions\n", hits, collisions );
+		failures += 1;
+	}
+
+	covan_ctx_destroy( fresh );
+	covan_ctx_destroy( cached );
+	rowcache_destroy( c );
+	_ut_matrix_free( m );
+	return failures;
+}
+
+
+/**
+  * Contingency tables of categorical rows with NAs, with categories that
+  * never occur, and with up to MAX_CATEGORY_COUNT categories (and one
+  * more) are counted from the rows' category bitsets and by cat_push.
+  * The tables must be identical, and so must the complete results of
+  * analyzing the pairs with and without the row cache.
+  */
+static int _ut_bitsliced( int columns ) {
+
+	const int ROWS = 12;
+	static const int CATEGORIES[] = { 2, 2, 3, 5, MAX_CATEGORY_COUNT, MAX_CATEGORY_COUNT+1 };
+	struct mtm_matrix *m = _ut_matrix( ROWS, columns );
+	covan_ctx_t *cached = covan_ctx_create( columns );
+	covan_ctx_t *fresh  = covan_ctx_create( columns );
+	void *table = cat_create( MAX_CATEGORY_COUNT, MAX_CATEGORY_COUNT );
+	struct RowCache *c;
+	int failures = 0;
+
+	for(int i = 0; i < ROWS; i++ ) {
+		const int K = CATEGORIES[ i % (sizeof(CATEGORIES)/sizeof(CATEGORIES[0])) ];
+		for(int j = 0; j < columns; j++ ) {
+			unsigned int k = rand() % K;
+			// Odd rows with more than 2 categories never have category 1.
+			if( i % 2 && k == 1 && K > 2 )
+				k = 0;
+			m->data[ i*columns + j ] = rand() % 6 == 0 ? NAN_AS_UINT : k;
+		}
+		_ut_describe( m, i, true );
+	}
+	c = rowcache_create( m, SIZE_MAX );
+	if( c == NULL || cached == NULL || fresh == NULL || table == NULL ) {
+		printf( "setup failed\n" );
+		return 1;
+	}
+	covan_ctx_use_rowcache( cached, c );
+
+	for(int l = 0; l < ROWS; l++ ) {
+		for(int r = 0; r < ROWS; r++ ) {
+
+			const unsigned int LC = m->desc[l].cardinality;
+			const unsigned int RC = m->desc[r].cardinality;
+			struct feature_pair pair;
+			struct CovariateAnalysis a, b;
+
+			_ut_feature( m, l, &pair.l );
+			_ut_feature( m, r, &pair.r );
+
+			if( c->row[l].category && c->row[r].category ) {
+				cat_clear( cached->caccum, LC, RC );
+				_push_table_bitsliced( cached,
+					c->row[l].category, LC, c->row[r].category, RC );
+				cat_clear( table, LC, RC );
+				for(int j = 0; j < columns; j++ ) {
+					if( NAN_AS_UINT != pair.l.data[j] && NAN_AS_UINT != pair.r.data[j] )
+						cat_push( table, pair.l.data[j], pair.r.data[j] );
+				}
+				for(unsigned int i = 0; i < LC*RC; i++ ) {
+					if( cat_count( cached->caccum, i/RC, i%RC ) != cat_count( table, i/RC, i%RC ) ) {
+						printf( "rows %d,%d: cell (%u,%u) counts %u, not %u\n", l, r, i/RC, i%RC,
+							cat_count( cached->caccum, i/RC, i%RC ), cat_count( table, i/RC, i%RC ) );
+						failures += 1;
+						break;
+					}
+				}
+			} else
+			if( LC <= MAX_CATEGORY_COUNT && RC <= MAX_CATEGORY_COUNT ) {
+				printf( "rows %d,%d: no category bitsets\n", l, r );
+				failures += 1;
+			}
+
+			memset( &a, 0, sizeof(a) );
+			memset( &b, 0, sizeof(b) );
+			covan_ctx_exec( cached, &pair, &a );
+			covan_ctx_exec( fresh,  &pair, &b );
+			if( memcmp( &a, &b, sizeof(a) ) ) {
+				printf( "rows %d,%d: %s %g (p %g) from bitsets vs. %g (p %g)\n", l, r,
+					a.result.name, a.result.value, a.result.probability,
+					b.result.value, b.result.probability );
+				failures += 1;
+			}
+		}
+	}
+
+	cat_destroy( table );
+	covan_ctx_destroy( fresh );
+	covan_ctx_destroy( cached );
+	rowcache_destroy( c );
+	_ut_matrix_free( m );
+	return failures;
+}
+
+
+/**
+  * Pairs of all classes, including binary pairs (Fisher's exact test),
+  * are analyzed with a significance threshold and without. A p-value may
+  * only differ by having been reported as 1.0 when it in fact exceeds the
+  * threshold (see critical.h).
+  */
+static int _ut_threshold( int columns ) {
+
+	const int ROWS = 18;
+	const double THRESHOLD = 0.05;
+	struct mtm_matrix *m = _ut_matrix( ROWS, columns );
+	covan_ctx_t *thresholded = covan_ctx_create( columns );
+	covan_ctx_t *exact = covan_ctx_create( columns );
+	int failures = 0, skipped = 0;
+
+	if( thresholded == NULL || exact == NULL ) {
+		printf( "setup failed\n" );
+		return 1;
+	}
+	covan_ctx_set_threshold( thresholded, THRESHOLD );
+
+	for(int i = 0; i < ROWS; i++ ) {
+		const bool INTEGRAL = i % 3 != 0;
+		const int K = i % 3 == 1 ? 2 : 4;
+		for(int j = 0; j < columns; j++ ) {
+			const bool NA = rand() % 8 == 0;
+			if( INTEGRAL )
+				m->data[ i*columns + j ] = NA ? NAN_AS_UINT
+					: (unsigned)( rand() % 100 < 20*(i%4) ? 0 : rand() % K );
+			else
+				((float*)m->data)[ i*columns + j ] = NA ? NAN : (float)rand() / RAND_MAX;
+		}
+		_ut_describe( m, i, INTEGRAL );
+	}
+
+	for(int l = 0; l < ROWS; l++ ) {
+		for(int r = l+1; r < ROWS; r++ ) {
+			struct feature_pair pair;
+			struct CovariateAnalysis a, b;
+			memset( &a, 0, sizeof(a) );
+			memset( &b, 0, sizeof(b) );
+			_ut_feature( m, l, &pair.l );
+			_ut_feature( m, r, &pair.r );
+			covan_ctx_exec( thresholded, &pair, &a );
+			covan_ctx_exec( exact, &pair, &b );
+			if( a.status || a.result.probability == b.result.probability )
+				continue;
+			if( a.result.probability == 1.0 && b.result.probability > THRESHOLD )
+				skipped += 1;
+			else {
+				printf( "rows %d,%d: %s p %g with threshold, %g without\n", l, r,
+					b.result.name, a.result.probability, b.result.probability );
+				failures += 1;
+			}
+		}
+	}
+	if( skipped == 0 ) {
+		printf( "no p-value was skipped\n" );
+		failures += 1;
+	}
+
+	covan_ctx_destroy( exact );
+	covan_ctx_destroy( thresholded );
+	_ut_matrix_free( m );
+	return failures;
+}
+
+
+/**
+  * Compares the results of covan_ctx_exec with and without each of its
+  * shortcuts (the row cache, NA bitmaps, the waste cache and significance
+  * thresholds): ut_analysis [ <columns> ]
+  */
+
+int main( int argc, char *argv[] ) {
+
+	const int COLUMNS = argc > 1 ? atoi( argv[1] ) : 200;
+	int failures = 0;
+
+	srand( 1 );
+	failures += _ut_complete_rho( COLUMNS );
+	failures += _ut_overlap( COLUMNS );
+	failures += _ut_presorted( COLUMNS );
+	failures += _ut_waste_cache( COLUMNS );
+	failures += _ut_bitsliced( COLUMNS );
+	failures += _ut_threshold( COLUMNS );
+
+	if( failures == 0 )
+		printf( "ok\n" );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
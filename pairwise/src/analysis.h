@@ -55,7 +55,62 @@ struct CovariateAnalysis {
 };
 typedef struct CovariateAnalysis CovariateAnalysis_t;
 typedef const CovariateAnalysis_t COVARIATEANALYSIS_T;
+
+/**
+  * A covariate analysis context owns all the working memory required to
+  * analyze pairs of features of up to <columns> samples. Contexts share
+  * no state, so each thread (or interpreter) of a concurrent application
+  * should create its own.
+  */
+typedef struct CovariateAnalysisContext covan_ctx_t;
+
+covan_ctx_t *covan_ctx_create( int columns );
+
+void covan_ctx_destroy( covan_ctx_t * );
+
+/**
+ * Returns non-zero on error and 0 otherwise.
+ */
+int  covan_ctx_exec( covan_ctx_t *,
+		const struct feature_pair *pair, struct CovariateAnalysis * );
+
+/**
+  * Let the context exploit per-row precomputations (see rowcache.h).
+  * The cache must outlive the context's use of it; NULL detaches it.
+  */
+struct RowCache;
+void covan_ctx_use_rowcache( covan_ctx_t *, const struct RowCache * );
+
 /**
+  * Hint that rows [first,last) of the cached matrix are about to be
+  * paired with rows at or beyond first. The context will compute the
+  * Spearman correlations of all such pairs of complete continuous rows
+  * in bulk (see corblock.h); covan_ctx_exec then uses them as available.
+  * Only the most recent prefetch is retained. Returns non-zero only if
+  * memory could not be allocated, which is harmless.
+  */
+int covan_ctx_prefetch( covan_ctx_t *, int first, int last );
+
+/**
+  * For callers that only compare p-values against a fixed threshold p in
+  * (0,1): pairs whose primary test certainly falls short of significance
+  * are then reported with probability 1.0 rather than their exact p-value
+  * (see critical.h), and their "waste" tests are skipped altogether.
+  * Any other p restores exact p-values and complete results.
+  */
+void covan_ctx_set_threshold( covan_ctx_t *, double p );
+
+/**
+  * Accumulate the time spent filtering, ranking, and computing statistics
+  * and p-values into tm (see telemetry.h), which must outlive the
+  * context's use of it. NULL (the default) stops timing.
+  */
+struct telemetry;
+void covan_ctx_set_telemetry( covan_ctx_t *, struct telemetry *tm );
+
+/**
+  * The following functions operate on a single, process-wide default
+  * context.
   * This pre-allocates all the working memory that will be needed.
   */
 int  covan_init( int columns );
@@ -67,6 +122,14 @@ void covan_fini( void );
  */
 int  covan_exec( const struct feature_pair *pair, struct CovariateAnalysis * );
 
+void covan_use_rowcache( const struct RowCache * );
+
+int  covan_prefetch( int first, int last );
+
+void covan_set_threshold( double p );
+
+void covan_set_telemetry( struct telemetry * );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,181 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mtmatrix.h"
+#include "featpair.h"
+#include "stattest.h"
+#include "analysis.h"
+#include "varfmt.h"
+#include "statname.h"
+#include "binfmt.h"
+
+static const char MAGIC[3] = { 'P','W','B' };
+
+/***************************************************************************
+  * Little-endian (de)serialization independent of host byte order.
+  */
+
+static void _put32( uint8_t *b, uint32_t v ) {
+	b[0] = v; b[1] = v >> 8; b[2] = v >> 16; b[3] = v >> 24;
+}
+
+static void _put64( uint8_t *b, uint64_t v ) {
+	_put32( b, (uint32_t)v );
+	_put32( b+4, (uint32_t)(v >> 32) );
+}
+
+static void _putf32( uint8_t *b, float f ) {
+	uint32_t v;
+	memcpy( &v, &f, sizeof(v) );
+	_put32( b, v );
+}
+
+static void _putf64( uint8_t *b, double d ) {
+	uint64_t v;
+	memcpy( &v, &d, sizeof(v) );
+	_put64( b, v );
+}
+
+static uint32_t _get32( const uint8_t *b ) {
+	return (uint32_t)b[0]
+		| ((uint32_t)b[1] << 8)
+		| ((uint32_t)b[2] << 16)
+		| ((uint32_t)b[3] << 24);
+}
+
+static uint64_t _get64( const uint8_t *b ) {
+	return _get32( b ) | ((uint64_t)_get32( b+4 ) << 32);
+}
+
+static float _getf32( const uint8_t *b ) {
+	const uint32_t v = _get32( b );
+	float f;
+	memcpy( &f, &v, sizeof(f) );
+	return f;
+}
+
+static double _getf64( const uint8_t *b ) {
+	const uint64_t v = _get64( b );
+	double d;
+	memcpy( &d, &v, sizeof(d) );
+	return d;
+}
+
+/***************************************************************************
+  * Writing
+  */
+
+int binfmt_write_header( FILE *fp, unsigned rows ) {
+	uint8_t b[8];
+	memcpy( b, MAGIC, sizeof(MAGIC) );
+	b[3] = BINFMT_VERSION;
+	_put32( b+4, rows );
+	return fwrite( b, sizeof(b), 1, fp ) != 1;
+}
+
+
+int binfmt_write_label( FILE *fp, const char *label ) {
+	const size_t n = label ? strlen( label ) : 0;
+	const uint8_t b[2] = { n, n >> 8 };
+	if( n > UINT16_MAX )
+		return -1;
+	return fwrite( b, sizeof(b), 1, fp ) != 1
+		|| fwrite( label, 1, n, fp ) != n;
+}
+
+
+void format_binary( EMITTER_SIG ) {
+
+	uint8_t b[ BINFMT_RECORD_SIZE ];
+	const size_t LOGLEN
+		= strnlen( covan->result.log, MAXLEN_STATRESULT_LOG );
+
+	memset( b, 0, sizeof(b) );
+	_put32(  b+ 0, pair->l.offset );
+	_put32(  b+ 4, pair->r.offset );
+	b[8]  = covan->stat_class.left;
+	b[9]  = covan->stat_class.right;
+	b[10] = covan->status;
+	b[11] = statname_code( covan->result.name );
+	_putf32( b+12, covan->sign );
+	_put32(  b+16, covan->result.sample_count );
+	_put32(  b+20, (uint32_t)covan->waste[0].unused );
+	_put32(  b+24, (uint32_t)covan->waste[1].unused );
+	_putf64( b+32, covan->result.probability );
+	_putf64( b+40, covan->waste[0].result.probability );
+	_putf64( b+48, covan->waste[1].result.probability );
+	if( LOGLEN > BINFMT_MAXLEN_LOG ) {
+		memcpy( b+56, covan->result.log, BINFMT_MAXLEN_LOG-1 );
+		b[56+BINFMT_MAXLEN_LOG-1] = '+';
+	} else
+		memcpy( b+56, covan->result.log, LOGLEN );
+
+	fwrite( b, sizeof(b), 1, fp );
+}
+
+/***************************************************************************
+  * Reading
+  */
+
+int binfmt_read_header( FILE *fp, unsigned *rows ) {
+	uint8_t b[8];
+	if( fread( b, sizeof(b), 1, fp ) != 1
+		|| memcmp( b, MAGIC, sizeof(MAGIC) )
+		|| b[3] != BINFMT_VERSION )
+		return -1;
+	*rows = _get32( b+4 );
+	return 0;
+}
+
+
+char *binfmt_read_label( FILE *fp ) {
+	uint8_t b[2];
+	size_t n;
+	char *label;
+	if( fread( b, sizeof(b), 1, fp ) != 1 )
+		return NULL;
+	n = b[0] | (b[1] << 8);
+	label = malloc( n+1 );
+	if( label == NULL )
+		return NULL;
+	if( fread( label, 1, n, fp ) != n ) {
+		free( label );
+		return NULL;
+	}
+	label[n] = 0;
+	return label;
+}
+
+
+int binfmt_read( FILE *fp, struct feature_pair *pair, struct CovariateAnalysis *covan ) {
+
+	uint8_t b[ BINFMT_RECORD_SIZE ];
+
+	if( fread( b, sizeof(b), 1, fp ) != 1 )
+		return -1;
+
+	memset( covan, 0, sizeof(struct CovariateAnalysis) );
+	pair->l.offset                      = _get32( b+0 );
+	pair->r.offset                      = _get32( b+4 );
+	covan->stat_class.left              = b[8];
+	covan->stat_class.right             = b[9];
+	covan->status                       = b[10];
+	covan->result.name                  = statname( b[11] );
+	covan->sign                         = _getf32( b+12 );
+	covan->result.sample_count          = _get32( b+16 );
+	covan->waste[0].unused              = (int32_t)_get32( b+20 );
+	covan->waste[1].unused              = (int32_t)_get32( b+24 );
+	covan->result.probability           = _getf64( b+32 );
+	covan->waste[0].result.probability  = _getf64( b+40 );
+	covan->waste[1].result.probability  = _getf64( b+48 );
+	covan->waste[0].result.name         = statname( STATNAME_UNKNOWN );
+	covan->waste[1].result.name         = statname( STATNAME_UNKNOWN );
+	memcpy( covan->result.log, b+56, BINFMT_MAXLEN_LOG );
+	covan->result.log[ BINFMT_MAXLEN_LOG ] = 0;
+	return 0;
+}
+
@@ -0,0 +1,67 @@
+
+#ifndef _binfmt_h_
+#define _binfmt_h_
+
+/**
+  * A compact binary alternative to the text formats, so that formatting
+  * can be done elsewhere (by pairwise-decode) than on the compute nodes.
+  *
+  * A stream is a header followed by fixed-width records, all integers
+  * and IEEE-754 floats little-endian regardless of host.
+  *
+  * Header: "PWB" and a version byte, the row count (u32), then for each
+  * row its label as a u16 length followed by that many bytes. A row count
+  * of 0 means rows are identified by offset alone, as they are in the
+  * output of cross-products (-C).
+  *
+  * Record (BINFMT_RECORD_SIZE bytes):
+  *  0 u32 left row offset
+  *  4 u32 right row offset
+  *  8 u8  left statistical class (mtsclass.h)
+  *  9 u8  right statistical class
+  * 10 u8  status (COVAN_E_*)
+  * 11 u8  test name (statname.h)
+  * 12 f32 sign
+  * 16 u32 sample count
+  * 20 i32 unused samples of left row
+  * 24 i32 unused samples of right row
+  * 28 u32 reserved (0)
+  * 32 f64 p-value
+  * 40 f64 p-value of left row's waste test
+  * 48 f64 p-value of right row's waste test
+  * 56 the primary test's log, NUL-padded to BINFMT_MAXLEN_LOG bytes; a
+  *    longer log is truncated and ends in '+'.
+  */
+
+#define BINFMT_VERSION     (1)
+#define BINFMT_MAXLEN_LOG  (16)
+#define BINFMT_RECORD_SIZE (56+BINFMT_MAXLEN_LOG)
+
+/**
+  * The header must precede the first record. All return non-zero on
+  * I/O error.
+  */
+int binfmt_write_header( FILE *fp, unsigned rows );
+int binfmt_write_label( FILE *fp, const char *label );
+
+void format_binary( EMITTER_SIG );
+
+/**
+  * On success *rows receives the count of labels that follow. Returns
+  * non-zero on I/O error or if the stream is not in this format.
+  */
+int binfmt_read_header( FILE *fp, unsigned *rows );
+
+/**
+  * Returns a label allocated with malloc or NULL on error.
+  */
+char *binfmt_read_label( FILE *fp );
+
+/**
+  * Fill in the offsets of the pair (only) and the parts of the analysis
+  * that records retain. Returns non-zero at end of stream or on error.
+  */
+int binfmt_read( FILE *fp, struct feature_pair *, struct CovariateAnalysis * );
+
+#endif
+
@@ -14,6 +14,8 @@
 #include "cat.h"
 #include "fisher.h"
 #include "min2.h"
+#include "critical.h"
+#include "telemetry.h"
 #include "bvr.h"
 
 typedef unsigned int count_t;
@@ -90,6 +92,23 @@ struct CatCovars {
 	  */
 	count_t *rmarg;
 	count_t *cmarg;
+
+	/**
+	  * Fisher exact test workspace (see fisher.h).
+	  */
+	void *fexact;
+
+	/**
+	  * Chi-square critical values for the threshold set by
+	  * cat_setSignificanceThreshold, indexed by degrees of freedom.
+	  * (Fisher's exact test uses only the threshold.)
+	  */
+	struct CriticalValues critical;
+
+	/**
+	  * Phases are timed into this if it is non-NULL.
+	  */
+	struct telemetry *telemetry;
 };
 
 
@@ -378,6 +397,9 @@ void cat_destroy( void *pv ) {
 		struct CatCovars *co = (struct CatCovars *)pv;
 		if( co->expect )
 			free( co->expect );
+		if( co->fexact )
+			fexact_free( co->fexact );
+		crit_fini( &co->critical );
 		free( pv );
 	}
 }
@@ -412,9 +434,14 @@ void *cat_create( unsigned int rcap, unsigned int ccap ) {
 
 		co->REQUIRED_CELL_MINIMUM = 5;
 
+		co->fexact
+			= fexact_alloc( 0 ); // ...grows on demand.
+
 		// If -anything- failed clean up any successes.
 		if( (NULL == co->counts) || 
-			(NULL == co->expect) ) {
+			(NULL == co->expect) ||
+			(NULL == co->fexact) ||
+			crit_init( &co->critical, gsl_cdf_chisq_Qinv, (rcap-1)*(ccap-1)+1 ) ) {
 			cat_destroy( co );
 			return NULL;
 		}
@@ -449,6 +476,27 @@ void cat_clear( void *pv, coord_t nr, coord_t nc ) {
 }
 
 
+void cat_setSignificanceThreshold( void *pv, double p ) {
+	crit_set_threshold( &((struct CatCovars *)pv)->critical, p );
+}
+
+
+void cat_setTelemetry( void *pv, struct telemetry *tm ) {
+	((struct CatCovars *)pv)->telemetry = tm;
+}
+
+
+int cat_setSampleCapacity( void *pv, unsigned n ) {
+	struct CatCovars *co = (struct CatCovars *)pv;
+	void *ws = fexact_alloc( n );
+	if( NULL == ws )
+		return -1;
+	fexact_free( co->fexact );
+	co->fexact = ws;
+	return 0;
+}
+
+
 void cat_setMinCellCount( void *pv, unsigned n ) {
 	struct CatCovars *co = (struct CatCovars *)pv;
 	co->REQUIRED_CELL_MINIMUM = n;
@@ -475,6 +523,32 @@ void cat_push( void *pv, coord_t r, coord_t c ) {
 }
 
 
+void cat_push_count( void *pv, coord_t r, coord_t c, unsigned int n ) {
+
+	struct CatCovars *co = (struct CatCovars *)pv;
+
+	assert( r < co->decl_rows );
+	assert( c < co->decl_cols );
+
+	co->counts[ r*co->decl_cols + c ] += n;
+
+	co->sample_count += n;
+	co->rmarg[r] += n;
+	co->cmarg[c] += n;
+}
+
+
+unsigned int cat_count( void *pv, coord_t r, coord_t c ) {
+
+	struct CatCovars *co = (struct CatCovars *)pv;
+
+	assert( r < co->decl_rows );
+	assert( c < co->decl_cols );
+
+	return co->counts[ r*co->decl_cols + c ];
+}
+
+
 size_t cat_size( void *pv ) {
 	struct CatCovars *co = (struct CatCovars *)pv;
 	return co->sample_count;
@@ -686,6 +760,7 @@ int cat_chi_square( void *pv, struct Statistic *result ) {
 
 	unsigned int n_empty = 0;
 	double chi = 0.0;
+	uint64_t mark = tm_start( co->telemetry );
 
 	if( co->calculated < Expectation )
 		_calc_expectation( co );
@@ -702,12 +777,18 @@ int cat_chi_square( void *pv, struct Statistic *result ) {
 		}
 	}
 
+	tm_lap( co->telemetry, TM_STATISTIC, &mark );
+
 	result->name
 		= "Chi-square";
 	result->sample_count
 		= co->sample_count;
 	result->probability
-		= gsl_cdf_chisq_Q( chi, (R-1)*(C-1) );
+		= crit_falls_short( &co->critical, chi, (R-1)*(C-1) )
+		? 1.0
+		: gsl_cdf_chisq_Q( chi, (R-1)*(C-1) );
+
+	tm_lap( co->telemetry, TM_PVALUE, &mark );
 
 	result->extra_value[0] = R;
 	result->extra_value[1] = C;
@@ -721,6 +802,7 @@ int cat_chi_square( void *pv, struct Statistic *result ) {
 int cat_fisher_exact( void *pv, struct Statistic *result ) {
 
 	struct CatCovars *co = (struct CatCovars *)pv;
+	uint64_t mark = tm_start( co->telemetry );
 
 	// OPTIMIZE: does not make sense to call fisher exact without
 	// NULL stest_t argument. Keeping this signature for consistency
@@ -735,22 +817,37 @@ int cat_fisher_exact( void *pv, struct Statistic *result ) {
 	  *    --+--
 	  *    c | d
 	  *
-	  * ...we need to pass fexact_prob( x, m, n, k )
+	  * ...we need to pass fexact_prob_r( ws, x, m, n, k )
 	  * m == a+c
 	  * n == b+d
 	  * k == a+b
 	  * x == a
 	  */
+	const unsigned int X = _count(co,0,0);
+	const unsigned int M = _count(co,0,0) + _count(co,1,0); // a+c
+	const unsigned int N = _count(co,0,1) + _count(co,1,1); // b+d
+	const unsigned int K = _count(co,0,0) + _count(co,0,1); // a+b
+
 	result->name
 		= "Fisher_Exact";
 	result->sample_count
 		= co->sample_count;
+
+	// With a threshold, the probability of the table itself (a lower
+	// bound of the p-value) can show the p-value certainly exceeds it.
+	// There is no statistic to compare with critical values, but the
+	// same relative margin guards against rounding.
+
 	result->probability
-		= fexact_prob( 
-			_count(co,0,0), 
-			_count(co,0,0) + _count(co,1,0),   // a+c
-			_count(co,0,1) + _count(co,1,1),   // b+d
-			_count(co,0,0) + _count(co,0,1) ); // a+b
+		= co->critical.threshold > 0.0
+			&& fexact_point_prob_r( co->fexact, X, M, N, K )
+				> co->critical.threshold * ( 1.0 + 1e-6 )
+		? 1.0
+		: fexact_prob_r( co->fexact, X, M, N, K );
+
+	// ...which is all p-value; the table is the statistic.
+
+	tm_lap( co->telemetry, TM_PVALUE, &mark );
 
 	// TODO: Don't need these now.
 	result->extra_value[0] = co->decl_rows;
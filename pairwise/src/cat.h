@@ -16,12 +16,42 @@ void cat_clear( void *pv, coord_t r, coord_t c );
 
 void cat_setMinCellCount( void *pv, unsigned n );
 
+/**
+ * Sizes internal tables (e.g. log-factorials for Fisher's exact test)
+ * for tables of up to n samples so no allocation occurs later.
+ */
+int  cat_setSampleCapacity( void *pv, unsigned n );
+
+/**
+ * Once a threshold in (0,1) is set, chi-square tests whose p-values
+ * certainly exceed it report p-value 1.0 without computing it exactly,
+ * and so do Fisher's exact tests of tables whose own probability exceeds
+ * it (see fexact_point_prob_r).
+ * Any other value restores exact computation of all p-values.
+ */
+void cat_setSignificanceThreshold( void *pv, double p );
+
+/**
+ * Time statistic and p-value phases into tm (see telemetry.h);
+ * NULL stops timing.
+ */
+struct telemetry;
+void cat_setTelemetry( void *pv, struct telemetry *tm );
+
 /**
  * These accessors entirely (and losslessly(?)) encapsulate the pointer 
  * arithmetic to reach into the matrix. It should not exist anywhere 
  * else!
  */
 void   cat_push( void *pv, coord_t r, coord_t c );
+/**
+ * Equivalent to n cat_push'es of (r,c) (for tables counted in bulk).
+ */
+void   cat_push_count( void *pv, coord_t r, coord_t c, unsigned int n );
+/**
+ * The count of cell (r,c) of the table as pushed (i.e. before culling).
+ */
+unsigned int cat_count( void *pv, coord_t r, coord_t c );
 size_t cat_size( void *pv );
 bool   cat_complete( void *pv );
 bool   cat_is2x2( void *pv );
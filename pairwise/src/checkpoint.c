@@ -0,0 +1,137 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+static const char *SIGNATURE = "pairwise-checkpoint";
+#define VERSION (1)
+
+int checkpoint_write( const char *path, const struct checkpoint *c ) {
+
+	char *tmp = malloc( strlen( path ) + 5 );
+	FILE *fp;
+	int failed;
+
+	if( tmp == NULL )
+		return -1;
+	strcpy( tmp, path );
+	strcat( tmp, ".tmp" );
+
+	fp = fopen( tmp, "w" );
+	if( fp == NULL ) {
+		free( tmp );
+		return -1;
+	}
+
+	fprintf( fp,
+		"%s\t%d\n"
+		"matrix\t%d\t%d\n"
+		"shard\t%d/%d\n"
+		"position\t%d\t%d\n"
+		"insignificant\t%" PRIu64 "\n"
+		"untested\t%" PRIu64 "\n"
+		"output\t%ld\n"
+		"fdr\t%ld\t%d\t%a\n",
+		SIGNATURE, VERSION,
+		c->rows, c->columns,
+		c->shard, c->shards,
+		c->l, c->r,
+		c->insignificant,
+		c->untested,
+		c->output,
+		c->fdr, c->fdr_uncached, c->fdr_max_p );
+
+	failed = fflush( fp ) || fsync( fileno( fp ) );
+	if( fclose( fp ) )
+		failed = 1;
+	if( ! failed )
+		failed = rename( tmp, path );
+	else
+		unlink( tmp );
+	free( tmp );
+	return failed;
+}
+
+
+int checkpoint_read( const char *path, struct checkpoint *c ) {
+
+	char signature[32];
+	int version, n;
+	FILE *fp = fopen( path, "r" );
+
+	if( fp == NULL )
+		return -1;
+
+	memset( c, 0, sizeof(struct checkpoint) );
+	n = fscanf( fp,
+		"%31s %d "
+		"matrix %d %d "
+		"shard %d/%d "
+		"position %d %d "
+		"insignificant %" SCNu64 " "
+		"untested %" SCNu64 " "
+		"output %ld "
+		"fdr %ld %d %la",
+		signature, &version,
+		&c->rows, &c->columns,
+		&c->shard, &c->shards,
+		&c->l, &c->r,
+		&c->insignificant,
+		&c->untested,
+		&c->output,
+		&c->fdr, &c->fdr_uncached, &c->fdr_max_p );
+	fclose( fp );
+
+	return n == 14
+		&& strcmp( signature, SIGNATURE ) == 0
+		&& version == VERSION ? 0 : -1;
+}
+
+
+#ifdef _UNITTEST_CHECKPOINT_
+
+/**
+  * Round trip a made-up checkpoint through the named file (which is
+  * left in place for inspection): ut_checkpoint <file>
+  */
+
+int main( int argc, char *argv[] ) {
+
+	const struct checkpoint W = {
+		.rows = 20531, .columns = 517,
+		.shard = 3, .shards = 20,
+		.l = 1234, .r = 1235,
+		.insignificant = 5000000000ULL,
+		.untested = 17,
+		.output = 123456789012L,
+		.fdr = -1, .fdr_uncached = 42,
+		.fdr_max_p = 0.1 };
+	struct checkpoint r;
+
+	if( argc < 2 ) {
+		fprintf( stderr, "%s <file>\n", argv[0] );
+		return EXIT_FAILURE;
+	}
+	if( checkpoint_write( argv[1], &W ) || checkpoint_read( argv[1], &r ) ) {
+		perror( argv[1] );
+		return EXIT_FAILURE;
+	}
+	if( W.rows != r.rows || W.columns != r.columns
+			|| W.shard != r.shard || W.shards != r.shards
+			|| W.l != r.l || W.r != r.r
+			|| W.insignificant != r.insignificant || W.untested != r.untested
+			|| W.output != r.output || W.fdr != r.fdr
+			|| W.fdr_uncached != r.fdr_uncached || W.fdr_max_p != r.fdr_max_p ) {
+		printf( "round trip failed\n" );
+		return EXIT_FAILURE;
+	}
+	printf( "ok\n" );
+	return EXIT_SUCCESS;
+}
+#endif
+
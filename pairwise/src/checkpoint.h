@@ -0,0 +1,40 @@
+
+#ifndef _checkpoint_h_
+#define _checkpoint_h_
+
+#include <stdint.h>
+
+/**
+  * Everything needed to resume an interrupted all-pairs run: the next
+  * pair to analyze, the counters accumulated so far, and the lengths of
+  * the output and of the FDR cache at the moment that pair was reached
+  * (anything beyond them is discarded on resumption).
+  *
+  * The file is text ("key<TAB>value" lines) and is replaced atomically,
+  * so it is always either the previous or the new checkpoint.
+  */
+struct checkpoint {
+	int rows, columns;     // ...of the input, to catch the wrong one
+	int shard, shards;
+	int l, r;              // ...next pair
+	uint64_t insignificant;
+	uint64_t untested;
+	long output;           // ...offset, in bytes
+	long fdr;              // ...offset in bytes, or -1 if no FDR cache
+	int fdr_uncached;
+	double fdr_max_p;
+};
+
+/**
+  * Writes to <path>.tmp, syncs it, and renames it to <path>.
+  * Returns non-zero (with errno set) on failure.
+  */
+int checkpoint_write( const char *path, const struct checkpoint * );
+
+/**
+  * Returns non-zero if the file can't be read or is not a checkpoint.
+  */
+int checkpoint_read( const char *path, struct checkpoint * );
+
+#endif
+
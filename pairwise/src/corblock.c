@@ -0,0 +1,172 @@
+
+/**
+  * Blocked computation of many dot products at once.
+  *
+  * This is the kernel behind bulk Spearman correlation of complete rows.
+  * Ranks are represented as 2*(rank - mean rank), which is always an
+  * integer (tied ranks are averages of consecutive integers) and fits in
+  * 16 bits for vectors of up to CORBLOCK_MAX_LENGTH. Dot products of such
+  * vectors are computed exactly in integer arithmetic, which, unlike
+  * floating-point, the compiler is free to reassociate and vectorize.
+  * The code itself is portable scalar C: it contains no intrinsics, and
+  * how widely it is vectorized depends on the compiler and on the target
+  * (only NATIVE builds use more than the baseline instruction set).
+  *
+  * The loops are blocked in both dimensions so that a strip of right
+  * rows (and the 4 left rows being crossed with it) remains in cache,
+  * and each element of a right row loaded is used for 4 products.
+  */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "corblock.h"
+
+/**
+  * Right rows per block, columns per block.
+  */
+#define RB (64)
+#define KC (2048)
+
+/**
+  * Elements of this many products can be summed in 32 bits.
+  */
+static int _safe_run( int n ) {
+	const int64_t MAXPROD
+		= (int64_t)(n > 1 ? n-1 : 1) * (int64_t)(n > 1 ? n-1 : 1);
+	const int64_t RUN = INT32_MAX / MAXPROD;
+	return RUN > KC ? KC : (int)RUN;
+}
+
+
+static void _dot4( const int16_t * const *l, const int16_t *r, int n, int run, int64_t *s ) {
+
+	const int16_t *l0 = l[0], *l1 = l[1], *l2 = l[2], *l3 = l[3];
+	int64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+	int k = 0;
+
+	while( k < n ) {
+		const int END = k + run < n ? k + run : n;
+		int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		for(; k < END; k++ ) {
+			const int32_t x = r[k];
+			s0 += l0[k] * x;
+			s1 += l1[k] * x;
+			s2 += l2[k] * x;
+			s3 += l3[k] * x;
+		}
+		t0 += s0; t1 += s1; t2 += s2; t3 += s3;
+	}
+	s[0] += t0; s[1] += t1; s[2] += t2; s[3] += t3;
+}
+
+
+static int64_t _dot1( const int16_t *l, const int16_t *r, int n, int run ) {
+
+	int64_t t = 0;
+	int k = 0;
+
+	while( k < n ) {
+		const int END = k + run < n ? k + run : n;
+		int32_t s = 0;
+		for(; k < END; k++ )
+			s += l[k] * (int32_t)r[k];
+		t += s;
+	}
+	return t;
+}
+
+
+void corblock_dot(
+		const int16_t * const *L, int nl,
+		const int16_t * const *R, int nr,
+		int n, int64_t *out ) {
+
+	const int RUN = _safe_run( n );
+	int j0, k0;
+
+	memset( out, 0, nl*nr*sizeof(int64_t) );
+
+	for(j0 = 0; j0 < nr; j0 += RB ) {
+
+		const int J1 = j0 + RB < nr ? j0 + RB : nr;
+
+		for(k0 = 0; k0 < n; k0 += KC ) {
+
+			const int K = k0 + KC < n ? KC : n - k0;
+			const int16_t *l[4];
+			int i, j;
+
+			for(i = 0; i + 4 <= nl; i += 4 ) {
+				l[0] = L[i+0] + k0;
+				l[1] = L[i+1] + k0;
+				l[2] = L[i+2] + k0;
+				l[3] = L[i+3] + k0;
+				for(j = j0; j < J1; j++ ) {
+					int64_t s[4] = {0,0,0,0};
+					_dot4( l, R[j] + k0, K, RUN, s );
+					out[ (i+0)*nr + j ] += s[0];
+					out[ (i+1)*nr + j ] += s[1];
+					out[ (i+2)*nr + j ] += s[2];
+					out[ (i+3)*nr + j ] += s[3];
+				}
+			}
+			for(; i < nl; i++ ) {
+				for(j = j0; j < J1; j++ )
+					out[ i*nr + j ] += _dot1( L[i] + k0, R[j] + k0, K, RUN );
+			}
+		}
+	}
+}
+
+
+#ifdef _UNITTEST_CORBLOCK_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+  * Compares corblock_dot against the obvious triple loop on random
+  * vectors: ut_corblock [ <left rows> <right rows> <length> ]
+  */
+int main( int argc, char *argv[] ) {
+
+	const int NL = argc > 1 ? atoi( argv[1] ) : 13;
+	const int NR = argc > 2 ? atoi( argv[2] ) : 150;
+	const int N  = argc > 3 ? atoi( argv[3] ) : 5000;
+
+	int16_t *data = calloc( (NL+NR)*N, sizeof(int16_t) );
+	const int16_t **L = calloc( NL, sizeof(int16_t*) );
+	const int16_t **R = calloc( NR, sizeof(int16_t*) );
+	int64_t *out = calloc( NL*NR, sizeof(int64_t) );
+	int i, j, k, failures = 0;
+
+	for(i = 0; i < (NL+NR)*N; i++ )
+		data[i] = (int16_t)( (rand() % (2*N-1)) - (N-1) );
+	for(i = 0; i < NL; i++ ) L[i] = data + i*N;
+	for(j = 0; j < NR; j++ ) R[j] = data + (NL+j)*N;
+
+	corblock_dot( L, NL, R, NR, N, out );
+
+	for(i = 0; i < NL; i++ ) {
+		for(j = 0; j < NR; j++ ) {
+			int64_t s = 0;
+			for(k = 0; k < N; k++ )
+				s += (int64_t)L[i][k] * R[j][k];
+			if( s != out[ i*NR + j ] ) {
+				printf( "(%d,%d): %lld != %lld\n", i, j,
+					(long long)out[ i*NR + j ], (long long)s );
+				failures += 1;
+			}
+		}
+	}
+	printf( "%d failures\n", failures );
+
+	free( out );
+	free( R );
+	free( L );
+	free( data );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
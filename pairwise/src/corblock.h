@@ -0,0 +1,36 @@
+
+#ifndef _corblock_h_
+#define _corblock_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  * Largest vector length for which corblock_dot is exact: products of
+  * the centered, doubled ranks corblock operates on fit in 32 bits as
+  * long as no element exceeds this in magnitude.
+  */
+#define CORBLOCK_MAX_LENGTH (32768)
+
+/**
+  * Computes all nl x nr dot products of the length-n vectors L[i] and
+  * R[j], storing the (exact) result for (i,j) in out[ i*nr + j ].
+  *
+  * Spearman's rho computed from these (see analysis.c) is rounded only
+  * in the final square root and division, whereas the per-pair path
+  * (con_spearman_correlation) accumulates in floating point. The two
+  * may therefore differ in their last bits; ut_analysis requires them
+  * to agree within 1e-12.
+  */
+void corblock_dot(
+		const int16_t * const *L, int nl,
+		const int16_t * const *R, int nr,
+		int n, int64_t *out );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,66 @@
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "critical.h"
+
+/**
+  * Statistics within this relative distance of the critical value are
+  * left to the exact p-value computation.
+  */
+#define MARGIN (1e-6)
+
+
+static void _invalidate( struct CriticalValues *cv ) {
+	for(unsigned int i = 0; i < cv->capacity; i++ )
+		cv->value[i] = nan("");
+}
+
+
+int crit_init( struct CriticalValues *cv,
+		double (*Qinv)( double, double ), unsigned int capacity ) {
+
+	cv->threshold = 0.0;
+	cv->Qinv      = Qinv;
+	cv->capacity  = capacity;
+	cv->value     = calloc( capacity > 0 ? capacity : 1, sizeof(double) );
+	if( NULL == cv->value )
+		return -1;
+	_invalidate( cv );
+	return 0;
+}
+
+
+void crit_fini( struct CriticalValues *cv ) {
+	if( cv->value )
+		free( cv->value );
+	cv->value    = NULL;
+	cv->capacity = 0;
+}
+
+
+void crit_set_threshold( struct CriticalValues *cv, double p ) {
+	cv->threshold = ( 0.0 < p && p < 1.0 ) ? p : 0.0;
+	_invalidate( cv );
+}
+
+
+bool crit_falls_short( struct CriticalValues *cv, double x, unsigned int nu ) {
+
+	double c;
+
+	if( cv->threshold == 0.0 || nu < 1 || nu >= cv->capacity )
+		return false;
+
+	c = cv->value[ nu ];
+	if( isnan( c ) ) {
+		c = cv->Qinv( cv->threshold, nu );
+		// A failed inversion must never excuse a statistic.
+		if( ! isfinite( c ) )
+			c = -HUGE_VAL;
+		cv->value[ nu ] = c;
+	}
+	return x < c*(1.0-MARGIN);
+}
+
@@ -0,0 +1,62 @@
+
+#ifndef _critical_h_
+#define _critical_h_
+
+#include <stdbool.h>
+
+/**
+  * Critical values of a test statistic for a fixed significance threshold.
+  *
+  * If Q(x;nu) is the upper-tail probability of a statistic x with nu
+  * degrees of freedom, its critical value is the x at which Q(x;nu)
+  * equals the threshold. Q decreases in x, so a statistic (clearly) below
+  * the critical value has a p-value above the threshold, and a caller
+  * that only filters on the threshold need not evaluate Q at all.
+  *
+  * Critical values are computed on first use of each nu.
+  *
+  * Fisher's exact test has no statistic whose distribution depends only
+  * on a degree of freedom; its p-value is a sum over all tables with the
+  * observed margins. cat.c instead compares the observed table's own
+  * probability, a lower bound of that sum, with the threshold.
+  */
+struct CriticalValues {
+
+	/**
+	  * Zero disables the table: crit_falls_short is always false.
+	  */
+	double threshold;
+
+	/**
+	  * The inverse of Q: x such that Q(x;nu) == P.
+	  */
+	double (*Qinv)( double P, double nu );
+
+	/**
+	  * Valid degrees of freedom are [1,capacity).
+	  */
+	unsigned int capacity;
+
+	/**
+	  * NaN until computed.
+	  */
+	double *value;
+};
+
+int  crit_init( struct CriticalValues *cv,
+		double (*Qinv)( double, double ), unsigned int capacity );
+void crit_fini( struct CriticalValues *cv );
+
+/**
+  * A threshold outside (0,1) disables the table.
+  */
+void crit_set_threshold( struct CriticalValues *cv, double p );
+
+/**
+  * Returns true only if x is far enough below the critical value for nu
+  * that rounding in either could not reverse the comparison.
+  */
+bool crit_falls_short( struct CriticalValues *cv, double x, unsigned int nu );
+
+#endif
+
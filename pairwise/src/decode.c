@@ -0,0 +1,118 @@
+
+/**
+  * pairwise-decode renders the binary output of pairwise (--format binary,
+  * see binfmt.h) in one of the text formats pairwise itself produces.
+  * The rendering differs from pairwise's own only in that the primary
+  * test's log is truncated to BINFMT_MAXLEN_LOG bytes.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <err.h>
+
+#include "mtmatrix.h"
+#include "featpair.h"
+#include "stattest.h"
+#include "analysis.h"
+#include "varfmt.h"
+#include "fixfmt.h"
+#include "binfmt.h"
+
+static const char *MAGIC_FORMAT_ID_STD  = "std";
+static const char *MAGIC_FORMAT_ID_TCGA = "tcga";
+
+static char   **_label = NULL;
+static unsigned _rows  = 0;
+
+static void _freeLabels( void ) {
+	for(unsigned i = 0; i < _rows; i++ )
+		free( _label[i] );
+	free( _label );
+}
+
+
+static void _print_usage( const char *exename, FILE *fp ) {
+	fprintf( fp,
+		"Usage: %s [ -f { %s | %s } ] [ <binary input> [ <output> ] ]\n"
+		"Renders the output of pairwise --format binary as text, by default\n"
+		"in the \"%s\" format. Missing filenames default to stdin/stdout.\n",
+		exename, MAGIC_FORMAT_ID_STD, MAGIC_FORMAT_ID_TCGA, MAGIC_FORMAT_ID_TCGA );
+}
+
+
+int main( int argc, char *argv[] ) {
+
+	void (*emit)( EMITTER_SIG ) = format_tcga;
+	FILE *ifp = stdin;
+	FILE *ofp = stdout;
+	struct feature_pair pair;
+	struct CovariateAnalysis covan;
+	int c;
+
+	while( (c = getopt( argc, argv, "f:h" )) != -1 ) {
+		switch( c ) {
+		case 'f':
+			if( strcmp( MAGIC_FORMAT_ID_STD, optarg ) == 0 )
+				emit = format_standard;
+			else
+			if( strcmp( MAGIC_FORMAT_ID_TCGA, optarg ) == 0 )
+				emit = format_tcga;
+			else
+				errx( -1, "unsupported format \"%s\"", optarg );
+			break;
+		case 'h':
+			_print_usage( argv[0], stdout );
+			exit( EXIT_SUCCESS );
+		default:
+			_print_usage( argv[0], stderr );
+			exit( EXIT_FAILURE );
+		}
+	}
+
+	if( optind < argc ) {
+		ifp = fopen( argv[optind], "r" );
+		if( ifp == NULL )
+			err( -1, "opening input file \"%s\"", argv[optind] );
+	}
+	if( optind+1 < argc ) {
+		ofp = fopen( argv[optind+1], "w" );
+		if( ofp == NULL )
+			err( -1, "opening output file \"%s\"", argv[optind+1] );
+	}
+
+	if( binfmt_read_header( ifp, &_rows ) )
+		errx( -1, "input is not pairwise binary output (version %d)", BINFMT_VERSION );
+
+	_label = calloc( _rows, sizeof(char*) );
+	if( _rows > 0 && _label == NULL )
+		err( -1, "allocating %u row labels", _rows );
+	atexit( _freeLabels );
+	for(unsigned i = 0; i < _rows; i++ ) {
+		_label[i] = binfmt_read_label( ifp );
+		if( _label[i] == NULL )
+			errx( -1, "reading label of row %u", i );
+	}
+
+	memset( &pair, 0, sizeof(pair) );
+	while( binfmt_read( ifp, &pair, &covan ) == 0 ) {
+		const bool LABELED
+			= (unsigned)pair.l.offset < _rows && (unsigned)pair.r.offset < _rows;
+		pair.l.name = LABELED ? _label[ pair.l.offset ] : NULL;
+		pair.r.name = LABELED ? _label[ pair.r.offset ] : NULL;
+		emit( &pair, &covan, ofp );
+	}
+
+	if( ferror( ifp ) )
+		err( -1, "reading input" );
+
+	if( ifp != stdin )
+		fclose( ifp );
+	if( fclose( ofp ) )
+		err( -1, "writing output" );
+	return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,329 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stattest.h"
+struct feature_pair;
+#include "analysis.h"
+#include "statname.h"
+#include "fdr.h"
+
+/**
+  * The bin of p is its IEEE-754 bit pattern with all but the leading
+  * log2(FDR_BINS_PER_OCTAVE) mantissa bits discarded. The pattern is
+  * monotonic in p for p >= 0, so bins are ordered as p-values are.
+  */
+#define BIN_SHIFT (52-8)
+#define ONE_BITS  (UINT64_C(0x3FF0000000000000))
+#define BIN_COUNT ((ONE_BITS >> BIN_SHIFT)+1)
+
+struct fdr_histogram {
+	uint64_t total;
+	uint64_t count[ BIN_COUNT ];
+};
+
+
+static inline unsigned _bin( double p ) {
+	uint64_t u;
+	if( ! ( p < 1.0 ) )
+		return BIN_COUNT-1;
+	if( ! ( p > 0.0 ) )
+		return 0;
+	memcpy( &u, &p, sizeof(u) );
+	return (unsigned)( u >> BIN_SHIFT );
+}
+
+
+/**
+  * The largest p-value that falls in bin k.
+  */
+static double _upper( unsigned k ) {
+	uint64_t u;
+	double p;
+	if( k == BIN_COUNT-1 )
+		return 1.0;
+	u = ( (uint64_t)(k+1) << BIN_SHIFT ) - 1;
+	memcpy( &p, &u, sizeof(p) );
+	return p;
+}
+
+
+struct fdr_histogram *fdr_hist_create( void ) {
+	return calloc( 1, sizeof(struct fdr_histogram) );
+}
+
+
+void fdr_hist_destroy( struct fdr_histogram *h ) {
+	if( h )
+		free( h );
+}
+
+
+void fdr_hist_add( struct fdr_histogram *h, double p ) {
+	h->count[ _bin( p ) ] += 1;
+	h->total += 1;
+}
+
+
+uint64_t fdr_hist_count( const struct fdr_histogram *h ) {
+	return h->total;
+}
+
+
+/**
+  * Only non-empty bins are written, as (index,count) pairs preceded by
+  * their number.
+  */
+int fdr_hist_save( const struct fdr_histogram *h, FILE *fp ) {
+
+	uint32_t n = 0;
+	unsigned k;
+
+	for(k = 0; k < BIN_COUNT; k++ )
+		if( h->count[k] ) n++;
+	if( fwrite( &n, sizeof(n), 1, fp ) != 1 )
+		return -1;
+	for(k = 0; k < BIN_COUNT; k++ ) {
+		if( h->count[k] ) {
+			const uint32_t i = k;
+			if( fwrite( &i, sizeof(i), 1, fp ) != 1
+				|| fwrite( h->count + k, sizeof(uint64_t), 1, fp ) != 1 )
+				return -1;
+		}
+	}
+	return fflush( fp ) ? -1 : 0;
+}
+
+
+int fdr_hist_merge( struct fdr_histogram *h, FILE *fp ) {
+
+	uint32_t n, i;
+	uint64_t c;
+
+	if( fread( &n, sizeof(n), 1, fp ) != 1 )
+		return -1;
+	while( n-- > 0 ) {
+		if( fread( &i, sizeof(i), 1, fp ) != 1
+			|| fread( &c, sizeof(c), 1, fp ) != 1
+			|| i >= BIN_COUNT )
+			return -1;
+		h->count[i] += c;
+		h->total    += c;
+	}
+	return 0;
+}
+
+
+/**
+  * Benjamini-Hochberg rejects the hypotheses with the i_max smallest
+  * p-values where i_max is the largest i for which p_(i) <= (i/N)q.
+  * Of the p-values only the bin upper bounds are known, but whenever the
+  * upper bound of bin k satisfies the inequality with i = (count of p in
+  * bins <= k), so does the largest p in the bin.
+  */
+double fdr_hist_threshold( const struct fdr_histogram *h, double q, uint64_t *rejected ) {
+
+	const double RATIO = q / h->total;
+	double threshold = -1.0;
+	uint64_t R = 0;
+
+	*rejected = 0;
+	for(unsigned k = 0; k < BIN_COUNT; k++ ) {
+		if( h->count[k] == 0 )
+			continue;
+		R += h->count[k];
+		if( _upper( k ) <= R*RATIO ) {
+			threshold = _upper( k );
+			*rejected = R;
+		}
+	}
+	return threshold;
+}
+
+
+struct stat_image {
+	uint8_t  name;
+	uint32_t sample_count;
+	double   value;
+	double   probability;
+} __attribute__((packed));
+
+/**
+  * The fixed-size part of a result image; result.log follows it.
+  */
+struct result_image {
+	uint32_t status;
+	uint8_t  class_l, class_r;
+	float    sign;
+	int32_t  unused[2];
+	struct stat_image stat[3]; // result, waste[0], waste[1]
+	uint8_t  loglen;
+} __attribute__((packed));
+
+
+static void _pack( const struct Statistic *s, struct stat_image *i ) {
+	i->name         = statname_code( s->name );
+	i->sample_count = s->sample_count;
+	i->value        = s->value;
+	i->probability  = s->probability;
+}
+
+
+static void _unpack( const struct stat_image *i, struct Statistic *s ) {
+	s->name         = statname( i->name );
+	s->sample_count = i->sample_count;
+	s->value        = i->value;
+	s->probability  = i->probability;
+	s->extra_used   = 0;
+	strcpy( s->log, "-" );
+}
+
+
+int fdr_result_save( const struct CovariateAnalysis *covan, FILE *fp ) {
+
+	struct result_image img = {
+		.status  = covan->status,
+		.class_l = covan->stat_class.left,
+		.class_r = covan->stat_class.right,
+		.sign    = covan->sign,
+		.unused  = { covan->waste[0].unused, covan->waste[1].unused },
+		.loglen  = strnlen( covan->result.log, MAXLEN_STATRESULT_LOG )
+	};
+
+	_pack( &covan->result,          img.stat + 0 );
+	_pack( &covan->waste[0].result, img.stat + 1 );
+	_pack( &covan->waste[1].result, img.stat + 2 );
+
+	if( fwrite( &img, sizeof(img), 1, fp ) != 1
+		|| fwrite( covan->result.log, 1, img.loglen, fp ) != img.loglen )
+		return -1;
+	return 0;
+}
+
+
+int fdr_result_load( struct CovariateAnalysis *covan, FILE *fp ) {
+
+	struct result_image img;
+
+	if( fread( &img, sizeof(img), 1, fp ) != 1
+		|| img.loglen > MAXLEN_STATRESULT_LOG )
+		return -1;
+
+	covan->status           = img.status;
+	covan->stat_class.left  = img.class_l;
+	covan->stat_class.right = img.class_r;
+	covan->sign             = img.sign;
+	covan->waste[0].unused  = img.unused[0];
+	covan->waste[1].unused  = img.unused[1];
+
+	_unpack( img.stat + 0, &covan->result );
+	_unpack( img.stat + 1, &covan->waste[0].result );
+	_unpack( img.stat + 2, &covan->waste[1].result );
+
+	if( fread( covan->result.log, 1, img.loglen, fp ) != img.loglen )
+		return -1;
+	covan->result.log[ img.loglen ] = 0;
+	return 0;
+}
+
+
+#ifdef _UNITTEST_FDR_
+
+/**
+  * Compares the histogram's threshold with exact Benjamini-Hochberg on
+  * random p-values, uniform but for a spike near 0, split between two
+  * histograms that are merged through a file: ut_fdr [ <q> [ <count> ] ]
+  * The histogram may not reject more than BH, nor fewer than BH less the
+  * p-values sharing a bin with the largest one BH rejects.
+  */
+
+static int _cmp( const void *pvl, const void *pvr ) {
+	const double l = *(const double*)pvl;
+	const double r = *(const double*)pvr;
+	return l < r ? -1 : ( l > r ? +1 : 0 );
+}
+
+int main( int argc, char *argv[] ) {
+
+	const double Q = argc > 1 ? atof( argv[1] ) : 0.05;
+	const size_t N = argc > 2 ? (size_t)atol( argv[2] ) : 100000;
+	struct fdr_histogram *h = fdr_hist_create();
+	struct fdr_histogram *g = fdr_hist_create();
+	double *p = malloc( N*sizeof(double) );
+	size_t i, imax = 0, slack = 0;
+	FILE *fp = tmpfile();
+	int failures = 0;
+	double t;
+	uint64_t rejected;
+
+	if( h == NULL || g == NULL || p == NULL || fp == NULL || N == 0 ) {
+		printf( "setup failed\n" );
+		return EXIT_FAILURE;
+	}
+
+	srand( 1 );
+	for(i = 0; i < N; i++ ) {
+		const double U = ( rand() + 1.0 ) / ( RAND_MAX + 2.0 );
+		p[i] = i % 20 ? U : U*1e-4;
+		fdr_hist_add( i % 2 ? g : h, p[i] );
+	}
+	if( fdr_hist_save( g, fp )
+		|| ( rewind( fp ), fdr_hist_merge( h, fp ) )
+		|| fdr_hist_count( h ) != N ) {
+		printf( "histogram merge failed\n" );
+		failures += 1;
+	}
+	fclose( fp );
+
+	qsort( p, N, sizeof(double), _cmp );
+	for(i = 0; i < N; i++ )
+		if( p[i] <= (i+1)*Q/N ) imax = i+1;
+	for(i = 0; i < imax; i++ )
+		if( _bin( p[i] ) == _bin( p[imax-1] ) ) slack++;
+
+	t = fdr_hist_threshold( h, Q, &rejected );
+	printf( "exact: %zu rejected, max p %.6e\n", imax, imax ? p[imax-1] : 0.0 );
+	printf( "histogram: %llu rejected, threshold %.6e\n",
+		(unsigned long long)rejected, t );
+	if( rejected > imax || rejected + slack < imax ) {
+		printf( "histogram rejected outside [%zu,%zu]\n", imax - slack, imax );
+		failures += 1;
+	}
+
+	// A result image must read back as the emitters would see it.
+	{
+		struct CovariateAnalysis in, out;
+		FILE *fp = tmpfile();
+		memset( &in,  0, sizeof(in) );
+		memset( &out, 0, sizeof(out) );
+		in.sign = -0.5;
+		in.waste[1].unused = 7;
+		in.result.name = "Fisher_Exact";
+		in.result.probability = 1e-9;
+		in.waste[0].result.name = "unheard of";
+		strcpy( in.result.log, "culled 2 cells" );
+		if( fp == NULL
+			|| fdr_result_save( &in, fp )
+			|| ( rewind( fp ), fdr_result_load( &out, fp ) )
+			|| strcmp( out.result.name, in.result.name )
+			|| strcmp( out.waste[0].result.name, "?" )
+			|| strcmp( out.result.log, in.result.log )
+			|| out.result.probability != in.result.probability
+			|| out.waste[1].unused != 7 || out.sign != -0.5 ) {
+			printf( "result image round-trip failed\n" );
+			failures += 1;
+		}
+		if( fp ) fclose( fp );
+	}
+
+	free( p );
+	fdr_hist_destroy( g );
+	fdr_hist_destroy( h );
+	if( failures == 0 )
+		printf( "ok\n" );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
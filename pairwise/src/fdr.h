@@ -0,0 +1,67 @@
+
+#ifndef _fdr_h_
+#define _fdr_h_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+  * A fixed-size, log-scale histogram of p-values from which the
+  * Benjamini-Hochberg p-value threshold can be determined without
+  * retaining the individual p-values.
+  *
+  * Bins are delimited by the leading bits of the IEEE-754 representation
+  * of p, so each octave of p-values is divided into FDR_BINS_PER_OCTAVE
+  * bins of equal width and the threshold is resolved to within a relative
+  * error of 1/FDR_BINS_PER_OCTAVE (~0.4%).
+  */
+
+#define FDR_BINS_PER_OCTAVE (256)
+
+struct fdr_histogram;
+
+struct fdr_histogram *fdr_hist_create( void );
+void fdr_hist_destroy( struct fdr_histogram * );
+
+/**
+  * Count one test with p-value p (in [0,1]; p > 1 counts as 1).
+  */
+void fdr_hist_add( struct fdr_histogram *, double p );
+
+uint64_t fdr_hist_count( const struct fdr_histogram * );
+
+/**
+  * Serialization so that histograms accumulated in other processes can
+  * be merged: fdr_hist_merge adds a histogram written by fdr_hist_save.
+  * Both return non-zero on I/O error.
+  */
+int fdr_hist_save( const struct fdr_histogram *, FILE * );
+int fdr_hist_merge( struct fdr_histogram *, FILE * );
+
+/**
+  * Returns a p-value threshold t such that rejecting every hypothesis
+  * with p <= t satisfies the Benjamini-Hochberg criterion at level q, or
+  * a negative value if no hypothesis is rejected. *rejected receives the
+  * number of counted tests with p <= t.
+  *
+  * Since only bin boundaries are known, t may fall short of the exact BH
+  * threshold by up to the resolution of a bin, never exceed it.
+  */
+double fdr_hist_threshold( const struct fdr_histogram *, double q, uint64_t *rejected );
+
+/**
+  * A compact binary image of the parts of a CovariateAnalysis that the
+  * emitters use (status, classes, sign, the primary and "waste" tests'
+  * names, counts, values and p-values, and the primary test's log).
+  * Images are variable in length since only the used part of the log is
+  * written. Statistic names are reduced to codes; a name that is not
+  * known to statname.c reads back as "?".
+  *
+  * Both return non-zero on I/O error (or, when loading, end of file).
+  */
+struct CovariateAnalysis;
+int fdr_result_save( const struct CovariateAnalysis *, FILE * );
+int fdr_result_load( struct CovariateAnalysis *, FILE * );
+
+#endif
+
@@ -18,6 +18,39 @@
 #include "analysis.h"
 #include "fixfmt.h"
 #include "varfmt.h" // even these legacy methods must follow the new EMITTER_SIG
+#include "numfmt.h"
+
+/**
+  * Each line but its feature names is assembled in a local buffer by
+  * numfmt (see numfmt.h), which reproduces printf's output, and passed
+  * to stdio in one piece.
+  */
+#define MAXLEN_LINE (8*NUMFMT_MAXLEN+MAXLEN_STATRESULT_LOG+64)
+
+static char *_puts( char *pc, const char *s ) {
+	const size_t n = strlen( s );
+	memcpy( pc, s, n );
+	return pc + n;
+}
+
+
+/**
+  * Feature names if both are known, otherwise their offsets.
+  */
+static char *_features( FEATURE_PAIR_T *pair, char *pc, FILE *fp ) {
+	if( pair->l.name != NULL && pair->r.name != NULL ) {
+		fputs( pair->l.name, fp );
+		fputc( '\t', fp );
+		fputs( pair->r.name, fp );
+		fputc( '\t', fp );
+	} else {
+		pc = numfmt_int( pc, pair->l.offset );
+		*pc++ = '\t';
+		pc = numfmt_int( pc, pair->r.offset );
+		*pc++ = '\t';
+	}
+	return pc;
+}
 /**
   * "Sheila's format"
   * 1  -- feature A
@@ -75,27 +108,29 @@ void format_tcga( EMITTER_SIG ) {
 	const int u1
 		= covan->waste[1].unused;
 
-	if( pair->l.name != NULL && pair->r.name != NULL ) {
-		fprintf( fp, "%s\t%s\t",  pair->l.name,   pair->r.name );
-	} else {
-		fprintf( fp, "%d\t%d\t",  pair->l.offset, pair->r.offset );
-	}
-
-	fprintf( fp, 
-		"%s\t"
-		"%+.2f\t"
-		"%d\t"
-		"%.3f\t"
-		"%d\t%.3f\t"
-		"%d\t%.3f\t"
-		"%s\n", 
-		COVAR_TYPE_STR( covan->stat_class.left, covan->stat_class.right ),
-		covan->sign, 
-		covan->result.sample_count, 
-		_clamped_neglog( covan->result.probability ),
-		u0, u0 > 0 ? _clamped_neglog( covan->waste[0].result.probability ) : 0.0,
-		u1, u1 > 0 ? _clamped_neglog( covan->waste[1].result.probability ) : 0.0,
-		covan->result.log );
+	char line[ MAXLEN_LINE ];
+	char *pc = _features( pair, line, fp );
+
+	pc = _puts( pc, COVAR_TYPE_STR( covan->stat_class.left, covan->stat_class.right ) );
+	*pc++ = '\t';
+	pc = numfmt_fixed( pc, covan->sign, 2, true );
+	*pc++ = '\t';
+	pc = numfmt_int( pc, covan->result.sample_count );
+	*pc++ = '\t';
+	pc = numfmt_fixed( pc, _clamped_neglog( covan->result.probability ), 3, false );
+	*pc++ = '\t';
+	pc = numfmt_int( pc, u0 );
+	*pc++ = '\t';
+	pc = numfmt_fixed( pc, u0 > 0 ? _clamped_neglog( covan->waste[0].result.probability ) : 0.0, 3, false );
+	*pc++ = '\t';
+	pc = numfmt_int( pc, u1 );
+	*pc++ = '\t';
+	pc = numfmt_fixed( pc, u1 > 0 ? _clamped_neglog( covan->waste[1].result.probability ) : 0.0, 3, false );
+	*pc++ = '\t';
+	pc = _puts( pc, covan->result.log );
+	*pc++ = '\n';
+
+	fwrite( line, 1, pc - line, fp );
 }
 
 
@@ -124,27 +159,31 @@ void format_tcga( EMITTER_SIG ) {
   */
 void format_standard( EMITTER_SIG ) {
 
-	if( pair->l.name != NULL && pair->r.name != NULL ) {
-		fprintf( fp, "%s\t%s\t",  pair->l.name,   pair->r.name );
-	} else {
-		fprintf( fp, "%d\t%d\t",  pair->l.offset, pair->r.offset);
-	}
-
-	fprintf( fp, 
-		"%s:%s\t"
-		"%+.2f\t"
-		"%d\t"
-		"%.3e\t"
-		"%d\t%.3e\t"
-		"%d\t%.3e\t"
-		"%s\n", 
-		COVAR_TYPE_STR( covan->stat_class.left, covan->stat_class.right ), covan->result.name,
-		covan->sign, 
-		covan->result.sample_count, 
-		covan->result.probability,
-		covan->waste[0].unused, covan->waste[0].result.probability,
-		covan->waste[1].unused, covan->waste[1].result.probability,
-		covan->result.log );
+	char line[ MAXLEN_LINE ];
+	char *pc = _features( pair, line, fp );
+
+	pc = _puts( pc, COVAR_TYPE_STR( covan->stat_class.left, covan->stat_class.right ) );
+	*pc++ = ':';
+	pc = _puts( pc, covan->result.name );
+	*pc++ = '\t';
+	pc = numfmt_fixed( pc, covan->sign, 2, true );
+	*pc++ = '\t';
+	pc = numfmt_int( pc, covan->result.sample_count );
+	*pc++ = '\t';
+	pc = numfmt_exp( pc, covan->result.probability, 3, false );
+	*pc++ = '\t';
+	pc = numfmt_int( pc, covan->waste[0].unused );
+	*pc++ = '\t';
+	pc = numfmt_exp( pc, covan->waste[0].result.probability, 3, false );
+	*pc++ = '\t';
+	pc = numfmt_int( pc, covan->waste[1].unused );
+	*pc++ = '\t';
+	pc = numfmt_exp( pc, covan->waste[1].result.probability, 3, false );
+	*pc++ = '\t';
+	pc = _puts( pc, covan->result.log );
+	*pc++ = '\n';
+
+	fwrite( line, 1, pc - line, fp );
 }
 
 
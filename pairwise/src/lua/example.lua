@@ -52,6 +52,36 @@ function one_versus_all( matrix_row_count )
 end
 
 
+-- Generators producing many pairs should yield them in blocks, since
+-- every yield costs a coroutine resumption. A yield may be any of:
+--   (i,j)              a single pair
+--   (i,j_begin,j_end)  the pairs (i,j) for j_begin <= j < j_end
+--   {i1,j1,i2,j2...}   a table of pairs
+--   a string           packed native 32-bit pairs (string.pack("i4i4...",...))
+-- This is the "all pairs" case again, one row of the triangle per yield.
+
+function all_pairs_by_row( matrix_row_count )
+	for i = 0,(matrix_row_count-2) do
+		coroutine.yield (i,i+1,matrix_row_count)
+	end
+end
+
+-- ...and the cross_product above, all pairs in one yield.
+
+function cross_product_table( matrix_row_count )
+	local L = {3,5,7,11}
+	local R = {2,4,6,8}
+	local list = {}
+	for i,l in ipairs(L) do
+		for j,r in ipairs(R) do
+			list[#list+1] = l
+			list[#list+1] = r
+		end
+	end
+	coroutine.yield( list )
+end
+
+
 -- A 2-arg mathematical function (irrelevant to pairwise. part of
 -- testing).
 
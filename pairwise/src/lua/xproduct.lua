@@ -18,13 +18,16 @@
 -- rows constituting the first group because pairwise only passes the
 -- total row count to the script.
 
+--
+-- Each yield describes a whole row of the cross-product: the pairs
+-- (i,j) for j in [first_group_size,matrix_row_count). Yielding pairs
+-- one at a time, i.e. coroutine.yield( i, j ), also works but costs a
+-- coroutine resumption per pair.
+
 function pair_generator( matrix_row_count )
 	local first_group_size = 5
 	for i=0,first_group_size-1 do
-		for j=first_group_size,matrix_row_count-1 do
-			coroutine.yield( i, j )
-			--print( i, j )
-		end
+		coroutine.yield( i, first_group_size, matrix_row_count )
 	end
 end
 
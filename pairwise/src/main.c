@@ -47,12 +47,18 @@
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <ctype.h>
 #include <err.h>
+#include <limits.h> // PIPE_BUF
 #include <alloca.h>
 
 #include <gsl/gsl_errno.h>
@@ -64,9 +70,17 @@
 #include "featpair.h"
 #include "stattest.h"
 #include "analysis.h"
+#include "rowcache.h"
 #include "varfmt.h"
 #include "fixfmt.h"
 #include "limits.h"
+#include "fdr.h"
+#include "binfmt.h"
+#include "topk.h"
+#include "pairsel.h"
+#include "shard.h"
+#include "checkpoint.h"
+#include "telemetry.h"
 #include "version.h"
 
 #ifdef HAVE_LUA
@@ -90,6 +104,7 @@ extern int get_base10_ints( FILE *fp, int *index, int n );
 static const char *MAGIC_SUFFIX         = "-www";
 static const char *MAGIC_FORMAT_ID_STD  = "std";
 static const char *MAGIC_FORMAT_ID_TCGA = "tcga";
+static const char *MAGIC_FORMAT_ID_BIN  = "binary";
 
 static const char *TYPE_PARSER_INFER    = "auto";
 
@@ -111,6 +126,24 @@ static double arg_q_value = 0.0;
   */
 static double opt_fdr_cache_threshold = 0.5;
 
+/**
+  * Trade disk for CPU: cache the (compact) complete result of each test
+  * rather than just its p-value, so that post-processing merely emits
+  * the results that pass FDR control instead of recomputing them.
+  */
+static bool   opt_fdr_store_results   = false;
+
+/**
+  * Top-K mode: rather than emitting every significant result, retain only
+  * the K strongest for each feature and emit those, grouped by feature,
+  * once analysis is complete. Strength is either a small p-value or a
+  * large |sign|.
+  */
+static unsigned opt_top_k             = 0;
+static bool     opt_top_by_sign       = false;
+static const char *TOP_BY_P           = "p";
+static const char *TOP_BY_SIGN        = "sign";
+
 
 // No default on opt_script because looking for a "default.lua" script
 // or any *.lua file invites all sorts of confusion with the defaults
@@ -123,6 +156,8 @@ static const char *opt_preproc_matrix  = NULL; // ...or optarg
 static       char *opt_single_pair     = NULL; // non-const because it's split
 
 static const char *opt_pairlist_source = NULL;
+static const char *opt_select          = NULL; // see pairsel.h
+static struct pairsel *_pairsel        = NULL;
 
 static const char *NO_ROW_LABELS       = "matrix has no row labels";
 static bool        opt_by_name         = false;
@@ -134,6 +169,58 @@ static bool        opt_dry_run         = false;
 static const char *opt_format          = "tcga";
 static bool     opt_warnings_are_fatal = false;
 
+/**
+  * All-pairs analysis may be divided among several worker processes.
+  * Unless opt_unordered is set, their output is reassembled in exactly
+  * the order a single process would have produced it.
+  */
+static int         opt_threads         = 1;
+static bool        opt_unordered       = false;
+
+/**
+  * Emit all-pairs and cross-product results in tile order (see _tiling)
+  * rather than strictly by left row. Tiles are used regardless when the
+  * analysis function does not emit anything in iteration order.
+  */
+static bool        opt_tiled           = false;
+
+/**
+  * With --shard i/N, this process analyzes only the i'th of N contiguous
+  * ranges of left rows, [_shard_first,_shard_last), chosen to be of equal
+  * modeled cost (see shard.h), and describes what it did in a manifest.
+  */
+static int         opt_shard           = 0;
+static int         opt_shards          = 0; // ...0 when not sharding
+static int         _shard_first        = 0;
+static int         _shard_last         = 0;
+static double      _shard_cost         = 0.0;
+
+/**
+  * Serial all-pairs analysis can be checkpointed (see checkpoint.h) at
+  * the start of left rows (or blocks of them when tiled), and resumed
+  * from the last checkpoint. A checkpoint is written at most every
+  * CHECKPOINT_SECONDS, and on interruption.
+  */
+#define CHECKPOINT_SECONDS (60)
+static const char *opt_checkpoint      = NULL;
+static bool        opt_resume          = false;
+static struct checkpoint _checkpoint;
+static time_t      _checkpoint_time    = 0;
+static int         _resume_row         = -1;
+
+/**
+  * With --telemetry analyses are counted and timed (see telemetry.h),
+  * progress is reported every opt_telemetry seconds (if positive) and
+  * on SIGUSR1, and a JSON summary goes to stderr at the end.
+  */
+static int         opt_telemetry       = -1;
+
+/**
+  * Bound (in MiB) on the per-row precomputations of the row cache; rows
+  * beyond it, or all rows if 0, are analyzed uncached.
+  */
+static int         opt_row_cache       = 1024;
+
 /**
   * Primary output and critical error messages.
   */
@@ -153,6 +240,7 @@ static int opt_verbosity = V_ESSENTIAL;
 
 #ifdef _DEBUG
 static bool  dbg_silent               = false;
+static bool  dbg_no_prefilter         = false; // ...see _prefilter_enabled
 #endif
 
 #define GLOBAL
@@ -202,9 +290,113 @@ static int _load_script( const char *source, lua_State *state ) {
 		: luaL_dostring( state, source );
 }
 
+
+/**
+  * A pair generator coroutine may yield pairs of (0-based) row offsets
+  * one at a time or, to amortize the cost of resuming it, in blocks:
+  * 1. (l, r)                   a single pair
+  * 2. (l, r_begin, r_end)      pairs (l,r) for r in [r_begin, r_end)
+  * 3. { l1, r1, l2, r2, ... }  a (flat) table of pairs
+  * 4. a string or userdata     packed native int32_t pairs (l1,r1,...),
+  *                             e.g. from string.pack
+  * This visits each pair of the most recent yield (on L's stack) in order
+  * and then clears the stack. It stops early and returns visit's result
+  * if that is non-zero; it returns -1 if the yield was none of the above.
+  * Ranges are clipped to [0,rows) so that one bad range can't produce a
+  * flood of invalid pairs; single pairs are left to visit to validate.
+  */
+typedef int (*PAIR_VISITOR)( int l, int r, void *context );
+
+static int _lua_visit_yield( lua_State *L, int rows, PAIR_VISITOR visit, void *context ) {
+
+	const int N = lua_gettop( L );
+	int isnum, result = 0;
+
+	if( N == 2 || N == 3 ) {
+
+		int l, b = 0, e = 0;
+		l = lua_tonumberx( L, 1, &isnum );
+		if( isnum )
+			b = lua_tonumberx( L, 2, &isnum );
+		if( isnum )
+			e = N == 3 ? lua_tonumberx( L, 3, &isnum ) : b + 1;
+		if( ! isnum )
+			result = -1;
+		else
+		if( N == 3 ) {
+			if( b < 0 )
+				b = 0;
+			if( e > rows )
+				e = rows;
+		}
+		for(int r = b; r < e && result == 0; r++ )
+			result = visit( l, r, context );
+
+	} else
+	if( N == 1 && lua_type( L, 1 ) == LUA_TTABLE ) {
+
+		const size_t LEN = lua_rawlen( L, 1 );
+		if( LEN % 2 )
+			result = -1;
+		for(size_t i = 1; i < LEN && result == 0; i += 2 ) {
+			int l, r = 0;
+			lua_rawgeti( L, 1, i   );
+			lua_rawgeti( L, 1, i+1 );
+			l = lua_tonumberx( L, -2, &isnum );
+			if( isnum )
+				r = lua_tonumberx( L, -1, &isnum );
+			lua_pop( L, 2 );
+			result = isnum ? visit( l, r, context ) : -1;
+		}
+
+	} else
+	if( N == 1 && ( lua_type( L, 1 ) == LUA_TSTRING || lua_type( L, 1 ) == LUA_TUSERDATA ) ) {
+
+		const char *buf;
+		size_t len;
+		if( lua_type( L, 1 ) == LUA_TSTRING )
+			buf = lua_tolstring( L, 1, &len );
+		else {
+			buf = lua_touserdata( L, 1 );
+			len = lua_rawlen( L, 1 );
+		}
+		if( len % ( 2*sizeof(int32_t) ) )
+			result = -1;
+		for(size_t i = 0; i + 2*sizeof(int32_t) <= len && result == 0; i += 2*sizeof(int32_t) ) {
+			int32_t pair[2];
+			memcpy( pair, buf + i, sizeof(pair) ); // ...no alignment assumed
+			result = visit( pair[0], pair[1], context );
+		}
+
+	} else
+		result = -1;
+
+	lua_settop( L, 0 );
+	return result;
+}
+
+
+static int _print_generated_pair( int l, int r, void *context ) {
+	fprintf( (FILE*)context, "%d %d\n", l, r );
+	return 0;
+}
+
 #endif
 
 static FILE *_fp_output = NULL;
+
+/**
+  * Emitters pass output to stdio in many small pieces; a large buffer
+  * makes for few, large writes (except to terminals).
+  */
+#define OUTPUT_BUFFER_SIZE (1<<20)
+
+/**
+  * Commentary ("# ..." lines) accompanies tabular output but must not
+  * corrupt binary or JSON output, so it is diverted to stderr for those.
+  */
+static FILE *_fp_notes  = NULL;
+static bool  _structured_output = false;
 static void (*_emit)( EMITTER_SIG ) = format_tcga;
 
 static bool _sigint_received = false;
@@ -221,8 +413,20 @@ static bool _sigint_received = false;
   * counted because it is assumed that that is known to the caller who
   * set up the run, after all.
   */
-static unsigned _insignificant = 0;
-static unsigned _untested      = 0;
+static uint64_t _insignificant = 0;
+static uint64_t _untested      = 0;
+
+/**
+  * Telemetry is NULL unless requested. Concurrent workers count into
+  * slots of memory shared with the parent (see _telemetry_fork) so that
+  * the parent can report on the whole run while they work.
+  */
+static struct telemetry  _telemetry_total;
+static struct telemetry *_telemetry         = NULL;
+static struct telemetry *_telemetry_workers = NULL;
+static int               _telemetry_worker_count = 0;
+static struct telemetry_epoch _telemetry_epoch;
+static volatile sig_atomic_t  _telemetry_due = 0;
 
 /**
   * The binary matrix is accessed at runtime through this variable.
@@ -238,10 +442,75 @@ static void _freeMatrix( void ) {
 	_matrix.destroy( &_matrix );
 }
 
+/**
+  * Per-row precomputations shared by all analyses (see rowcache.h).
+  */
+static struct RowCache *_rowcache = NULL;
+
+static void _freeRowCache( void ) {
+	rowcache_destroy( _rowcache );
+	_rowcache = NULL;
+}
+
 static void _interrupt( int n ) {
 	_sigint_received = true;
 }
 
+static void _telemetry_signal( int n ) {
+	_telemetry_due = 1;
+}
+
+/**
+  * Progress is reported synchronously, by the analysis loop or the wait
+  * for workers, when a signal has made it due. Signals must interrupt
+  * (rather than restart) the wait, but not stdio elsewhere.
+  */
+static void _telemetry_signals( bool restart ) {
+	struct sigaction sa;
+	memset( &sa, 0, sizeof(sa) );
+	sa.sa_handler = _telemetry_signal;
+	sa.sa_flags   = restart ? SA_RESTART : 0;
+	sigemptyset( &sa.sa_mask );
+	if( sigaction( SIGUSR1, &sa, NULL ) || sigaction( SIGALRM, &sa, NULL ) )
+		warn( "failed installing telemetry signal handlers" );
+}
+
+static void _telemetry_report( void ) {
+	struct telemetry sum = *_telemetry;
+	_telemetry_due = 0;
+	for(int w = 0; w < _telemetry_worker_count; w++ )
+		telemetry_merge( &sum, _telemetry_workers + w );
+	telemetry_progress( stderr, &sum, &_telemetry_epoch );
+}
+
+/**
+  * All analysis in this file goes through this...
+  */
+static void _covan_exec( const struct feature_pair *pair, struct CovariateAnalysis *covan ) {
+	covan_exec( pair, covan );
+	if( _telemetry ) {
+		telemetry_count( _telemetry, covan );
+		if( _telemetry_due )
+			_telemetry_report();
+	}
+}
+
+/**
+  * ...except the recomputation of results already analyzed (and counted)
+  * once, by FDR control and --top-k, which is only counted as a repeat.
+  */
+static void _covan_repeat( const struct feature_pair *pair, struct CovariateAnalysis *covan ) {
+	if( _telemetry ) {
+		covan_set_telemetry( NULL );
+		covan_exec( pair, covan );
+		covan_set_telemetry( _telemetry );
+		_telemetry->repeated += 1;
+		if( _telemetry_due )
+			_telemetry_report();
+	} else
+		covan_exec( pair, covan );
+}
+
 /***************************************************************************
  * Pipeline
  * A) explicit pairs
@@ -271,7 +540,7 @@ static void _filter( ANALYSIS_FN_SIG ) {
 
 	struct CovariateAnalysis covan;
 	memset( &covan, 0, sizeof(covan) );
-	covan_exec( pair, &covan );
+	_covan_exec( pair, &covan );
 
 	// One last thing to check before filtering to insure corner cases
 	// don't fall through the following conditionals....
@@ -303,6 +572,60 @@ static void _filter( ANALYSIS_FN_SIG ) {
 
 static ANALYSIS_FN _analyze = _filter;
 
+/***************************************************************************
+  * Top-K
+  * The collector retains (strength, partner offset) for each significant
+  * result instead of emitting it. In all-pairs each result is offered to
+  * both of its features; in cross-products only to the disk-resident one,
+  * whose results are complete (and emitted) before the next block of
+  * rows is read, so a few reusable rows suffice. Retained pairs are
+  * recomputed when they are finally emitted, which costs at most rows*K
+  * analyses.
+  */
+
+static struct topk *_topk = NULL;
+
+/**
+  * Cross-products retain results for one block of left rows at a time,
+  * (see _tiling) and blocks are aligned to multiples of their size.
+  */
+#define TOPK_CROSS_ROWS (32)
+
+static void _freeTopK( void ) {
+	topk_destroy( _topk );
+	_topk = NULL;
+}
+
+
+static void _topk_collect( ANALYSIS_FN_SIG ) {
+
+	struct CovariateAnalysis covan;
+	double strength;
+	memset( &covan, 0, sizeof(covan) );
+	_covan_exec( pair, &covan );
+
+	if( ! ( isfinite( covan.result.probability ) && fpclassify( covan.result.probability ) != FP_SUBNORMAL ) ) {
+		covan.result.probability = 1.0;
+		covan.status             = COVAN_E_MATH;
+	}
+
+	if( ( covan.status & opt_status_mask ) == 0 ) {
+		if( covan.result.probability <= opt_p_value ) {
+			strength = opt_top_by_sign
+				? fabs( covan.sign )
+				: -covan.result.probability;
+			if( opt_preproc_matrix )
+				topk_offer( _topk, pair->l.offset % TOPK_CROSS_ROWS, pair->r.offset, strength );
+			else {
+				topk_offer( _topk, pair->l.offset, pair->r.offset, strength );
+				topk_offer( _topk, pair->r.offset, pair->l.offset, strength );
+			}
+		} else
+			_insignificant += 1;
+	} else
+		_untested += 1;
+}
+
 static void _error_handler(const char * reason,
                         const char * file,
                         int line,
@@ -316,25 +639,64 @@ static void _error_handler(const char * reason,
 
 static FILE *_fdr_cache_fp = NULL;
 
+/**
+  * Named only when checkpointing, as <checkpoint>.fdr
+  */
+#define FDR_CACHE_SUFFIX ".fdr"
+static char *_fdr_cache_name = NULL;
+
 /***************************************************************************
   * FDR processing
-  * This currently involves some redundant computation in the interest of
-  * simplicity. Since the whole point of FDR is to limit output, though, the
-  * actual runtime cost should be bearabe. Specifically...
+  * Two passes are made over the (selected) pairs. The first determines
+  * the p-value threshold appropriate for the given q-value; the second
+  * emits the pairs that pass it. How depends on whether the pairs can be
+  * regenerated:
+  *
+  * All-pairs analysis (the case with potentially billions of pairs) keeps
+  * only a fixed-size histogram of first-pass p-values (see fdr.h), from
+  * which the threshold follows, and then simply repeats the analysis,
+  * emitting pairs under the threshold. No per-pair state is kept.
   *
-  * 1. Two passes are made over the (selected) pairs.
-  * 2. The offsets and p-value of the result of the first pass are cached
-  *    in a tmp file.
-  * 3. After completion, the p-value appropriate for the given q-value is
-  *    determined and results from the 1st pass with sufficiently low
-  *    p-values are recalculated and, this time, fully emitted.
+  * Other pair sources (pair lists possibly read from pipes, Lua
+  * generators, cross-products) cache the offsets and p-value of each
+  * result in a tmp file which is sorted after the first pass. Results
+  * with sufficiently low p-values are recalculated and, this time, fully
+  * emitted. Pairs with very high p-values are merely counted.
   *
-  * TODO: Optimization: Pairs with very high p-values (i.e. *clearly*
-  * uninteresting pairs) can be omitted from the cache even in the first
-  * pass and merely counted as tests since their recomputation will *almost*
-  * certainly, depending ultimately on the threshold, not be required.
+  * With opt_fdr_store_results every pair source, all-pairs included,
+  * takes the latter path, and each cached record is followed by an image
+  * of the complete result (see fdr.h) which post-processing emits as is.
   */
 
+static struct fdr_histogram *_fdr_hist = NULL;
+
+/**
+  * Emission threshold of the second all-pairs pass and the largest
+  * p-value actually emitted (per chunk in concurrent analysis).
+  */
+static double _fdr_threshold = 0.0;
+static double _fdr_max_p     = -1.0;
+
+static void _freeFDRHistogram( void ) {
+	fdr_hist_destroy( _fdr_hist );
+	_fdr_hist = NULL;
+}
+
+
+/**
+  * Only the all-pairs iteration can be repeated at will.
+  */
+static bool _fdr_all_pairs( void ) {
+#ifdef HAVE_LUA
+	if( opt_coroutine )
+		return false;
+#endif
+	return opt_preproc_matrix == NULL
+		&& opt_single_pair == NULL
+		&& opt_pairlist_source == NULL
+		&& opt_select == NULL;
+}
+
 struct FDRCacheRecord {
 	double p;
 	unsigned a,b;
@@ -342,6 +704,16 @@ struct FDRCacheRecord {
 typedef struct FDRCacheRecord FDRCacheRecord_t;
 typedef const FDRCacheRecord_t FDRCACHERECORD_T;
 
+/**
+  * Sort key of a cached record followed by a result image: the image's
+  * location in the cache.
+  */
+struct FDRImageIndex {
+	double p;
+	unsigned a,b;
+	long offset;
+};
+
 static int _cmp_fdr_cache_records( const void *pvl, const void *pvr ) {
 
 	FDRCACHERECORD_T *l = (FDRCACHERECORD_T*)pvl;
@@ -367,7 +739,7 @@ static void _fdr_cache( ANALYSIS_FN_SIG ) {
 	struct CovariateAnalysis covan;
 	memset( &covan, 0, sizeof(covan) );
 
-	covan_exec( pair, &covan );
+	_covan_exec( pair, &covan );
 
 	// Failed tests (for reasons of one kind of degeneracy or another)
 	// do not contribute to the calculation of the p-value threshold.
@@ -385,12 +757,51 @@ static void _fdr_cache( ANALYSIS_FN_SIG ) {
 				.b = pair->r.offset
 			};
 			fwrite( &rec, sizeof(rec), 1, _fdr_cache_fp );
+			if( opt_fdr_store_results )
+				fdr_result_save( &covan, _fdr_cache_fp );
 		} else
 			_fdr_uncached_count += 1;
 	}
 }
 
 
+/**
+  * First all-pairs pass: only the distribution of p-values is recorded.
+  * Failed tests do not contribute to the calculation of the threshold.
+  */
+static void _fdr_count( ANALYSIS_FN_SIG ) {
+
+	struct CovariateAnalysis covan;
+	memset( &covan, 0, sizeof(covan) );
+
+	_covan_exec( pair, &covan );
+
+	if( covan.status == 0
+		&& isfinite( covan.result.probability ) )
+		fdr_hist_add( _fdr_hist, covan.result.probability );
+}
+
+
+/**
+  * Second all-pairs pass: emit exactly the pairs the first pass counted
+  * at or under the threshold.
+  */
+static void _fdr_emit( ANALYSIS_FN_SIG ) {
+
+	struct CovariateAnalysis covan;
+	memset( &covan, 0, sizeof(covan) );
+
+	_covan_repeat( pair, &covan );
+
+	if( covan.status == 0
+		&& covan.result.probability <= _fdr_threshold ) {
+		_emit( pair, &covan, _fp_output );
+		if( _fdr_max_p < covan.result.probability )
+			_fdr_max_p = covan.result.probability;
+	}
+}
+
+
 /**
   * This implements the Benjamini-Hochberg algorithm as described on
   * page 49 of "Large-Scale Inference", Bradley Efron, Cambridge.
@@ -419,7 +830,7 @@ static void _fdr_postprocess( FILE *cache, double Q, FILE *final_output, bool mi
 
 	const double RATIO
 		= Q/TESTED_COUNT;
-	int i = 0;
+	unsigned i, imax = 0;
 
 	// Load and sort the cached test records...
 
@@ -427,18 +838,24 @@ static void _fdr_postprocess( FILE *cache, double Q, FILE *final_output, bool mi
 	fread( sortbuf, sizeof(struct FDRCacheRecord), CACHED_COUNT, cache );
 	qsort( sortbuf, CACHED_COUNT, sizeof(struct FDRCacheRecord), _cmp_fdr_cache_records );
 
+	for(i = 0; i < CACHED_COUNT; i++ ) {
+		if( sortbuf[i].p <= (i+1)*RATIO )
+			imax = i+1;
+	}
+
 	// ...and recompute the full statistics of all earlier tests that
 	// pass the now-established p-value threshold.
 
 	prec = sortbuf;
+	i    = 0;
 	if( minimal_output ) {
 
-		while( prec->p <= (i+1)*RATIO && i < CACHED_COUNT) 
+		for(; i < imax; i++, prec++ )
 			fprintf( final_output, "%d\t%d\t%.3e\n", prec->a, prec->b, prec->p );
 
 	} else {
 
-		while( prec->p <= (i+1)*RATIO && i < CACHED_COUNT) {
+		while( i < imax ) {
 		
 			struct feature_pair fpair;
 			struct CovariateAnalysis covan;
@@ -448,7 +865,7 @@ static void _fdr_postprocess( FILE *cache, double Q, FILE *final_output, bool mi
 			fpair.r.offset = prec->b;
 			fetch_by_offset( &_matrix, &fpair );
 
-			covan_exec( &fpair, &covan );
+			_covan_repeat( &fpair, &covan );
 
 			// At this point emission is unconditional; FDR control has
 			// already filtered all that will be filtered...
@@ -470,143 +887,544 @@ static void _fdr_postprocess( FILE *cache, double Q, FILE *final_output, bool mi
 
 	if( opt_verbosity >= V_WARNINGS ) {
 		if( i > 0 )
-			fprintf( final_output, "# max p-value %.3f\n", sortbuf[i-1].p );
+			fprintf( _fp_notes, "# max p-value %.3f\n", sortbuf[i-1].p );
 		else
-			fprintf( final_output, "# no values passed FDR control\n" );
+			fprintf( _fp_notes, "# no values passed FDR control\n" );
 	}
 	if( sortbuf )
 		free( sortbuf );
 }
 
 
-/***************************************************************************
-  * Row selection iterators
-  * Each of these 5 methods takes arguments specific to the
-  * source of input pairs and uses file static state for output.
-  * All but the first delegate to the _analyze function which may be a
-  * filter on immediate-mode output or a caching function for FDR.
-  */
+static int _cmp_fdr_image_index( const void *pvl, const void *pvr ) {
 
-// BEGIN:RSI
+	const struct FDRImageIndex *l = (const struct FDRImageIndex*)pvl;
+	const struct FDRImageIndex *r = (const struct FDRImageIndex*)pvr;
 
-static int /*ANCP*/ _analyze_cross_product(
-		const struct mtm_matrix_header *hdr, FILE *fp[] ) {
+	if( l->p == r->p )
+		return  0;
+	else
+		return (l->p < r->p) ? -1 : +1;
+}
 
-	bool completed = true;
-	struct feature_pair fpair;
-	struct mtm_row *rrid;
 
-	/**
-	  * Location of left data won't change: same buffer, same offset for
-	  * duration of iteration.
-	  */
-	fpair.l.data
-		= calloc( _matrix.columns, sizeof(mtm_int_t) );
+/**
+  * Benjamini-Hochberg as above on a cache of records each followed by
+  * its result image. Only the records are retained (with the location of
+  * their images) for sorting; the images of the results that pass are
+  * then read back and emitted without recomputation.
+  */
+static void _fdr_postprocess_stored( FILE *cache, double Q, FILE *final_output ) {
 
-	/**
-	  * TODO: I actually could enumerate the disk-resident matrix'
-	  * row names just as I do the descriptors. In general, the
-	  * pervasive assumption throughout this source that the input
-	  * is exactly one matrix needs to be revisited.
-	  */
-	fpair.l.name = NULL;
+	const long END = ftell( cache );
 
-	if( fpair.l.data == NULL )
-		return -1;
+	struct FDRImageIndex *index = NULL;
+	unsigned count = 0, capacity = 0, i, imax = 0;
+	struct FDRCacheRecord rec;
+	struct CovariateAnalysis covan;
+	double RATIO;
 
-	assert( ! _matrix.lexigraphic_order /* should be row order */ );
+	// Index the cache...
 
-	for(fpair.l.offset = 0;
-		fpair.l.offset < hdr->rows;
-		fpair.l.offset++ ) {
+	rewind( cache );
+	while( ftell( cache ) < END
+			&& fread( &rec, sizeof(rec), 1, cache ) == 1 ) {
+		if( count == capacity ) {
+			void *grown;
+			capacity = capacity ? 2*capacity : 4096;
+			grown = realloc( index, capacity*sizeof(struct FDRImageIndex) );
+			if( NULL == grown )
+				err( -1, "allocating FDR index" );
+			index = grown;
+		}
+		index[count].p      = rec.p;
+		index[count].a      = rec.a;
+		index[count].b      = rec.b;
+		index[count].offset = ftell( cache );
+		if( fdr_result_load( &covan, cache ) ) {
+			warnx( "FDR cache truncated after %u results", count );
+			break;
+		}
+		count += 1;
+	}
 
-		/**
-		  * Read the "left" feature's data and descriptor
-		  */
+	// ...sort it and establish the p-value threshold...
 
-		if( fread( (void*)fpair.l.data, sizeof(mtm_int_t), hdr->columns,  fp[0] ) != hdr->columns )
-			break;
-		if( fread( &fpair.l.desc, sizeof(struct mtm_descriptor), 1, fp[1] ) != 1 )
-			break;
+	RATIO = Q/( count + _fdr_uncached_count );
+	qsort( index, count, sizeof(struct FDRImageIndex), _cmp_fdr_image_index );
 
-		/**
-		  * RAM-resident matrix is *fully* reset for each row of disk-
-		  * resident matrix...
-		  */
+	for(i = 0; i < count; i++ ) {
+		if( index[i].p <= (i+1)*RATIO )
+			imax = i+1;
+	}
 
-		fpair.r.data = _matrix.data;
-		rrid         = _matrix.row_map; // may be NULL
+	// ...then emit the stored results that pass it.
 
-		for(fpair.r.offset = 0;
-			fpair.r.offset < _matrix.rows;
-			fpair.r.offset++ ) {
+	for(i = 0; i < imax; i++ ) {
 
-			fpair.r.name = rrid ? rrid->string : "";
-			fpair.r.desc = _matrix.desc[ fpair.r.offset ];
+		struct feature_pair fpair;
+		memset( &covan, 0, sizeof(covan) );
 
-			_analyze( &fpair );
+		if( fseek( cache, index[i].offset, SEEK_SET )
+				|| fdr_result_load( &covan, cache ) ) {
+			warn( "reading FDR cache" );
+			break;
+		}
 
-			if( _sigint_received ) {
-				time_t now = time(NULL);
-				fprintf( stderr, "# main analysis loop interrupted @ %s", ctime(&now) );
-				completed = false;
-				break;
-			}
+		fpair.l.offset = index[i].a;
+		fpair.r.offset = index[i].b;
+		fetch_by_offset( &_matrix, &fpair );
 
-			fpair.r.data += _matrix.columns;
-			if( rrid ) rrid += 1;
+		_emit( &fpair, &covan, final_output );
 
-		} // inner for
+		if( _sigint_received ) {
+			time_t now = time(NULL);
+			fprintf( stderr, "# FDR postprocess interrupted @ %s", ctime(&now) );
+			i += 1;
+			break;
+		}
 	}
 
-	if( ferror( fp[0] ) || ferror( fp[1] ) ) {
-		warn( "reading row %d of preprocessed matrix", fpair.l.offset );
-		completed = false;
+	if( opt_verbosity >= V_WARNINGS ) {
+		if( i > 0 )
+			fprintf( _fp_notes, "# max p-value %.3f\n", index[i-1].p );
+		else
+			fprintf( _fp_notes, "# no values passed FDR control\n" );
 	}
+	if( index )
+		free( index );
+}
 
-	if( fpair.l.data )
-		free( (void*)fpair.l.data );
 
-	return completed ? 0 : -1;
+/***************************************************************************
+  * Live row index
+  * Whether a row can take part in *any* test follows from its descriptor
+  * alone: constant rows and rows with too many categories always fail the
+  * univariate checks, and a row with fewer present values than the minimum
+  * sample size can overlap no partner enough. Every pair involving such a
+  * "dead" row is untested, so the exhaustive loops below iterate only the
+  * compacted index of live rows and account for the skipped pairs in bulk.
+  *
+  * This is only valid when all the statuses such pairs could receive are
+  * filtered anyway, which they are by default and always are in the FDR
+  * caching pass. Otherwise every row is live and nothing is skipped.
+  * Debug builds also skip nothing under --debug P (see test/prefilter.sh).
+  */
+
+#define DEAD_ROW_STATUS (COVAN_E_SAMPLES_SIZE|COVAN_E_UNIVAR_DEGEN|COVAN_E_COVAR_DEGEN|COVAN_E_TOOMANY_CATS)
+
+static int *_live       = NULL; // offsets of live rows, ascending
+static int *_live_below = NULL; // _live_below[i] = count of live rows < i
+static int  _live_count = 0;
+
+static void _freeLiveIndex( void ) {
+	if( _live )
+		free( _live );
+	if( _live_below )
+		free( _live_below );
+	_live = _live_below = NULL;
 }
 
 
-static bool _is_integer( const char *pc ) {
-	while( *pc ) if( ! isdigit(*pc++) ) return false;
-	return true;
+static bool _prefilter_enabled( void ) {
+#ifdef _DEBUG
+	if( dbg_silent || dbg_no_prefilter ) return false;
+#endif
+	return _analyze == _fdr_cache
+		|| _analyze == _fdr_count
+		|| ( opt_status_mask & DEAD_ROW_STATUS ) == DEAD_ROW_STATUS;
 }
 
 
-static int _analyze_single_pair( const char *csv, const bool HAVE_ROW_LABELS ) {
+static bool _row_is_live( const struct mtm_descriptor *d, const mtm_bitmap_t *present, int columns ) {
 
-	static const char *MISSING_MSG
-		= "you specified row %s for a matrix without row names.\n";
+	unsigned n = 0;
 
-	int econd;
-	char *right, *left = alloca( strlen(csv)+1 );
-	struct CovariateAnalysis covan;
-	struct feature_pair pair;
+	if( d->constant || d->cardinality > MAX_CATEGORY_COUNT )
+		return false;
+	if( present ) {
+		for(int w = 0; w < MTM_BITMAP_WORDS(columns); w++ )
+			n += __builtin_popcountll( present[w] );
+	} else
+		n = columns - d->missing;
+	return n >= arg_min_sample_count;
+}
 
-	memset( &pair,  0, sizeof(pair) );
-	memset( &covan, 0, sizeof(covan) );
 
-	// Split the string in two...
+static int _build_live_index( void ) {
 
-	strcpy( left, csv );
-	right = strchr( left, ',' );
-	if( NULL == right )
-		errx( -1, "missing comma separator in feature pair \"%s\"", left );
-	*right++ = '\0';
+	const bool PREFILTER = _prefilter_enabled();
 
-	// Lookup each part.(They need not be the same format.)
+	_live       = calloc( _matrix.rows,   sizeof(int) );
+	_live_below = calloc( _matrix.rows+1, sizeof(int) );
+	if( NULL == _live || NULL == _live_below )
+		return -1;
 
-	if( _is_integer( left ) ) {
-		pair.l.offset = atoi( left );
-		mtm_resort_rowmap( &_matrix, MTM_RESORT_BYROWOFFSET );
-		econd = mtm_fetch_by_offset( &_matrix, &(pair.l) );
-	} else
-	if( HAVE_ROW_LABELS ) {
-		pair.l.name   = left;
+	_live_count = 0;
+	for(int i = 0; i < _matrix.rows; i++ ) {
+		_live_below[i] = _live_count;
+		if( ( ! PREFILTER ) || _row_is_live( _matrix.desc + i,
+				_matrix.present ? _matrix.present + i*_matrix.present_words : NULL,
+				_matrix.columns ) )
+			_live[ _live_count++ ] = i;
+	}
+	_live_below[ _matrix.rows ] = _live_count;
+	return 0;
+}
+
+
+static inline bool _is_live( int offset ) {
+	return _live_below[ offset+1 ] > _live_below[ offset ];
+}
+
+
+/**
+  * The number of pairs in the all-pairs triangle with left row <offset>
+  * that will actually be analyzed.
+  */
+static int _live_partners( int offset ) {
+	return _is_live( offset ) ? _live_count - _live_below[ offset+1 ] : 0;
+}
+
+
+/**
+  * Pairs skipped by the live index are exactly those the filter would
+  * have counted as untested. (The FDR pass doesn't count them at all.)
+  */
+static void _skipped_untested( unsigned n ) {
+	if( _analyze == _filter || _analyze == _topk_collect )
+		_untested += n;
+}
+
+
+/**
+  * Point f at the RAM-resident matrix' row <offset>.
+  */
+static void _set_feature( struct mtm_feature *f, int offset ) {
+	f->offset  = offset;
+	f->name    = _matrix.row_map ? _matrix.row_map[ offset ].string : "";
+	f->desc    = _matrix.desc[ offset ];
+	f->data    = _matrix.data + offset*_matrix.columns;
+	f->present = _matrix.present ? _matrix.present + offset*_matrix.present_words : NULL;
+}
+
+
+/**
+  * Recompute and emit, strongest first, the results retained for <row>.
+  * In cross-products fpair->l is already the (disk-resident) feature and
+  * <row> its slot. Otherwise the pair is emitted as all-pairs would
+  * have emitted it, lesser offset on the left, so a pair retained by both
+  * of its features appears under each.
+  */
+static void _topk_emit( struct feature_pair *fpair, unsigned row ) {
+
+	const struct topk_entry *e;
+	const unsigned N = topk_sort( _topk, row, &e );
+
+	for(unsigned i = 0; i < N; i++ ) {
+		struct CovariateAnalysis covan;
+		if( opt_preproc_matrix )
+			_set_feature( &fpair->r, e[i].partner );
+		else {
+			_set_feature( &fpair->l, row < e[i].partner ? row : e[i].partner );
+			_set_feature( &fpair->r, row < e[i].partner ? e[i].partner : row );
+		}
+		memset( &covan, 0, sizeof(covan) );
+		_covan_repeat( fpair, &covan );
+		_emit( fpair, &covan, _fp_output );
+	}
+	topk_clear( _topk, row );
+}
+
+
+static void _topk_emit_all( void ) {
+	struct feature_pair fpair;
+	for(int r = 0; r < _matrix.rows; r++ )
+		_topk_emit( &fpair, r );
+}
+
+
+/***************************************************************************
+  * Tiling
+  * Exhaustive loops otherwise stream every right row through the cache
+  * once per left row, and wide rows (e.g. 10k columns, which with their
+  * cached ranks are ~80KB) leave nothing to reuse. Instead, blocks of
+  * left rows are paired with blocks of right rows small enough that both
+  * stay cache-resident, so each right row is loaded once per left block.
+  * Within a tile pairs are still visited left row by left row, but the
+  * output of a left block is then ordered by right block.
+  */
+
+/**
+  * All-pairs analysis asks the analysis code to precompute whatever it can
+  * in bulk for this many left rows at a time. It is also the largest left
+  * block, and left blocks always divide it.
+  */
+#define PREFETCH_ROWS (32)
+
+/**
+  * Approximately the cache available to one tile.
+  */
+#define TILE_BYTES (1024*1024)
+
+/**
+  * Left and right block sizes (in rows) for the current _analyze. When
+  * results must be emitted in row order, left blocks are single rows
+  * and right blocks unbounded, which is the untiled traversal.
+  */
+static void _tiling( int *left, int *right ) {
+
+	const size_t ROW_BYTES
+		= _matrix.columns*( sizeof(mtm_int_t) + sizeof(float) ); // ...data and ranks
+	const size_t ROWS
+		= ROW_BYTES > 0 ? TILE_BYTES / ROW_BYTES : PREFETCH_ROWS;
+	int n = 1;
+
+	if( ! ( opt_tiled
+			|| _analyze == _fdr_count
+			|| _analyze == _topk_collect ) ) {
+		*left  = 1;
+		*right = INT_MAX;
+		return;
+	}
+
+	// Half the budget for each block, but never more than PREFETCH_ROWS
+	// left rows (rounded down to a power of 2 so blocks divide it).
+
+	while( 2*n <= PREFETCH_ROWS && 2*n <= (int)(ROWS/2) )
+		n *= 2;
+	*left  = n;
+	*right = ROWS > (size_t)n ? (int)( ROWS - n ) : 1;
+}
+
+
+/***************************************************************************
+  * Row selection iterators
+  * Each of these 5 methods takes arguments specific to the
+  * source of input pairs and uses file static state for output.
+  * All but the first delegate to the _analyze function which may be a
+  * filter on immediate-mode output or a caching function for FDR.
+  */
+
+// BEGIN:RSI
+
+/**
+  * Restrict a cross-product to this process' shard of the disk-resident
+  * matrix' rows and position both streams at its first row. The cost of
+  * each row is that of pairing it with every live RAM-resident row. Row
+  * liveness is judged by descriptor alone; the data isn't read.
+  */
+static int _shard_cross_product( const struct mtm_matrix_header *hdr, FILE *fp[] ) {
+
+	struct shard_totals t;
+	struct mtm_descriptor d;
+	double *cost = calloc( hdr->rows, sizeof(double) );
+	int l;
+
+	if( cost == NULL )
+		return -1;
+
+	memset( &t, 0, sizeof(t) );
+	for(int k = 0; k < _live_count; k++ )
+		shard_accumulate( &t, _matrix.desc + _live[k] );
+
+	for(l = 0; l < hdr->rows; l++ ) {
+		if( fread( &d, sizeof(struct mtm_descriptor), 1, fp[1] ) != 1 )
+			break;
+		if( ! ( d.constant || d.cardinality > MAX_CATEGORY_COUNT ) )
+			cost[l] = shard_cost( &t, &d, hdr->columns );
+	}
+	if( l == hdr->rows )
+		_shard_cost = shard_bounds( cost, hdr->rows,
+			opt_shard, opt_shards, &_shard_first, &_shard_last );
+	free( cost );
+
+	return l < hdr->rows
+		|| fseek( fp[0], hdr->section[ S_DATA ].offset
+			+ (long)_shard_first*hdr->columns*sizeof(mtm_int_t), SEEK_SET )
+		|| fseek( fp[1], hdr->section[ S_DESC ].offset
+			+ (long)_shard_first*sizeof(struct mtm_descriptor), SEEK_SET )
+		? -1 : 0;
+}
+
+
+static int /*ANCP*/ _analyze_cross_product(
+		const struct mtm_matrix_header *hdr, FILE *fp[] ) {
+
+	const int WORDS = MTM_BITMAP_WORDS(_matrix.columns);
+	bool completed = true;
+	struct feature_pair fpair;
+	int left, right, n, offset = 0;
+
+	/**
+	  * A block of left rows is read at a time into these buffers.
+	  */
+	mtm_int_t *ldata;
+	mtm_bitmap_t *lpresent;
+	struct mtm_descriptor *ldesc;
+	bool *llive;
+
+	_tiling( &left, &right );
+	assert( left <= TOPK_CROSS_ROWS && TOPK_CROSS_ROWS % left == 0 );
+
+	ldata    = calloc( (size_t)left*_matrix.columns, sizeof(mtm_int_t) );
+	lpresent = calloc( (size_t)left*WORDS, sizeof(mtm_bitmap_t) );
+	ldesc    = calloc( left, sizeof(struct mtm_descriptor) );
+	llive    = calloc( left, sizeof(bool) );
+
+	/**
+	  * TODO: I actually could enumerate the disk-resident matrix'
+	  * row names just as I do the descriptors. In general, the
+	  * pervasive assumption throughout this source that the input
+	  * is exactly one matrix needs to be revisited.
+	  */
+	fpair.l.name = NULL;
+
+	if( ldata == NULL || lpresent == NULL || ldesc == NULL || llive == NULL ) {
+		if( ldata )    free( ldata );
+		if( lpresent ) free( lpresent );
+		if( ldesc )    free( ldesc );
+		if( llive )    free( llive );
+		return -1;
+	}
+
+	assert( ! _matrix.lexigraphic_order /* should be row order */ );
+
+	_shard_last = hdr->rows;
+	if( opt_shards > 0 ) {
+		if( _shard_cross_product( hdr, fp ) )
+			completed = false;
+		offset = _shard_first;
+	}
+
+	while( completed && offset < _shard_last ) {
+
+		/**
+		  * Read a block of "left" features' data and descriptors.
+		  */
+
+		for(n = 0; n < left && offset + n < _shard_last; n++ ) {
+
+			mtm_int_t *data = ldata + n*_matrix.columns;
+
+			if( fread( data, sizeof(mtm_int_t), hdr->columns,  fp[0] ) != hdr->columns )
+				break;
+			if( fread( ldesc + n, sizeof(struct mtm_descriptor), 1, fp[1] ) != 1 )
+				break;
+
+			mtm_present_bitmap( data, hdr->columns, ldesc[n].integral, lpresent + n*WORDS );
+
+			llive[n] = ! _prefilter_enabled()
+				|| _row_is_live( ldesc + n, lpresent + n*WORDS, hdr->columns );
+
+			/**
+			  * RAM-resident matrix is *fully* reset for each row of disk-
+			  * resident matrix...
+			  */
+
+			_skipped_untested( llive[n] ? _matrix.rows - _live_count : _matrix.rows );
+		}
+		if( n == 0 )
+			break;
+
+		for(int k0 = 0, K1; k0 < _live_count && completed; k0 = K1 ) {
+
+			K1 = _live_count - k0 > right
+				? k0 + right
+				: _live_count;
+
+			for(int i = 0; i < n && completed; i++ ) {
+
+				if( ! llive[i] )
+					continue;
+
+				fpair.l.offset  = offset + i;
+				fpair.l.data    = ldata + i*_matrix.columns;
+				fpair.l.present = lpresent + i*WORDS;
+				fpair.l.desc    = ldesc[i];
+
+				for(int k = k0; k < K1; k++ ) {
+
+					_set_feature( &fpair.r, _live[k] );
+
+					_analyze( &fpair );
+
+					if( _sigint_received ) {
+						time_t now = time(NULL);
+						fprintf( stderr, "# main analysis loop interrupted @ %s", ctime(&now) );
+						completed = false;
+						break;
+					}
+
+				} // inner for
+			}
+		}
+
+		if( _topk ) {
+			for(int i = 0; i < n; i++ ) {
+				fpair.l.offset  = offset + i;
+				fpair.l.data    = ldata + i*_matrix.columns;
+				fpair.l.present = lpresent + i*WORDS;
+				fpair.l.desc    = ldesc[i];
+				_topk_emit( &fpair, fpair.l.offset % TOPK_CROSS_ROWS );
+			}
+		}
+
+		offset += n;
+		if( n < left && offset < _shard_last )
+			break; // ...short read
+	}
+
+	if( ferror( fp[0] ) || ferror( fp[1] ) ) {
+		warn( "reading row %d of preprocessed matrix", offset );
+		completed = false;
+	}
+
+	free( ldata );
+	free( lpresent );
+	free( ldesc );
+	free( llive );
+
+	return completed ? 0 : -1;
+}
+
+
+static bool _is_integer( const char *pc ) {
+	while( *pc ) if( ! isdigit(*pc++) ) return false;
+	return true;
+}
+
+
+static int _analyze_single_pair( const char *csv, const bool HAVE_ROW_LABELS ) {
+
+	static const char *MISSING_MSG
+		= "you specified row %s for a matrix without row names.\n";
+
+	int econd;
+	char *right, *left = alloca( strlen(csv)+1 );
+	struct CovariateAnalysis covan;
+	struct feature_pair pair;
+
+	memset( &pair,  0, sizeof(pair) );
+	memset( &covan, 0, sizeof(covan) );
+
+	// Split the string in two...
+
+	strcpy( left, csv );
+	right = strchr( left, ',' );
+	if( NULL == right )
+		errx( -1, "missing comma separator in feature pair \"%s\"", left );
+	*right++ = '\0';
+
+	// Lookup each part.(They need not be the same format.)
+
+	if( _is_integer( left ) ) {
+		pair.l.offset = atoi( left );
+		mtm_resort_rowmap( &_matrix, MTM_RESORT_BYROWOFFSET );
+		econd = mtm_fetch_by_offset( &_matrix, &(pair.l) );
+	} else
+	if( HAVE_ROW_LABELS ) {
+		pair.l.name   = left;
 		if( mtm_resort_rowmap( &_matrix, MTM_RESORT_LEXIGRAPHIC ) )
 			errx( -1, NO_ROW_LABELS );
 		econd = mtm_fetch_by_name( &_matrix, &(pair.l) );
@@ -626,7 +1444,7 @@ static int _analyze_single_pair( const char *csv, const bool HAVE_ROW_LABELS ) {
 	} else
 		errx( -1, MISSING_MSG, right );
 
-	covan_exec( &pair, &covan );
+	_covan_exec( &pair, &covan );
 
 	_emit( &pair, &covan, _fp_output );
 
@@ -636,207 +1454,847 @@ static int _analyze_single_pair( const char *csv, const bool HAVE_ROW_LABELS ) {
 
 static int /*ANAM*/ _analyze_named_pair_list( FILE *fp ) {
 
-	struct feature_pair fpair;
+	struct feature_pair fpair;
+
+	size_t blen = 0;
+	ssize_t llen;
+	char *right, *left = NULL;
+
+	while( ( llen = getline( &left, &blen, fp ) ) > 0 ) {
+
+		// Trim off the newline char.
+
+		if( left[llen-1] == '\n' )
+			left[--llen] = '\0'; // Strip the NL
+
+		// Parse the two names out of the line.
+
+		right = strchr( left, '\t' );
+		if( right )
+			*right++ = '\0';
+		else {
+			fprintf( stderr, "error: no tab found in '%s'.\n", left );
+			if( opt_warnings_are_fatal )
+				break;
+			else
+				continue; // no reason we -can't- continue
+		}
+
+		fpair.l.name  = left;
+		fpair.r.name = right;
+
+		if( fetch_by_name( &_matrix, &fpair ) ) {
+
+			warnx( "error: one or both of...\n"
+				"\t1) %s\n"
+				"\t2) %s\n"
+				"\t...not found.\n",
+				fpair.l.name,
+				fpair.r.name );
+			if( opt_warnings_are_fatal )
+				break;
+			else
+				continue; // no reason we -can't- continue
+		} else
+			_analyze( &fpair );
+	}
+
+	if( left )
+		free( left );
+
+	return 0;
+}
+
+
+static int /*ANUM*/ _analyze_pair_list( FILE *fp ) {
+
+	struct feature_pair fpair;
+
+	int arr[2];
+
+	while( get_base10_ints( fp, arr, 2 ) == 2 ) {
+
+		fpair.l.offset = arr[0];
+		fpair.r.offset = arr[1];
+
+		if( fetch_by_offset( &_matrix, &fpair ) ) {
+			warnx( "error: one of row indices (%d,%d) not in [0,%d)\n"
+				"\tjust before byte offset %ld in the stream.\n"
+				"\tAborting...\n",
+				fpair.l.offset,
+				fpair.r.offset,
+				_matrix.rows,
+				ftell( fp ) );
+			if( opt_warnings_are_fatal )
+				break;
+			else	
+				continue; // no reason we -can't- continue
+		} else
+			_analyze( &fpair );
+	}
+	return 0;
+}
+
+
+#ifdef HAVE_LUA
+static int _analyze_generated_pair( int l, int r, void *context ) {
+
+	struct feature_pair *fpair = context;
+
+	fpair->l.offset = l;
+	fpair->r.offset = r;
+
+	if( fetch_by_offset( &_matrix, fpair ) ) {
+		warnx( "one or both of %s-generated row indices (%d,%d) not in [0,%d)\n",
+			opt_coroutine,
+			fpair->l.offset,
+			fpair->r.offset,
+			_matrix.rows );
+		return opt_warnings_are_fatal ? 1 : 0; // no reason we -can't- continue
+	}
+
+	_analyze( fpair );
+
+	if( _sigint_received ) {
+		time_t now = time(NULL);
+		fprintf( stderr, "analysis loop interrupted @ %s", ctime(&now) );
+		return 1;
+	}
+	return 0;
+}
+
+
+static int /*ALUA*/ _analyze_generated_pair_list( lua_State *state ) {
+
+	struct feature_pair fpair;
+	int lua_status;
+
+	lua_getglobal( state, opt_coroutine );
+
+	assert( ! lua_isnil( state, -1 ) /* because it was checked early */ );
+
+	do {
+
+		lua_pushnumber( state, _matrix.rows );
+		lua_status = lua_resume( state, NULL, 1 );
+
+		if( lua_status == LUA_YIELD ) {
+
+			const int stop
+				= _lua_visit_yield( state, _matrix.rows, _analyze_generated_pair, &fpair );
+			if( stop < 0 ) {
+				warnx( "%s yielded neither a pair nor a block of pairs", opt_coroutine );
+				if( opt_warnings_are_fatal )
+					break;
+			} else
+			if( stop )
+				break;
+
+		} else
+		if( lua_status == LUA_OK )
+			break;
+		else { // some sort of error occurred.
+			fputs( lua_tostring( state, -1 ), stderr );
+		}
+
+		if( _sigint_received ) {
+			time_t now = time(NULL);
+			fprintf( stderr, "analysis loop interrupted @ %s", ctime(&now) );
+			break;
+		}
+
+	} while( lua_status == LUA_YIELD );
+
+
+	return 0;
+}
+#endif
+
+/**
+  * Pairs selected by a pair-selection spec. A single set is iterated like
+  * the all-pairs triangle; two as their cross-product, skipping self-pairs
+  * and the second visit of pairs whose rows are both in both sets.
+  */
+static void _freePairSel( void ) {
+	pairsel_destroy( _pairsel );
+	_pairsel = NULL;
+}
+
+
+static int /*ASEL*/ _analyze_selection( const struct pairsel *sel ) {
+
+	bool completed = true;
+	struct feature_pair fpair;
+	struct pairsel_rows side[2];
+	const int SETS = pairsel_resolve( sel, &_matrix, side );
+	const struct pairsel_rows *L, *R;
+
+	if( SETS < 0 )
+		errx( -1, "resolving \"%s\": %s (or out of memory)",
+			opt_select, NO_ROW_LABELS );
+
+	L = side;
+	R = side + SETS - 1;
+
+	for(int i = 0; i < L->count && completed; i++ ) {
+
+		const int l = L->offset[i];
+		const bool LIVE = _is_live( l );
+
+		if( LIVE )
+			_set_feature( &fpair.l, l );
+
+		for(int j = SETS == 1 ? i+1 : 0; j < R->count; j++ ) {
+
+			const int r = R->offset[j];
+
+			if( SETS == 2
+					&& ( r == l || ( r < l && L->member[r] && R->member[l] ) ) )
+				continue; // ...visited as (r,l)
+
+			if( ! ( LIVE && _is_live( r ) ) ) {
+				_skipped_untested( 1 );
+				continue;
+			}
+
+			_set_feature( &fpair.r, r );
+
+			_analyze( &fpair );
+
+			if( _sigint_received ) {
+				time_t now = time(NULL);
+				fprintf( stderr, "# main analysis loop interrupted @ %s", ctime(&now) );
+				completed = false;
+				break;
+			}
+
+		} // inner for
+	}
+
+	for(int i = 0; i < SETS; i++ )
+		pairsel_rows_free( side + i );
+	return completed ? 0 : -1;
+}
+
+
+/**
+  * Everything the checkpoint refers to must be on disk before it is.
+  */
+static void _checkpoint_save( void ) {
+	if( fflush( _fp_output )
+			|| fsync( fileno( _fp_output ) )
+			|| ( _fdr_cache_fp && ( fflush( _fdr_cache_fp ) || fsync( fileno( _fdr_cache_fp ) ) ) )
+			|| checkpoint_write( opt_checkpoint, &_checkpoint ) )
+		warn( "writing checkpoint \"%s\"", opt_checkpoint );
+	_checkpoint_time = time( NULL );
+}
+
+
+/**
+  * Record the state at which left row <l> is about to be analyzed and,
+  * if it's been long enough, write it out.
+  */
+static void _checkpoint_row( int l ) {
+
+	_checkpoint.rows          = _matrix.rows;
+	_checkpoint.columns       = _matrix.columns;
+	_checkpoint.shard         = opt_shard;
+	_checkpoint.shards        = opt_shards;
+	_checkpoint.l             = l;
+	_checkpoint.r             = l + 1;
+	_checkpoint.insignificant = _insignificant;
+	_checkpoint.untested      = _untested;
+	_checkpoint.output        = ftell( _fp_output );
+	_checkpoint.fdr           = _fdr_cache_fp ? ftell( _fdr_cache_fp ) : -1;
+	_checkpoint.fdr_uncached  = _fdr_uncached_count;
+	_checkpoint.fdr_max_p     = _fdr_max_p;
+
+	if( time( NULL ) - _checkpoint_time >= CHECKPOINT_SECONDS )
+		_checkpoint_save();
+}
+
+
+/**
+  * This clause serves the primary use case motivating this
+  * application: FAST, EXHAUSTIVE (n-choose-2) pairwise analysis.
+  * As a result, the coding of this iteration schema is quite
+  * different from the others. In particular:
+  * 1. Since I -know- the order of feature pair evaluation I can
+  *    preclude lots of useless work by entirely skipping outer loop
+  *    features with univariate degeneracy. This isn't feasible in
+  *    the other iteration schemes.
+  * 2. Only live rows (see _build_live_index) are paired, in cache-sized
+  *    tiles (see _tiling), and the analysis code is asked to precompute
+  *    whatever it can for each block of left rows (covan_prefetch).
+  * Rows [first,last) are the left rows of the pairs analyzed.
+  */
+static int /*AALL*/ _analyze_triangle( int first, int last ) {
+
+	bool completed = true;
+	struct feature_pair fpair;
+	int left, right;
+
+	assert( ! _matrix.lexigraphic_order /* should be row order */ );
+
+	_tiling( &left, &right );
+
+	for(int l0 = first; l0 < last && completed; l0 += left ) {
+
+		const int L1 = last - l0 > left ? l0 + left : last;
+
+		if( opt_checkpoint )
+			_checkpoint_row( l0 );
+
+		if( ( l0 - first ) % PREFETCH_ROWS == 0 )
+			covan_prefetch( l0,
+				l0 + PREFETCH_ROWS < last
+				? l0 + PREFETCH_ROWS
+				: last );
+
+		for(int l = l0; l < L1; l++ ) {
+			const unsigned PARTNERS = _matrix.rows - l - 1;
+			_skipped_untested( PARTNERS - _live_partners( l ) );
+		}
+
+		// Right blocks start at the block's diagonal; within the diagonal
+		// block each left row starts past itself.
+
+		for(int k0 = _live_below[ l0 ], K1; k0 < _live_count && completed; k0 = K1 ) {
+
+			K1 = _live_count - k0 > right
+				? k0 + right
+				: _live_count;
+
+			for(int l = l0; l < L1 && completed; l++ ) {
+
+				if( ! _is_live( l ) )
+					continue;
+
+				_set_feature( &fpair.l, l );
+
+				for(int k = k0 > _live_below[ l+1 ] ? k0 : _live_below[ l+1 ]; k < K1; k++ ) {
+
+					_set_feature( &fpair.r, _live[k] );
+
+					_analyze( &fpair );
+
+					if( _sigint_received ) {
+						time_t now = time(NULL);
+						fprintf( stderr, "# main analysis loop interrupted @ %s", ctime(&now) );
+						completed = false;
+						break;
+					}
+
+				} // inner for
+			}
+		}
+	}
+
+	// On interruption the last checkpoint recorded is the start of the
+	// interrupted block; on completion, the end of the triangle.
+
+	if( opt_checkpoint ) {
+		if( completed )
+			_checkpoint_row( last );
+		_checkpoint_save();
+	}
+	return completed ? 0 : -1;
+}
+
+
+static int /*AALL*/ _analyze_all_pairs( void ) {
+	return _analyze_triangle(
+		_resume_row >= 0 ? _resume_row : _shard_first,
+		_shard_last );
+}
+
+
+/**
+  * Restrict all-pairs analysis to this process' shard of the triangle.
+  * The cost of each left row is that of pairing it with every live row
+  * beyond it.
+  */
+static void _shard_all_pairs( void ) {
+
+	struct shard_totals t;
+	double *cost = calloc( _matrix.rows, sizeof(double) );
+	if( cost == NULL )
+		err( -1, "allocating shard costs" );
+
+	memset( &t, 0, sizeof(t) );
+	for(int l = _matrix.rows-1; l >= 0; l-- ) {
+		if( _is_live( l ) ) {
+			cost[l] = shard_cost( &t, _matrix.desc + l, _matrix.columns );
+			shard_accumulate( &t, _matrix.desc + l );
+		}
+	}
+	_shard_cost = shard_bounds( cost, _matrix.rows,
+		opt_shard, opt_shards, &_shard_first, &_shard_last );
+	free( cost );
+}
+
+
+/***************************************************************************
+  * Concurrent all-pairs
+  * Though the analysis code is reentrant (see covan_ctx_t), the iteration
+  * and emission code in this file is not: the _analyze filters count into
+  * _insignificant and _untested, FDR and top-K accumulate into _fdr_hist
+  * and _topk, and everything writes to _fp_output. Concurrency is thus
+  * achieved with worker *processes*, each of which gets a private copy of
+  * that state (and of everything else) from fork().
+  *
+  * The triangle is cut into contiguous ranges of left rows containing
+  * roughly equal numbers of pairs. Workers claim chunks in triangle order
+  * from a schedule in shared memory. Each worker appends its output and
+  * FDR cache records to its own temporary files and records where each
+  * chunk's results landed, so the parent can splice them back together
+  * in chunk order. The result is byte-for-byte what _analyze_all_pairs
+  * would have produced. FDR histograms and top-K results are instead
+  * written once, when a worker finishes, and merged by the parent.
+  *
+  * When opt_unordered is set workers instead write directly to the
+  * output stream (line-buffered so lines are never interleaved), which
+  * saves the final copy at the cost of a nondeterministic line order.
+  */
+
+#define CHUNKS_PER_WORKER (16)
+
+struct Chunk {
+	int first, last; // ...range of left rows
+	int worker;      // ...that claimed the chunk or -1
+	bool completed;
+	long out_offset, out_length;
+	long fdr_offset, fdr_length;
+	uint64_t insignificant;
+	uint64_t untested;
+	int fdr_uncached;
+	double fdr_max_p;
+};
+
+struct Schedule {
+	int next;
+	int count;
+	struct Chunk chunk[];
+};
+
+/**
+  * Partition rows [first,last) into at most <count> ranges each of which
+  * contains roughly the same number of (l,r) pairs with l < r that will
+  * actually be analyzed (see _live_partners).
+  * Ranges are cut only at multiples of PREFETCH_ROWS from <first> so that
+  * every worker's left blocks (see _tiling) are those of a single process
+  * and tiled output is ordered identically.
+  */
+static int _partition_triangle( int first, int last, int count, struct Chunk *chunk ) {
+
+	double TOTAL = 0.0;
+	double sum = 0.0;
+	int l, n = 0;
+
+	for(l = first; l < last; l++ )
+		TOTAL += _live_partners( l );
+
+	chunk[0].first = first;
+	for(l = first; l < last; l++ ) {
+		sum += _live_partners( l );
+		if( ( sum >= (n+1)*(TOTAL/count)
+				&& ( l+1 - first ) % PREFETCH_ROWS == 0 ) || l+1 == last ) {
+			chunk[n].last = l + 1;
+			if( ++n < count )
+				chunk[n].first = l + 1;
+			else
+				break;
+		}
+	}
+	if( n > 0 )
+		chunk[n-1].last = last;
+	return n;
+}
+
+
+static int _copy_region( FILE *src, long offset, long length, FILE *dst ) {
+
+	char buf[ 64*1024 ];
+	if( fseek( src, offset, SEEK_SET ) )
+		return -1;
+	while( length > 0 ) {
+		const size_t n = fread( buf, 1,
+			length < (long)sizeof(buf) ? (size_t)length : sizeof(buf), src );
+		if( n == 0 || fwrite( buf, 1, n, dst ) != n )
+			return -1;
+		length -= n;
+	}
+	return 0;
+}
+
+
+/**
+  * Executed only in worker processes. Claims and analyzes chunks until
+  * none remain or an interrupt is received.
+  */
+static int _run_worker( struct Schedule *s, int w, FILE *out, FILE *fdr ) {
 
-	size_t blen = 0;
-	ssize_t llen;
-	char *right, *left = NULL;
+	int k;
 
-	while( ( llen = getline( &left, &blen, fp ) ) > 0 ) {
+	while( ! _sigint_received
+			&& ( k = __sync_fetch_and_add( &s->next, 1 ) ) < s->count ) {
 
-		// Trim off the newline char.
+		struct Chunk *c = s->chunk + k;
+		c->worker = w;
 
-		if( left[llen-1] == '\n' )
-			left[--llen] = '\0'; // Strip the NL
+		_insignificant      = 0;
+		_untested           = 0;
+		_fdr_uncached_count = 0;
+		_fdr_max_p          = -1.0;
 
-		// Parse the two names out of the line.
+		c->out_offset = out ? ftell( out ) : 0;
+		c->fdr_offset = fdr ? ftell( fdr ) : 0;
 
-		right = strchr( left, '\t' );
-		if( right )
-			*right++ = '\0';
-		else {
-			fprintf( stderr, "error: no tab found in '%s'.\n", left );
-			if( opt_warnings_are_fatal )
-				break;
-			else
-				continue; // no reason we -can't- continue
-		}
+		c->completed = _analyze_triangle( c->first, c->last ) == 0;
 
-		fpair.l.name  = left;
-		fpair.r.name = right;
+		if( out ) c->out_length = ftell( out ) - c->out_offset;
+		if( fdr ) c->fdr_length = ftell( fdr ) - c->fdr_offset;
 
-		if( fetch_by_name( &_matrix, &fpair ) ) {
+		c->insignificant = _insignificant;
+		c->untested      = _untested;
+		c->fdr_uncached  = _fdr_uncached_count;
+		c->fdr_max_p     = _fdr_max_p;
 
-			warnx( "error: one or both of...\n"
-				"\t1) %s\n"
-				"\t2) %s\n"
-				"\t...not found.\n",
-				fpair.l.name,
-				fpair.r.name );
-			if( opt_warnings_are_fatal )
-				break;
-			else
-				continue; // no reason we -can't- continue
-		} else
-			_analyze( &fpair );
+		if( ! c->completed )
+			break;
 	}
 
-	if( left )
-		free( left );
-
-	return 0;
+	if( _analyze == _fdr_count && fdr_hist_save( _fdr_hist, fdr ) )
+		return -1;
+	if( _analyze == _topk_collect && topk_save( _topk, fdr ) )
+		return -1;
+	if( fflush( _fp_output ) || ( fdr && fflush( fdr ) ) )
+		return -1;
+	return _sigint_received ? -1 : 0;
 }
 
 
-static int /*ANUM*/ _analyze_pair_list( FILE *fp ) {
-
-	struct feature_pair fpair;
+/**
+  * Each worker counts into its own slot, zeroed here, which the parent
+  * includes in progress reports and finally adds to its own count.
+  */
+static void _telemetry_share( int workers ) {
+	_telemetry_workers
+		= mmap( NULL, workers*sizeof(struct telemetry),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+	if( _telemetry_workers == MAP_FAILED )
+		err( -1, "mapping shared telemetry" );
+	memset( _telemetry_workers, 0, workers*sizeof(struct telemetry) );
+	_telemetry_worker_count = workers;
+}
 
-	int arr[2];
 
-	while( get_base10_ints( fp, arr, 2 ) == 2 ) {
+/**
+  * Executed in worker <w> just after fork(). Only the parent reports.
+  */
+static void _telemetry_fork( int w ) {
+	_telemetry = _telemetry_workers + w;
+	_telemetry_workers      = NULL;
+	_telemetry_worker_count = 0;
+	_telemetry_due          = 0;
+	signal( SIGUSR1, SIG_IGN );
+	covan_set_telemetry( _telemetry );
+}
 
-		fpair.l.offset = arr[0];
-		fpair.r.offset = arr[1];
 
-		if( fetch_by_offset( &_matrix, &fpair ) ) {
-			warnx( "error: one of row indices (%d,%d) not in [0,%d)\n"
-				"\tjust before byte offset %ld in the stream.\n"
-				"\tAborting...\n",
-				fpair.l.offset,
-				fpair.r.offset,
-				_matrix.rows,
-				ftell( fp ) );
-			if( opt_warnings_are_fatal )
-				break;
-			else	
-				continue; // no reason we -can't- continue
-		} else
-			_analyze( &fpair );
-	}
-	return 0;
+static void _telemetry_join( void ) {
+	for(int w = 0; w < _telemetry_worker_count; w++ )
+		telemetry_merge( _telemetry, _telemetry_workers + w );
+	munmap( _telemetry_workers, _telemetry_worker_count*sizeof(struct telemetry) );
+	_telemetry_workers      = NULL;
+	_telemetry_worker_count = 0;
+	_telemetry_signals( true );
 }
 
 
-#ifdef HAVE_LUA
-static int /*ALUA*/ _analyze_generated_pair_list( lua_State *state ) {
+static int /*AALL*/ _analyze_all_pairs_concurrently( int workers ) {
 
-	struct feature_pair fpair;
-	int isnum, lua_status;
+	const int ROWS
+		= _shard_last - _shard_first;
+	const int MAX_CHUNKS
+		= ROWS > 1
+		? ( workers*CHUNKS_PER_WORKER < ROWS
+			? workers*CHUNKS_PER_WORKER
+			: ROWS )
+		: 1;
+	const size_t SIZEOF_SCHEDULE
+		= sizeof(struct Schedule) + MAX_CHUNKS*sizeof(struct Chunk);
+
+	const bool FDR_TMPFILE
+		= _fdr_cache_fp != NULL
+		|| _analyze == _fdr_count
+		|| _analyze == _topk_collect;
+	bool completed = true;
+	FILE **out = NULL, **fdr = NULL;
+	pid_t *pid;
+	int w, k, started = 0;
+
+	struct Schedule *s
+		= mmap( NULL, SIZEOF_SCHEDULE,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+	if( s == MAP_FAILED )
+		err( -1, "mapping shared schedule" );
+	memset( s, 0, SIZEOF_SCHEDULE );
+
+	s->count = _partition_triangle( _shard_first, _shard_last, MAX_CHUNKS, s->chunk );
+	for(k = 0; k < s->count; k++ )
+		s->chunk[k].worker = -1;
+
+	if( workers > s->count )
+		workers = s->count;
+
+	pid = alloca( workers*sizeof(pid_t) );
+	out = alloca( workers*sizeof(FILE*) );
+	fdr = alloca( workers*sizeof(FILE*) );
+
+	for(w = 0; w < workers; w++ ) {
+		out[w] = opt_unordered ? NULL : tmpfile();
+		fdr[w] = FDR_TMPFILE ? tmpfile() : NULL;
+		if( ( ! opt_unordered && out[w] == NULL )
+				|| ( FDR_TMPFILE && fdr[w] == NULL ) )
+			err( -1, "creating a temporary file" );
+	}
 
-	lua_getglobal( _L, opt_coroutine );
+	if( _telemetry )
+		_telemetry_share( workers );
 
-	assert( ! lua_isnil( _L, -1 ) /* because it was checked early */ );
+	// Nothing buffered in this process may be inherited by workers.
 
-	do {
+	fflush( _fp_output );
+	fflush( stderr );
 
-		lua_pushnumber( _L, _matrix.rows );
-		lua_status = lua_resume( _L, NULL, 1 );
+	for(w = 0; w < workers; w++ ) {
 
-		if( lua_status == LUA_YIELD ) {
+		pid[w] = fork();
 
-			fpair.r.offset = lua_tonumberx( _L, -1, &isnum );
-			fpair.l.offset = lua_tonumberx( _L, -2, &isnum );
-			lua_pop( _L, 2 );
+		if( pid[w] == 0 ) {
 
-			if( fetch_by_offset( &_matrix, &fpair ) ) {
-				warnx( "one or both of %s-generated row indices (%d,%d) not in [0,%d)\n",
-					opt_coroutine,
-					fpair.l.offset,
-					fpair.r.offset,
-					_matrix.rows );
-				if( opt_warnings_are_fatal )
-					break;
-				else	
-					continue; // no reason we -can't- continue
+			if( opt_unordered ) {
+				_fp_output = fdopen( dup( fileno( _fp_output ) ), "w" );
+				if( _fp_output == NULL )
+					_exit( EXIT_FAILURE );
+				if( _emit == format_binary )
+					// ...whole records per write, within PIPE_BUF's atomicity.
+					setvbuf( _fp_output, NULL, _IOFBF,
+						(PIPE_BUF/BINFMT_RECORD_SIZE)*BINFMT_RECORD_SIZE );
+				else
+					setvbuf( _fp_output, NULL, _IOLBF, 0 );
 			} else
-				_analyze( &fpair );
+				_fp_output = out[w];
+			if( fdr[w] && _fdr_cache_fp )
+				_fdr_cache_fp = fdr[w];
+			if( _telemetry )
+				_telemetry_fork( w );
+
+			_exit( _run_worker( s, w, out[w], fdr[w] )
+				? EXIT_FAILURE
+				: EXIT_SUCCESS );
 
 		} else
-		if( lua_status == LUA_OK )
+		if( pid[w] < 0 ) {
+			warn( "forking worker %d", w );
+			completed = false;
 			break;
-		else { // some sort of error occurred.
-			fputs( lua_tostring( _L, -1 ), stderr );
 		}
+		started += 1;
+	}
 
-		if( _sigint_received ) {
-			time_t now = time(NULL);
-			fprintf( stderr, "analysis loop interrupted @ %s", ctime(&now) );
+	if( _telemetry )
+		_telemetry_signals( false );
+
+	for(w = 0; w < started; w++ ) {
+		int status;
+		while( waitpid( pid[w], &status, 0 ) < 0 ) {
+			if( errno != EINTR ) {
+				status = -1;
+				break;
+			}
+			if( _telemetry_due )
+				_telemetry_report();
+		}
+		if( ! ( WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS ) ) {
+			if( ! _sigint_received )
+				warnx( "worker %d (pid %d) failed", w, (int)pid[w] );
+			completed = false;
+		}
+	}
+
+	// Reassemble results in chunk order. In ordered mode output stops at
+	// the first chunk that did not complete so that it is always a prefix
+	// of what a single process would have emitted.
+
+	for(k = 0; k < s->count; k++ ) {
+		const struct Chunk *c = s->chunk + k;
+		if( c->worker < 0 ) {
+			completed = false;
+			if( opt_unordered )
+				continue;
 			break;
 		}
+		if( out[c->worker]
+				&& _copy_region( out[c->worker], c->out_offset, c->out_length, _fp_output ) )
+			err( -1, "copying results of worker %d", c->worker );
+		if( _fdr_cache_fp
+				&& _copy_region( fdr[c->worker], c->fdr_offset, c->fdr_length, _fdr_cache_fp ) )
+			err( -1, "copying FDR cache of worker %d", c->worker );
+		_insignificant      += c->insignificant;
+		_untested           += c->untested;
+		_fdr_uncached_count += c->fdr_uncached;
+		if( _fdr_max_p < c->fdr_max_p )
+			_fdr_max_p = c->fdr_max_p;
+		if( ! c->completed ) {
+			completed = false;
+			if( ! opt_unordered )
+				break;
+		}
+	}
 
-	} while( lua_status == LUA_YIELD );
+	if( _analyze == _fdr_count ) {
+		for(w = 0; w < started; w++ ) {
+			rewind( fdr[w] );
+			if( fdr_hist_merge( _fdr_hist, fdr[w] ) ) {
+				warnx( "reading FDR histogram of worker %d", w );
+				completed = false;
+			}
+		}
+	}
 
+	if( _analyze == _topk_collect ) {
+		for(w = 0; w < started; w++ ) {
+			rewind( fdr[w] );
+			if( topk_merge( _topk, fdr[w] ) ) {
+				warnx( "reading top-K results of worker %d", w );
+				completed = false;
+			}
+		}
+	}
 
-	return 0;
-}
-#endif
+	if( _telemetry )
+		_telemetry_join();
 
-/**
-  * This clause serves the primary use case motivating this
-  * application: FAST, EXHAUSTIVE (n-choose-2) pairwise analysis.
-  * As a result, the coding of this iteration schema is quite
-  * different from the others. In particular:
-  * 1. Since I -know- the order of feature pair evaluation I can
-  *    preclude lots of useless work by entirely skipping outer loop
-  * features with univariate degeneracy. This isn't feasible in
-  * the other iteration sc
-  * I'm dispensing with "pretty" and doing the
-  * pointer arithmetic locally to eek out maximum possible speed.
-  * In particular, I set up lots of ptrs below to obviate
-  * redundant pointer arithmetic--only do fixed additions.
-  */
-static int /*AALL*/ _analyze_all_pairs( void ) {
+	for(w = 0; w < workers; w++ ) {
+		if( out[w] ) fclose( out[w] );
+		if( fdr[w] ) fclose( fdr[w] );
+	}
+	munmap( s, SIZEOF_SCHEDULE );
 
-	bool completed = true;
-	struct feature_pair fpair;
+	return completed ? 0 : -1;
+}
 
-	struct mtm_row *lrid, *rrid;
+// END:RSI
 
-	assert( ! _matrix.lexigraphic_order /* should be row order */ );
+/**
+  * Second pass of all-pairs FDR control: the threshold is derived from
+  * the first pass' histogram and the analysis repeated, this time
+  * emitting the pairs that pass it.
+  */
+static void _fdr_rerun_all_pairs( double Q, FILE *final_output ) {
 
-	fpair.l.data = _matrix.data;
-	lrid         = _matrix.row_map; // may be NULL
+	uint64_t rejected;
 
-	for(fpair.l.offset = 0;
-		fpair.l.offset < _matrix.rows;
-		fpair.l.offset++ ) {
+	_fdr_threshold = fdr_hist_threshold( _fdr_hist, Q, &rejected );
+	_fdr_max_p     = -1.0;
 
-		fpair.l.name = lrid ? lrid->string : "";
-		fpair.l.desc = _matrix.desc[ fpair.l.offset ];
+	if( rejected > 0 ) {
+		_analyze = _fdr_emit;
+		// ...and only which side of the threshold p-values lie on matters.
+		covan_set_threshold( _fdr_threshold );
+		if( opt_threads > 1 )
+			_analyze_all_pairs_concurrently( opt_threads );
+		else
+			_analyze_all_pairs();
+	}
 
-		fpair.r.data = fpair.l.data + _matrix.columns;
-		rrid = lrid ? lrid + 1 : NULL;
+	if( opt_verbosity >= V_WARNINGS ) {
+		if( _fdr_max_p >= 0.0 )
+			fprintf( _fp_notes, "# max p-value %.3f\n", _fdr_max_p );
+		else
+			fprintf( _fp_notes, "# no values passed FDR control\n" );
+	}
+}
 
-		for(fpair.r.offset = fpair.l.offset+1;
-			fpair.r.offset < _matrix.rows;
-			fpair.r.offset++ ) {
+/**
+  * A shard's manifest records what it covered and whether it finished, so
+  * that merged output can be checked for completeness: the shards' row
+  * ranges must tile the left rows and every shard must have completed.
+  * It accompanies a named output file, or goes to stderr with stdout.
+  */
+#define MANIFEST_SUFFIX ".manifest"
+
+static void _write_shard_manifest( const char *i_file, const char *o_file, bool completed ) {
+
+	const bool TO_STDOUT = _fp_output == stdout;
+	char *name = NULL;
+	FILE *fp = stderr;
+	long bytes;
+
+	fflush( _fp_output );
+	bytes = ftell( _fp_output );
+
+	if( ! TO_STDOUT ) {
+		name = malloc( strlen( o_file ) + sizeof(MANIFEST_SUFFIX) );
+		if( name == NULL )
+			err( -1, "writing shard manifest" );
+		strcpy( name, o_file );
+		strcat( name, MANIFEST_SUFFIX );
+		fp = fopen( name, "w" );
+		if( fp == NULL )
+			err( -1, "opening shard manifest \"%s\"", name );
+	}
 
-			fpair.r.name = rrid ? rrid->string : "";
-			fpair.r.desc = _matrix.desc[ fpair.r.offset ];
+	fprintf( fp,
+		"shard\t%d/%d\n"
+		"input\t%s\n"
+		"rows\t%d\t%d\n"
+		"cost\t%.6g\n"
+		"insignificant\t%" PRIu64 "\n"
+		"untested\t%" PRIu64 "\n",
+		opt_shard, opt_shards,
+		i_file,
+		_shard_first, _shard_last,
+		_shard_cost,
+		_insignificant,
+		_untested );
+	if( bytes >= 0 && ! TO_STDOUT )
+		fprintf( fp, "output\t%s\t%ld\n", o_file, bytes );
+	fprintf( fp, "completed\t%s\n", completed ? "yes" : "no" );
+
+	if( name ) {
+		if( fclose( fp ) )
+			warn( "writing shard manifest \"%s\"", name );
+		free( name );
+	}
+}
 
-			_analyze( &fpair );
 
-			if( _sigint_received ) {
-				time_t now = time(NULL);
-				fprintf( stderr, "# main analysis loop interrupted @ %s", ctime(&now) );
-				completed = false;
-				break;
-			}
+/**
+  * Binary output identifies rows by offset; the header maps offsets to
+  * labels (see binfmt.h).
+  */
+static int _write_binary_header( void ) {
 
-			fpair.r.data += _matrix.columns;
-			if( rrid ) rrid += 1;
+	// In cross-products left offsets index the preprocessed matrix, whose
+	// labels aren't available, so no labels are written for either side.
 
-		} // inner for
+	const unsigned ROWS
+		= _matrix.row_map && ! opt_preproc_matrix ? _matrix.rows : 0;
 
-		fpair.l.data += _matrix.columns;
-		if( lrid ) lrid += 1;
+	if( ROWS > 0 )
+		mtm_resort_rowmap( &_matrix, MTM_RESORT_BYROWOFFSET );
+	if( binfmt_write_header( _fp_output, ROWS ) )
+		return -1;
+	for(unsigned i = 0; i < ROWS; i++ ) {
+		if( binfmt_write_label( _fp_output, _matrix.row_map[i].string ) )
+			return -1;
 	}
-	return completed ? 0 : -1;
+	return 0;
 }
 
-// END:RSI
-
 /**
   * Initializations for which static initialization can't/shouldn't 
   * be relied upon. Common to executable and Python extension.
@@ -880,6 +2338,8 @@ static void _print_usage( const char *exename, FILE *fp, bool exhaustive ) {
 #ifdef HAVE_LUA
 			DEFAULT_COROUTINE,
 #endif
+			opt_threads,
+			opt_row_cache,
 			arg_min_cell_count,
 			arg_min_mixb_count,
 			arg_min_sample_count,
@@ -887,7 +2347,7 @@ static void _print_usage( const char *exename, FILE *fp, bool exhaustive ) {
 			opt_p_value,
 			opt_status_mask,
 			opt_format,
-			MAGIC_FORMAT_ID_STD, MAGIC_FORMAT_ID_TCGA,
+			MAGIC_FORMAT_ID_STD, MAGIC_FORMAT_ID_TCGA, MAGIC_FORMAT_ID_BIN,
 			_YN(opt_warnings_are_fatal),
 			opt_verbosity,
 			MAGIC_SUFFIX,
@@ -906,6 +2366,7 @@ static void _print_usage( const char *exename, FILE *fp, bool exhaustive ) {
 int main( int argc, char *argv[] ) {
 
 	int exit_status = EXIT_SUCCESS;
+	int analysis_status = 0;
 
 	const char *i_file = NULL;
 	const char *o_file = NULL;
@@ -922,9 +2383,9 @@ int main( int argc, char *argv[] ) {
 
 		static const char *CHAR_OPTIONS
 #ifdef HAVE_LUA
-			= "s:hrt:N:C:P:n:x:c:DM:p:f:q:v:?X";
+			= "s:hrt:N:C:P:n:x:c:DT:M:p:f:J:q:v:?X";
 #else
-			= "hrt:N:C:P:n:x:DM:p:f:q:v:?X";
+			= "hrt:N:C:P:n:x:DT:M:p:f:J:q:v:?X";
 #endif
 
 		static struct option LONG_OPTIONS[] = {
@@ -940,10 +2401,19 @@ int main( int argc, char *argv[] ) {
 			{"pair",          required_argument,  0,'P'},
 			{"by-name",       required_argument,  0,'n'},
 			{"by-index",      required_argument,  0,'x'},
+			{"select",        required_argument,  0, 264 }, // no short equivalents
 #ifdef HAVE_LUA
 			{"coroutine",     required_argument,  0,'c'},
 #endif
 			{"dry-run",       no_argument,        0,'D'},
+			{"threads",       required_argument,  0,'T'},
+			{"unordered",     no_argument,        0, 259 }, // no short equivalents
+			{"tiled",         no_argument,        0, 263 }, // no short equivalents
+			{"shard",         required_argument,  0, 265 }, // no short equivalents
+			{"checkpoint",    required_argument,  0, 266 }, // no short equivalents
+			{"resume",        no_argument,        0, 267 }, // no short equivalents
+			{"telemetry",     required_argument,  0, 268 }, // no short equivalents
+			{"row-cache",     required_argument,  0, 269 }, // no short equivalents
 
 			{"min-ct-cell",   required_argument,  0, 256 }, // no short equivalents
 			{"min-mx-cell",   required_argument,  0, 257 }, // no short equivalents
@@ -951,7 +2421,11 @@ int main( int argc, char *argv[] ) {
 
 			{"p-value",       required_argument,  0,'p'},
 			{"format",        required_argument,  0,'f'},
+			{"json",          required_argument,  0,'J'},
 			{"fdr",           required_argument,  0,'q'},
+			{"fdr-store",     no_argument,        0, 260 }, // no short equivalents
+			{"top-k",         required_argument,  0, 261 }, // no short equivalents
+			{"top-by",        required_argument,  0, 262 }, // no short equivalents
 			{"verbosity",     required_argument,  0,'v'},
 #ifdef _DEBUG
 			{"debug",         required_argument,  0, 258 }, // no short equivalents
@@ -995,12 +2469,47 @@ int main( int argc, char *argv[] ) {
 			opt_pairlist_source = optarg;
 			opt_by_name         = false;
 			break;
+		case 264: // ...because I haven't defined a short form for this
+			opt_select          = optarg;
+			break;
 		case 'c': // coroutine
 			opt_coroutine       = optarg;
 			break;
 		case 'D': // dry-run
 			opt_dry_run         = true;
 			break;
+		case 'T': // threads
+			opt_threads         = atoi( optarg );
+			if( opt_threads < 1 )
+				errx( -1, "invalid worker count \"%s\"", optarg );
+			break;
+		case 259: // ...because I haven't defined a short form for this
+			opt_unordered       = true;
+			break;
+		case 263: // ...because I haven't defined a short form for this
+			opt_tiled           = true;
+			break;
+		case 265: // ...because I haven't defined a short form for this
+			if( sscanf( optarg, "%d/%d", &opt_shard, &opt_shards ) != 2
+					|| opt_shards < 1 || opt_shard < 0 || opt_shard >= opt_shards )
+				errx( -1, "invalid shard \"%s\"; expected i/N with 0 <= i < N", optarg );
+			break;
+		case 266: // ...because I haven't defined a short form for this
+			opt_checkpoint      = optarg;
+			break;
+		case 267: // ...because I haven't defined a short form for this
+			opt_resume          = true;
+			break;
+		case 268: // ...because I haven't defined a short form for this
+			opt_telemetry       = atoi( optarg );
+			if( opt_telemetry < 0 )
+				errx( -1, "--telemetry requires a non-negative interval" );
+			break;
+		case 269: // ...because I haven't defined a short form for this
+			opt_row_cache       = atoi( optarg );
+			if( opt_row_cache < 0 )
+				errx( -1, "--row-cache requires a non-negative size" );
+			break;
 
 		////////////////////////////////////////////////////////////////////
 		case 256: // ...because I haven't defined a short form for this
@@ -1038,13 +2547,23 @@ int main( int argc, char *argv[] ) {
 
 		case 'J': // JSON format
 		case 'f': // tabular format
-			// Check for magic-value strings first
+			_structured_output = c == 'J';
+			// Check for magic-value strings first; JSON has none.
+			if( c == 'J' && ( strcmp( MAGIC_FORMAT_ID_STD, optarg ) == 0
+					|| strcmp( MAGIC_FORMAT_ID_TCGA, optarg ) == 0
+					|| strcmp( MAGIC_FORMAT_ID_BIN, optarg ) == 0 ) )
+				errx( -1, "--json requires a format specifier, not \"%s\"", optarg );
+			else
 			if( strcmp( MAGIC_FORMAT_ID_STD, optarg ) == 0 )
 				_emit = format_standard;
 			else
 			if( strcmp( MAGIC_FORMAT_ID_TCGA, optarg ) == 0 )
 				_emit = format_tcga;
-			else {
+			else
+			if( strcmp( MAGIC_FORMAT_ID_BIN, optarg ) == 0 ) {
+				_emit = format_binary;
+				_structured_output = true;
+			} else {
 				const char *specifier
 					= emit_config( optarg, c=='J' ? FORMAT_JSON : FORMAT_TABULAR );
 				if( specifier ) {
@@ -1059,6 +2578,26 @@ int main( int argc, char *argv[] ) {
 			_analyze = _fdr_cache;
 			break;
 
+		case 260: // ...because I haven't defined a short form for this
+			opt_fdr_store_results = true;
+			break;
+
+		case 261: // ...because I haven't defined a short form for this
+			if( ! ( atoi( optarg ) > 0 ) )
+				errx( -1, "invalid top-K count \"%s\"", optarg );
+			opt_top_k = atoi( optarg );
+			break;
+
+		case 262: // ...because I haven't defined a short form for this
+			if( strcmp( optarg, TOP_BY_SIGN ) == 0 )
+				opt_top_by_sign = true;
+			else
+			if( strcmp( optarg, TOP_BY_P ) == 0 )
+				opt_top_by_sign = false;
+			else
+				errx( -1, "--top-by expects \"%s\" or \"%s\"", TOP_BY_P, TOP_BY_SIGN );
+			break;
+
 		case 'v': // verbosity
 			opt_verbosity = atoi( optarg );
 			break;
@@ -1082,6 +2621,7 @@ int main( int argc, char *argv[] ) {
 				opt_p_value     = 1.0;
 			}
 			dbg_silent     = strchr( optarg, 'S' ) != NULL;
+			dbg_no_prefilter = strchr( optarg, 'P' ) != NULL;
 			break;
 #endif
 		case -1: // ...signals no more options.
@@ -1167,7 +2707,7 @@ int main( int argc, char *argv[] ) {
 				? atoi( getenv("DRY_RUN_COUNT") )
 				: 8;
 
-			int isnum, lua_status = LUA_YIELD;
+			int lua_status = LUA_YIELD;
 
 			lua_getglobal( _L, opt_coroutine );
 			if( lua_isnil( _L, -1 ) )
@@ -1179,12 +2719,9 @@ int main( int argc, char *argv[] ) {
 				lua_status = lua_resume( _L, NULL, 1 );
 				if( lua_status <= LUA_YIELD /* OK == 0, YIELD == 1*/ ) {
 					// Only output coroutine.yield'ed values...
-					if( lua_status == LUA_YIELD ) {
-						const int b = lua_tonumberx( _L, -1, &isnum );
-						const int a = lua_tonumberx( _L, -2, &isnum );
-						lua_pop( _L, 2 );
-						fprintf( stdout, "%d %d\n", a, b );
-					}
+					if( lua_status == LUA_YIELD
+							&& _lua_visit_yield( _L, COUNT, _print_generated_pair, stdout ) < 0 )
+						warnx( "%s yielded neither a pair nor a block of pairs", opt_coroutine );
 				} else
 					fputs( lua_tostring( _L, -1 ), stderr );
 			}
@@ -1202,6 +2739,72 @@ int main( int argc, char *argv[] ) {
 	  * Catch simple argument inconsistencies and fail early!
 	  */
 
+	if( opt_threads > 1
+			&& ( opt_preproc_matrix || opt_single_pair || opt_pairlist_source || opt_select
+#ifdef HAVE_LUA
+				|| opt_coroutine
+#endif
+			) ) {
+		if( opt_verbosity >= V_WARNINGS )
+			warnx( "--threads applies only to all-pairs analysis; ignored.\n" );
+		opt_threads = 1;
+	}
+
+	if( opt_shards > 0
+			&& ( opt_single_pair || opt_pairlist_source || opt_select
+#ifdef HAVE_LUA
+				|| opt_coroutine
+#endif
+			) ) {
+		if( opt_verbosity >= V_WARNINGS )
+			warnx( "--shard applies only to all-pairs and cross-product analysis; ignored.\n" );
+		opt_shards = 0;
+	}
+
+	// Neither the FDR threshold nor the K strongest results of a feature
+	// can be determined from one shard's pairs.
+
+	if( opt_shards > 0 ) {
+		if( USE_FDR_CONTROL )
+			errx( -1, "--shard and --fdr are mutually exclusive" );
+		if( opt_top_k > 0 )
+			errx( -1, "--shard and --top-k are mutually exclusive" );
+	}
+
+	if( opt_checkpoint ) {
+		if( opt_preproc_matrix || opt_single_pair || opt_pairlist_source || opt_select
+#ifdef HAVE_LUA
+				|| opt_coroutine
+#endif
+				) {
+			if( opt_verbosity >= V_WARNINGS )
+				warnx( "--checkpoint applies only to all-pairs analysis; ignored.\n" );
+			opt_checkpoint = NULL;
+		} else {
+			if( opt_top_k > 0 )
+				errx( -1, "--checkpoint can't preserve --top-k results" );
+			if( opt_threads > 1 ) {
+				if( opt_verbosity >= V_WARNINGS )
+					warnx( "--checkpoint requires a single process; use --shard instead of --threads.\n" );
+				opt_threads = 1;
+			}
+		}
+	}
+	if( opt_resume && opt_checkpoint == NULL )
+		errx( -1, "--resume requires --checkpoint" );
+
+	if( opt_select ) {
+		const char *error;
+		_pairsel = pairsel_compile( opt_select, &error );
+		if( _pairsel == NULL ) {
+			if( error )
+				errx( -1, "invalid pair selection at \"%s\"", error );
+			else
+				err( -1, "compiling pair selection" );
+		}
+		atexit( _freePairSel );
+	}
+
 	if( opt_single_pair ) {
 		if( USE_FDR_CONTROL ) {
 			warnx( "FDR is senseless on a single pair.\n" );
@@ -1283,6 +2886,9 @@ int main( int argc, char *argv[] ) {
 				MAXLEN_FS,
 				"by %s in %s",
 				opt_by_name ? "name" : "offset", opt_pairlist_source );
+		} else
+		if( opt_select ) {
+			strncpy( feature_selection, opt_select, MAXLEN_FS );
 		} else {
 #ifdef HAVE_LUA
 			if( opt_coroutine )
@@ -1292,6 +2898,12 @@ int main( int argc, char *argv[] ) {
 					opt_coroutine, opt_script /* may be literal source */ );
 			else
 #endif
+			if( opt_threads > 1 )
+				snprintf( feature_selection,
+					MAXLEN_FS,
+					"all-pairs (%d workers%s)",
+					opt_threads, opt_unordered ? ", unordered" : "" );
+			else
 				strncpy( feature_selection, "all-pairs", MAXLEN_FS );
 		}
 
@@ -1301,12 +2913,14 @@ int main( int argc, char *argv[] ) {
 			"      output: %s\n"
 #ifdef _DEBUG
 			"       debug: silent: %s\n"
+			"       debug: no prefilter: %s\n"
 #endif
 			,i_file,
 			feature_selection,
 			o_file
 #ifdef _DEBUG
 			, _YN( dbg_silent )
+			, _YN( dbg_no_prefilter )
 #endif
 			);
 	}
@@ -1350,6 +2964,22 @@ int main( int argc, char *argv[] ) {
 			"\tCtrl-C will terminated gracelessly\n" );
 	}
 
+	// Preemptive schedulers announce termination with SIGTERM.
+
+	if( opt_checkpoint && SIG_ERR == signal( SIGTERM, _interrupt ) )
+		warn( "failed installing termination handler" );
+
+	if( opt_resume ) {
+		if( checkpoint_read( opt_checkpoint, &_checkpoint ) )
+			errx( -1, "\"%s\" is not a readable checkpoint", opt_checkpoint );
+		if( _checkpoint.rows != _matrix.rows || _checkpoint.columns != _matrix.columns
+				|| _checkpoint.shard != opt_shard || _checkpoint.shards != opt_shards )
+			errx( -1, "checkpoint \"%s\" is of a different input or shard", opt_checkpoint );
+		if( strcmp( o_file, NAME_STDOUT ) == 0 )
+			errx( -1, "--resume requires an output file" );
+		_resume_row = _checkpoint.l;
+	}
+
 	/**
 	  * Choose and open, if necessary, an output stream.
 	  */
@@ -1357,35 +2987,143 @@ int main( int argc, char *argv[] ) {
 	_fp_output
 		= (strcmp( o_file, NAME_STDOUT ) == 0 )
 		? stdout
-		: fopen( o_file, "w" );
+		: fopen( o_file, opt_resume ? "r+" : "w" );
 
 	if( NULL == _fp_output ) {
 		err( -1, "opening output file \"%s\"", o_file );
 	}
 
+	// Checkpoints record (and must sync) the output's length.
+
+	if( opt_checkpoint
+			&& ( _fp_output == stdout || ftell( _fp_output ) < 0 ) )
+		errx( -1, "--checkpoint requires output to a (seekable) file" );
+
+	if( ! isatty( fileno( _fp_output ) ) )
+		setvbuf( _fp_output, NULL, _IOFBF, OUTPUT_BUFFER_SIZE );
+
+	_fp_notes = _structured_output ? stderr : _fp_output;
+
+	// Resumption discards whatever followed the checkpoint, including any
+	// partial line, and appends from there.
+
+	if( opt_resume ) {
+		if( ftruncate( fileno( _fp_output ), _checkpoint.output )
+				|| fseek( _fp_output, 0, SEEK_END ) )
+			err( -1, "truncating \"%s\" to its checkpoint", o_file );
+		if( opt_verbosity >= V_INFO )
+			fprintf( _fp_notes, "# resuming at row %d\n", _resume_row );
+	} else
+	if( _emit == format_binary && _write_binary_header() )
+		err( -1, "writing output header" );
+
 	if( covan_init( _matrix.columns ) ) {
 		err( -1, "error: covan_init(%d)\n", _matrix.columns );
 	} else
 		atexit( covan_fini );
 
-	if( opt_verbosity >= V_INFO )
-		fprintf( _fp_output, "# %d rows/features X %d columns/samples\n", _matrix.rows, _matrix.columns );
+	if( opt_telemetry >= 0 ) {
+		_telemetry = &_telemetry_total;
+		telemetry_epoch( &_telemetry_epoch );
+		covan_set_telemetry( _telemetry );
+		_telemetry_signals( true );
+		if( opt_telemetry > 0 ) {
+			const struct itimerval PERIOD = {
+				.it_interval = { .tv_sec = opt_telemetry },
+				.it_value    = { .tv_sec = opt_telemetry } };
+			if( setitimer( ITIMER_REAL, &PERIOD, NULL ) )
+				warn( "starting the progress timer" );
+		}
+	}
+
+	if( opt_top_k > 0 ) {
+		if( USE_FDR_CONTROL )
+			errx( -1, "--top-k and --fdr are mutually exclusive" );
+		_topk = topk_create( opt_preproc_matrix ? TOPK_CROSS_ROWS : _matrix.rows, opt_top_k );
+		if( NULL == _topk )
+			err( -1, "allocating top-%u results of %d rows", opt_top_k, _matrix.rows );
+		atexit( _freeTopK );
+		_analyze = _topk_collect;
+	}
+
+	// _filter (and the top-K collector) need only know which side of the
+	// threshold p-values lie.
+
+	if( ( _analyze == _filter || _analyze == _topk_collect ) && opt_p_value < 1.0 )
+		covan_set_threshold( opt_p_value );
+
+	if( opt_row_cache > 0 ) {
+		_rowcache = rowcache_create( &_matrix, (size_t)opt_row_cache << 20 );
+		if( NULL == _rowcache ) {
+			err( -1, "error: rowcache_create" );
+		} else {
+			atexit( _freeRowCache );
+			covan_use_rowcache( _rowcache );
+		}
+	}
 
 	if( USE_FDR_CONTROL ) {
-		_fdr_cache_fp = tmpfile();
-		_fdr_uncached_count = 0;
-		if( NULL == _fdr_cache_fp )
-			err( -1, "creating a temporary file" );
+		// Cross-products are only ever reported minimally.
+		if( opt_preproc_matrix )
+			opt_fdr_store_results = false;
+		if( _fdr_all_pairs() && ! opt_fdr_store_results && ! opt_checkpoint ) {
+			_fdr_hist = fdr_hist_create();
+			if( NULL == _fdr_hist )
+				err( -1, "allocating FDR histogram" );
+			atexit( _freeFDRHistogram );
+			_analyze = _fdr_count;
+		} else
+		if( opt_checkpoint ) {
+			// The cache must survive the process to be resumed.
+			_fdr_cache_name = malloc( strlen( opt_checkpoint ) + sizeof(FDR_CACHE_SUFFIX) );
+			if( NULL == _fdr_cache_name )
+				err( -1, "naming the FDR cache" );
+			strcpy( _fdr_cache_name, opt_checkpoint );
+			strcat( _fdr_cache_name, FDR_CACHE_SUFFIX );
+			_fdr_cache_fp = fopen( _fdr_cache_name, opt_resume ? "r+" : "w+" );
+			if( NULL == _fdr_cache_fp
+					|| ( opt_resume
+						&& ( ftruncate( fileno( _fdr_cache_fp ), _checkpoint.fdr )
+						|| fseek( _fdr_cache_fp, 0, SEEK_END ) ) ) )
+				err( -1, "opening FDR cache \"%s\"", _fdr_cache_name );
+			_fdr_uncached_count = 0;
+		} else {
+			_fdr_cache_fp = tmpfile();
+			_fdr_uncached_count = 0;
+			if( NULL == _fdr_cache_fp )
+				err( -1, "creating a temporary file" );
+		}
+	}
+
+	if( opt_resume ) {
+		_insignificant      = _checkpoint.insignificant;
+		_untested           = _checkpoint.untested;
+		_fdr_uncached_count = _checkpoint.fdr_uncached;
+		_fdr_max_p          = _checkpoint.fdr_max_p;
 	}
 
+	if( _build_live_index() ) {
+		err( -1, "error: building live row index" );
+	} else
+		atexit( _freeLiveIndex );
+
+	_shard_first = 0;
+	_shard_last  = _matrix.rows;
+	if( opt_shards > 0 && ! opt_preproc_matrix )
+		_shard_all_pairs();
+
+	if( opt_verbosity >= V_INFO )
+		fprintf( _fp_notes, "# %d rows/features X %d columns/samples\n", _matrix.rows, _matrix.columns );
+
 	/**
 	  * Here the main decision is made regarding feature selection.
 	  * In order of precedence:
 	  * 0. cross-product of matrices
 	  * 1. single pair
 	  * 2. explicit pairs (by name or by offset)
-	  * 3. Lua-generated offsets
-	  * 4. all-pairs
+	  * 3. pair-selection spec
+	  * 4. Lua-generated offsets
+	  * 5. all-pairs
 	  */
 
 	if( opt_preproc_matrix ) {
@@ -1432,7 +3170,7 @@ int main( int argc, char *argv[] ) {
 			if( fseek( ppm[1], hdr.section[ S_DESC ].offset, SEEK_SET ) )
 				err( -1, "failed seeking to start of data" );
 
-			_analyze_cross_product( &hdr, ppm );
+			analysis_status = _analyze_cross_product( &hdr, ppm );
 
 			fclose( ppm[1] );
 			fclose( ppm[0] );
@@ -1467,6 +3205,11 @@ int main( int argc, char *argv[] ) {
 		} else
 			warn( "opening \"%s\"", opt_pairlist_source );
 
+	} else
+	if( opt_select ) {
+
+		_analyze_selection( _pairsel );
+
 	} else {
 
 #ifdef HAVE_LUA
@@ -1474,28 +3217,61 @@ int main( int argc, char *argv[] ) {
 			_analyze_generated_pair_list( _L );
 		else
 #endif
-			_analyze_all_pairs();
+		if( opt_threads > 1 )
+			analysis_status = _analyze_all_pairs_concurrently( opt_threads );
+		else
+			analysis_status = _analyze_all_pairs();
 	}
 
+	// Cross-products emitted top-K results row by row.
+
+	if( _topk && ! opt_preproc_matrix )
+		_topk_emit_all();
+
 	// Post process results if FDR is in effect and the 1st pass was
 	// allowed to complete. (Post-processing involves a repetition of
-	// analysis FOR A SUBSET of the original input.)
+	// analysis of all or a subset of the original input.)
 
 	if( USE_FDR_CONTROL && (! _sigint_received) ) {
-		_fdr_postprocess( _fdr_cache_fp, arg_q_value, _fp_output, opt_preproc_matrix != NULL );
+		if( _fdr_hist )
+			_fdr_rerun_all_pairs( arg_q_value, _fp_output );
+		else
+		if( opt_fdr_store_results )
+			_fdr_postprocess_stored( _fdr_cache_fp, arg_q_value, _fp_output );
+		else
+			_fdr_postprocess( _fdr_cache_fp, arg_q_value, _fp_output, opt_preproc_matrix != NULL );
 	} else
 	if( opt_verbosity >= V_ESSENTIAL ) {
-		fprintf( _fp_output, 
-				"# %d filtered for insignificance\n"
-				"# %d filtered for some sort of degeneracy\n", 
+		fprintf( _fp_notes, 
+				"# %" PRIu64 " filtered for insignificance\n"
+				"# %" PRIu64 " filtered for some sort of degeneracy\n", 
 				_insignificant,
 				_untested );
 		// ...which does not apply in FDR control context.
 	}
 
+	if( opt_shards > 0 )
+		_write_shard_manifest( i_file, o_file, analysis_status == 0 && ! _sigint_received );
+
+	if( _telemetry ) {
+		const struct itimerval STOP = { .it_value = { .tv_sec = 0 } };
+		setitimer( ITIMER_REAL, &STOP, NULL );
+		telemetry_json( stderr, _telemetry, &_telemetry_epoch, _insignificant, _untested );
+	}
+
 	if( _fdr_cache_fp )
 		fclose( _fdr_cache_fp );
 
+	// A finished run needs neither its checkpoint nor its FDR cache.
+
+	if( opt_checkpoint && analysis_status == 0 && ! _sigint_received ) {
+		unlink( opt_checkpoint );
+		if( _fdr_cache_name )
+			unlink( _fdr_cache_name );
+	}
+	if( _fdr_cache_name )
+		free( _fdr_cache_name );
+
 	if( _fp_output )
 		fclose( _fp_output );
 
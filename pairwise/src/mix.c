@@ -23,23 +23,9 @@
 #include "mix.h"
 #include "bvr.h"
 #include "limits.h"
-
-struct Pair {
-	float cv; // Continuous Variable
-	unsigned int dv; // Discrete Variable
-};
-
-
-static int _cmp_pair( const void *pvl, const void *pvr ) {
-	const struct Pair *l = (const struct Pair *)pvl;
-	const struct Pair *r = (const struct Pair *)pvr;
-	const float delta = l->cv - r->cv;
-	if( delta == 0.0 )
-		return 0.0;
-	else
-		return  delta < 0.0 ? -1 : +1;
-}
-
+#include "rsort.h"
+#include "critical.h"
+#include "telemetry.h"
 
 struct MixCovars {
 
@@ -101,9 +87,14 @@ struct MixCovars {
 	size_t SIZEOF_BUFFERS;
 
 	/**
-	  * Two buffers
+	  * Samples' continuous values (keys) and categories (values).
+	  */
+	struct rsort_pair *samples;
+
+	/**
+	  * Scratch space for sorting samples.
 	  */
-	struct Pair *samples;
+	void *sort_scratch;
 
 	/**
 	  * A buffer allocated once in construction and reused for 
@@ -111,6 +102,23 @@ struct MixCovars {
 	  * Reallocation is not currently supported.
 	  */
 	unsigned int *category_count;
+
+	/**
+	  * True while samples have been pushed in nondecreasing order of
+	  * their continuous values, in which case ranking needn't sort.
+	  */
+	bool sorted;
+
+	/**
+	  * Chi-square critical values for the threshold set by
+	  * mix_setSignificanceThreshold, indexed by degrees of freedom.
+	  */
+	struct CriticalValues critical;
+
+	/**
+	  * Phases are timed into this if it is non-NULL.
+	  */
+	struct telemetry *telemetry;
 };
 
 
@@ -163,14 +171,15 @@ static unsigned int _rank_sums( struct MixCovars *co,
 	float rank = 0;
 	double diff;
 
-	// The default pair::operator< automatically uses the first element.
-
-	qsort( co->samples, co->sample_count, sizeof(struct Pair), _cmp_pair );
+	if( ! co->sorted ) {
+		rsort_pairs( co->samples, co->sample_count, co->sort_scratch );
+		co->sorted = true;
+	}
 
 	for(unsigned int i = 0; i < N; i++ ) {
 
 		const unsigned int cat 
-			= co->samples[i].dv;
+			= co->samples[i].value;
 
 		// The rank of the current sample is i+1 UNLESS we're in
 		// the midst of a run of samples with the same value in
@@ -180,7 +189,7 @@ static unsigned int _rank_sums( struct MixCovars *co,
 
 			until = i + 1;
 			while( until < N 
-					&& ( co->samples[i].cv == co->samples[until].cv ) ) {
+					&& ( co->samples[i].key == co->samples[until].key ) ) {
 				ties++;
 				until++;
 			}
@@ -223,7 +232,7 @@ static unsigned int _rank_sums( struct MixCovars *co,
 #if defined(_UNITTEST_MIX_)
 static void dbg_dump( struct MixCovars *co, FILE *fp ) {
 	for(unsigned int i = 0; i < co->sample_count; i++ )
-		fprintf( fp, "%.3f\t%d\n", co->samples[i].cv, co->samples[i].dv );
+		fprintf( fp, "%.3f\t%d\n", co->samples[i].key, co->samples[i].value );
 }
 #endif
 
@@ -235,6 +244,9 @@ void mix_destroy( void *pv ) {
 
 	if( pv ) {
 		struct MixCovars *co = (struct MixCovars *)pv;
+		crit_fini( &co->critical );
+		if( co->sort_scratch )
+			rsort_free( co->sort_scratch );
 		if( co->samples )
 			free( co->samples );
 		free( pv );
@@ -254,7 +266,7 @@ void *mix_create( unsigned int sample_capacity, unsigned int category_capacity )
 		co->SAMPLE_CAPACITY   = sample_capacity;
 		co->CATEGORY_CAPACITY = category_capacity;
 		co->SIZEOF_BUFFERS
-			= ( sample_capacity * sizeof(struct Pair) )
+			= ( sample_capacity * sizeof(struct rsort_pair) )
 			+ ( category_capacity * sizeof(unsigned int) );
 
 		// Allocate one large buffer and partition it up.
@@ -263,8 +275,10 @@ void *mix_create( unsigned int sample_capacity, unsigned int category_capacity )
 		co->category_count
 			= (unsigned int*)(co->samples
 			+ sample_capacity);
+		co->sort_scratch = rsort_alloc( sample_capacity );
 		// If -anything- failed clean up any successes.
-		if( NULL == co->samples ) {
+		if( NULL == co->samples || NULL == co->sort_scratch
+			|| crit_init( &co->critical, gsl_cdf_chisq_Qinv, category_capacity ) ) {
 			mix_destroy( co );
 			return NULL;
 		}
@@ -288,11 +302,22 @@ void mix_clear( void *pv, unsigned expcat ) {
 	co->sum_dev_prod = 0.0;
 	memset( co->edge, 0, sizeof(co->edge) );
 	co->sum_dev_prod = 0.0;
+	co->sorted       = true;
 
 	memset( co->samples, 0, co->SIZEOF_BUFFERS );
 }
 
 
+void mix_setSignificanceThreshold( void *pv, double p ) {
+	crit_set_threshold( &((struct MixCovars *)pv)->critical, p );
+}
+
+
+void mix_setTelemetry( void *pv, struct telemetry *tm ) {
+	((struct MixCovars *)pv)->telemetry = tm;
+}
+
+
 void mix_push( void *pv, float num, unsigned int cat ) {
 
 	struct MixCovars *co = (struct MixCovars *)pv;
@@ -308,8 +333,10 @@ void mix_push( void *pv, float num, unsigned int cat ) {
 	// Not updating edges in here because the number of conditionals
 	// executed for sample counts > 32 exceeds the work to find the
 	// edges post-sample accumulation.
-	co->samples[ co->sample_count ].cv = num;
-	co->samples[ co->sample_count ].dv = cat;
+	if( co->sample_count > 0 && num < co->samples[ co->sample_count-1 ].key )
+		co->sorted = false;
+	co->samples[ co->sample_count ].key = num;
+	co->samples[ co->sample_count ].value = cat;
 	co->sample_count++;
 }
 
@@ -390,11 +417,14 @@ int mix_kruskal_wallis( void *pv, struct Statistic *result ) {
 	double *rank_sum
 		= (double*)alloca( SIZEOF_SUMS );
 	double numerator = 0.0;
+	uint64_t mark = tm_start( co->telemetry );
 
 	memset( rank_sum, 0, SIZEOF_SUMS   );
 
 	result->extra_value[0] = _rank_sums( co, rank_sum );
 
+	tm_lap( co->telemetry, TM_RANK, &mark );
+
 	for(unsigned int i = 0; i <= co->edge[1].index; i++ ) {
 		if( co->category_count[i] > 0 ) {
 			rank_sum[i] /= co->category_count[i];
@@ -411,8 +441,12 @@ int mix_kruskal_wallis( void *pv, struct Statistic *result ) {
 		= N;
 	result->value
 		= (N-1) * ( numerator / co->sum_sq_dev );
+	tm_lap( co->telemetry, TM_STATISTIC, &mark );
 	result->probability
-		= gsl_cdf_chisq_Q( result->value, co->observed_categories-1 );
+		= crit_falls_short( &co->critical, result->value, co->observed_categories-1 )
+		? 1.0
+		: gsl_cdf_chisq_Q( result->value, co->observed_categories-1 );
+	tm_lap( co->telemetry, TM_PVALUE, &mark );
 
 	return 0;
 }
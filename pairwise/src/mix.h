@@ -6,6 +6,25 @@ void mix_destroy( void *pv );
 void *mix_create( unsigned int sample_capacity, unsigned int category_capacity );
 
 void mix_clear( void *pv, unsigned cap );
+
+/**
+  * Once a threshold in (0,1) is set, Kruskal-Wallis tests whose p-values
+  * certainly exceed it report p-value 1.0 without computing it exactly.
+  * Any other value restores exact computation of all p-values.
+  */
+void mix_setSignificanceThreshold( void *pv, double p );
+
+/**
+  * Time ranking, statistic and p-value phases into tm (see telemetry.h);
+  * NULL stops timing.
+  */
+struct telemetry;
+void mix_setTelemetry( void *pv, struct telemetry *tm );
+
+/**
+  * Samples pushed in nondecreasing order of num (e.g. by walking a row's
+  * sample order) are ranked without sorting.
+  */
 void mix_push(  void *pv, float num, unsigned int cat );
 size_t mix_size( void *pv );
 bool mix_complete( void *pv );
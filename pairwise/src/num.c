@@ -12,6 +12,8 @@
 
 #include "rank.h"
 #include "stattest.h"
+#include "critical.h"
+#include "telemetry.h"
 #include "num.h"
 
 typedef float con_t;
@@ -39,7 +41,25 @@ struct ConCovars {
 	  */
 	con_t *l, *r;
 
+	/**
+	  * Used instead of the buffers' contents when covariates are pushed
+	  * by con_mark: position[i] is the index of sample i among the
+	  * samples common to both covariates or -1.
+	  */
+	int *position;
+
 	void *rank_scratch;
+
+	/**
+	  * t-distribution critical values for the threshold set by
+	  * con_setSignificanceThreshold, indexed by N-2.
+	  */
+	struct CriticalValues critical;
+
+	/**
+	  * Phases are timed into this if it is non-NULL.
+	  */
+	struct telemetry *telemetry;
 };
 
 #if defined(_UNITTEST_NUM_)
@@ -54,8 +74,11 @@ void con_destroy( void *pv ) {
 
 	if( pv ) {
 		struct ConCovars *co = (struct ConCovars *)pv;
+		crit_fini( &co->critical );
 		if( co->rank_scratch )
 			rank_free( co->rank_scratch );
+		if( co->position )
+			free( co->position );
 		if( co->l )
 			free( co->l );
 		free( pv );
@@ -63,6 +86,14 @@ void con_destroy( void *pv ) {
 }
 
 
+/**
+  * The p-value below is two-tailed.
+  */
+static double _tdist_two_tailed_Qinv( double P, double nu ) {
+	return gsl_cdf_tdist_Qinv( P/2, nu );
+}
+
+
 /**
   * Pre-allocate a set of working buffers large enough for all anticipated
   * calculations (max feature length) and a struct to wrap them.
@@ -76,10 +107,13 @@ void *con_create( unsigned int cap ) {
 		// Allocate one large buffer and partition it up.
 		co->l = calloc( co->SIZEOF_BUFFERS, sizeof(char) );
 		co->r = co->l + cap;
+		co->position = calloc( cap, sizeof(int) );
 		co->rank_scratch = rank_alloc( cap );
 		// If -anything- failed clean up any successes.
 		if( (NULL == co->l) || 
-			(NULL == co->rank_scratch) ) {
+			(NULL == co->position) ||
+			(NULL == co->rank_scratch) ||
+			crit_init( &co->critical, _tdist_two_tailed_Qinv, cap ) ) {
 			con_destroy( co );
 			return NULL;
 		}
@@ -105,6 +139,19 @@ void con_push( void *pv, float n1, float n2 ) {
 }
 
 
+/**
+  * Alternative to con_push for covariates whose sample orders are known
+  * (see con_spearman_correlation_presorted). Only whether sample i is
+  * common to both covariates is recorded. Every sample must be marked,
+  * in order.
+  */
+void con_mark( void *pv, unsigned int i, bool common ) {
+	struct ConCovars *co = (struct ConCovars *)pv;
+	assert( i < co->SAMPLE_CAPACITY );
+	co->position[i] = common ? co->sample_count++ : -1;
+}
+
+
 size_t con_size( void *pv ) {
 	return ((struct ConCovars *)pv)->sample_count;
 }
@@ -116,6 +163,82 @@ bool con_complete( void *pv ) {
 }
 
 
+void con_setSignificanceThreshold( void *pv, double p ) {
+	crit_set_threshold( &((struct ConCovars *)pv)->critical, p );
+}
+
+
+void con_setTelemetry( void *pv, struct telemetry *tm ) {
+	((struct ConCovars *)pv)->telemetry = tm;
+}
+
+
+/**
+  * The p-value of a Spearman correlation coefficient.
+  * If co is non-NULL and has a significance threshold, a coefficient that
+  * certainly falls short of it is reported with p-value 1.0 without
+  * evaluating the t-distribution.
+  */
+static void _spearman_significance( struct ConCovars *co,
+		const double rho, const int N,
+		struct Statistic *result ) {
+
+	struct telemetry *tm = co ? co->telemetry : NULL;
+	uint64_t mark = tm_start( tm );
+
+	/**
+	 * P-value computation for the correlation.
+	 */
+
+#ifdef HAVE_FISHER_TRANSFORM
+	const double FisherTransform 
+		//= 0.5 * log( (1.+rho) / (1.-rho) );
+		= atanh(rho);
+	// ...absolute value to simplify CDF use below, since the
+	// transformation is symmetric.
+	const double z
+		= sqrt( (N - 3.0) / 1.06 ) * FisherTransform;
+	// ...z ~ N(0,1) under null hyp of statistical independence.
+	result->name
+		= "Spearman_rho,Fisher_transform";
+	result->probability = gsl_cdf_ugaussian_Q( fabs(z) );
+#else
+	const double t 
+		=  fabs( rho*sqrt((N-2.0)/(1.0-rho*rho)) );
+	// ...abs so that I can always test the upper tail.
+	// x2 below to make it a two-tailed test. (t-distribution
+	// is symmetric).
+	result->name
+		= "Spearman_rho,t-distribution";
+	result->probability
+		= co && crit_falls_short( &co->critical, t, N-2 )
+		? 1.0
+		: 2* gsl_cdf_tdist_Q(t,N-2.0);
+#endif
+	result->value = rho;
+	result->sample_count = N;
+	tm_lap( tm, TM_PVALUE, &mark );
+}
+
+
+/**
+  * Everything following ranking: the correlation of the rank vectors and
+  * its p-value.
+  */
+static void _spearman_of_ranks( struct ConCovars *co,
+		const con_t *l, const con_t *r, const int N,
+		struct Statistic *result ) {
+
+	struct telemetry *tm = co ? co->telemetry : NULL;
+	uint64_t mark = tm_start( tm );
+	const double RHO
+		= gsl_stats_float_correlation( l, 1, r, 1, N );
+	tm_lap( tm, TM_STATISTIC, &mark );
+
+	_spearman_significance( co, RHO, N, result );
+}
+
+
 /**
  */
 int con_spearman_correlation( void *pv, struct Statistic *result ) {
@@ -126,49 +249,104 @@ int con_spearman_correlation( void *pv, struct Statistic *result ) {
 	assert( N > 2 );
 	assert( NULL != co->rank_scratch );
 
+	uint64_t mark = tm_start( co->telemetry );
+
 	const int rinfo1 
 		= rank_floats( co->l, N, 0, co->rank_scratch );
 	const int rinfo2 
 		= rank_floats( co->r, N, 0, co->rank_scratch );
 
+	tm_lap( co->telemetry, TM_RANK, &mark );
+
 	if( RANK_STATUS_CONST & rinfo1 ) // vectors were in fact constant!
 		result->extra_value[0] = N-1;
 	if( RANK_STATUS_CONST & rinfo2 )
 		result->extra_value[1] = N-1;
 
-	{
-		const double rho 
-			= gsl_stats_float_correlation( co->l, 1, co->r, 1, N );
+	_spearman_of_ranks( co, co->l, co->r, N, result );
 
-		/**
-		 * P-value computation for the correlation.
-		 */
+	return 0;
+}
 
-#ifdef HAVE_FISHER_TRANSFORM
-		const double FisherTransform 
-			//= 0.5 * log( (1.+rho) / (1.-rho) );
-			= atanh(rho);
-		// ...absolute value to simplify CDF use below, since the
-		// transformation is symmetric.
-		const double z
-			= sqrt( (N - 3.0) / 1.06 ) * FisherTransform;
-		// ...z ~ N(0,1) under null hyp of statistical independence.
-		result->name
-			= "Spearman_rho,Fisher_transform";
-		result->probability = gsl_cdf_ugaussian_Q( fabs(z) );
-#else
-		const double t 
-			=  fabs( rho*sqrt((N-2.0)/(1.0-rho*rho)) );
-		// ...abs so that I can always test the upper tail.
-		// x2 below to make it a two-tailed test. (t-distribution
-		// is symmetric).
-		result->name
-			= "Spearman_rho,t-distribution";
-		result->probability = 2* gsl_cdf_tdist_Q(t,N-2.0);
-#endif
-		result->value = rho;
-	}
-	result->sample_count = N;
+
+/**
+  * Equivalent to con_spearman_correlation for covariates pushed with
+  * con_mark, but the common samples are ranked by walking each row's
+  * sample order (from rank_order_floats) rather than by sorting.
+  */
+int con_spearman_correlation_presorted( void *pv,
+		const float *ldata, const unsigned int *lorder, unsigned int lcount,
+		const float *rdata, const unsigned int *rorder, unsigned int rcount,
+		struct Statistic *result ) {
+
+	struct ConCovars *co = (struct ConCovars *)pv;
+	const int N = co->sample_count;
+
+	assert( N > 2 );
+
+	uint64_t mark = tm_start( co->telemetry );
+
+	const int rinfo1
+		= rank_floats_masked( ldata, lorder, lcount, co->position, co->l );
+	const int rinfo2
+		= rank_floats_masked( rdata, rorder, rcount, co->position, co->r );
+
+	tm_lap( co->telemetry, TM_RANK, &mark );
+
+	if( RANK_STATUS_CONST & rinfo1 )
+		result->extra_value[0] = N-1;
+	if( RANK_STATUS_CONST & rinfo2 )
+		result->extra_value[1] = N-1;
+
+	_spearman_of_ranks( co, co->l, co->r, N, result );
+
+	return 0;
+}
+
+
+/**
+  * Spearman correlation of two rows that have already been ranked (in
+  * their entirety) and have no missing values. Status args are those
+  * returned by rank_floats. The accumulator (which may be NULL) is
+  * consulted only for its significance threshold.
+  */
+int con_spearman_correlation_ranked( void *pv,
+		const float *lrank, int lstatus,
+		const float *rrank, int rstatus,
+		unsigned int N,
+		struct Statistic *result ) {
+
+	assert( N > 2 );
+
+	if( RANK_STATUS_CONST & lstatus )
+		result->extra_value[0] = N-1;
+	if( RANK_STATUS_CONST & rstatus )
+		result->extra_value[1] = N-1;
+
+	_spearman_of_ranks( (struct ConCovars *)pv, lrank, rrank, N, result );
+
+	return 0;
+}
+
+
+/**
+  * Completes a Spearman correlation the coefficient of which was computed
+  * elsewhere (e.g. in bulk by corblock.c) from the ranks of two complete
+  * rows. The accumulator is used as by con_spearman_correlation_ranked.
+  */
+int con_spearman_from_rho( void *pv, double rho,
+		int lstatus, int rstatus,
+		unsigned int N,
+		struct Statistic *result ) {
+
+	assert( N > 2 );
+
+	if( RANK_STATUS_CONST & lstatus )
+		result->extra_value[0] = N-1;
+	if( RANK_STATUS_CONST & rstatus )
+		result->extra_value[1] = N-1;
+
+	_spearman_significance( (struct ConCovars *)pv, rho, N, result );
 
 	return 0;
 }
@@ -6,9 +6,24 @@ void   con_destroy( void *pv );
 void  *con_create( unsigned int );
 void   con_clear( void *pv );
 void   con_push( void *pv, float n1, float n2 );
+void   con_mark( void *pv, unsigned int i, bool common );
 size_t con_size( void *pv );
 bool   con_complete( void *pv );
 
+/**
+  * Once a threshold in (0,1) is set, correlations whose p-values certainly
+  * exceed it are reported with p-value 1.0 without computing it exactly.
+  * Any other value restores exact computation of all p-values.
+  */
+void   con_setSignificanceThreshold( void *pv, double p );
+
+/**
+  * Time ranking, statistic and p-value phases into tm (see telemetry.h);
+  * NULL stops timing.
+  */
+struct telemetry;
+void   con_setTelemetry( void *pv, struct telemetry *tm );
+
 
 #ifdef HAVE_SCALAR_PEARSON
 int con_pearson_correlation( void *pv, struct Statistic * );
@@ -16,5 +31,21 @@ int con_pearson_correlation( void *pv, struct Statistic * );
 
 int con_spearman_correlation( void *pv, struct Statistic * );
 
+int con_spearman_correlation_presorted( void *pv,
+		const float *ldata, const unsigned int *lorder, unsigned int lcount,
+		const float *rdata, const unsigned int *rorder, unsigned int rcount,
+		struct Statistic * );
+
+int con_spearman_correlation_ranked( void *pv,
+		const float *lrank, int lstatus,
+		const float *rrank, int rstatus,
+		unsigned int N,
+		struct Statistic * );
+
+int con_spearman_from_rho( void *pv, double rho,
+		int lstatus, int rstatus,
+		unsigned int N,
+		struct Statistic * );
+
 #endif
 
@@ -0,0 +1,367 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <fnmatch.h>
+
+#include "mtmatrix.h"
+#include "pairsel.h"
+
+#define CLASS_N (1)
+#define CLASS_B (2)
+#define CLASS_C (4)
+
+enum FactorKind {
+	F_RANGE,
+	F_CLASS,
+	F_GLOB
+};
+
+struct factor {
+	enum FactorKind kind;
+	bool last_of_term; // ...so terms are runs of factors
+	int first, last;   // F_RANGE: [first,last)
+	unsigned classes;  // F_CLASS
+	const char *glob;  // F_GLOB
+};
+
+struct set {
+	int count;
+	struct factor *factor;
+};
+
+struct pairsel {
+	char *text; // ...a copy of the spec that globs point into
+	int sets;
+	struct set set[2];
+};
+
+
+static bool _parse_range( char *pc, struct factor *f ) {
+
+	char *end;
+
+	f->kind  = F_RANGE;
+	if( ! isdigit( *pc ) )
+		return false;
+	f->first = strtol( pc, &end, 10 );
+	if( *end == 0 ) {
+		f->last = f->first + 1;
+		return true;
+	}
+	if( *end++ != '-' )
+		return false;
+	if( *end == 0 ) {
+		f->last = INT32_MAX;
+		return true;
+	}
+	if( ! isdigit( *end ) )
+		return false;
+	f->last = strtol( end, &end, 10 );
+	return *end == 0 && f->first < f->last;
+}
+
+
+static bool _parse_class( const char *pc, struct factor *f ) {
+
+	f->kind    = F_CLASS;
+	f->classes = 0;
+	while( *pc ) {
+		switch( *pc++ ) {
+		case 'N': f->classes |= CLASS_N; break;
+		case 'B': f->classes |= CLASS_B; break;
+		case 'C': f->classes |= CLASS_C; break;
+		default:
+			return false;
+		}
+	}
+	return f->classes != 0;
+}
+
+
+/**
+  * Parses the set in text (which is modified), appending factors to s.
+  * Returns NULL or the offending text on error.
+  */
+static const char *_parse_set( char *text, struct set *s ) {
+
+	int n = 1;
+	char *pc;
+
+	for(pc = text; *pc; pc++ ) {
+		if( *pc == ',' || *pc == '&' )
+			n += 1;
+	}
+
+	s->factor = calloc( n, sizeof(struct factor) );
+	if( s->factor == NULL )
+		return NULL;
+	s->count = 0;
+
+	pc = text;
+	while( true ) {
+
+		struct factor *f = s->factor + s->count++;
+		char *end = pc + strcspn( pc, ",&" );
+		const char delim = *end;
+		*end = 0;
+
+		f->last_of_term = delim != '&';
+
+		if( *pc == '@' ) {
+			if( ! _parse_range( pc+1, f ) )
+				return pc;
+		} else
+		if( *pc == '%' ) {
+			if( ! _parse_class( pc+1, f ) )
+				return pc;
+		} else {
+			if( *pc == 0 )
+				return pc;
+			f->kind = F_GLOB;
+			f->glob = pc;
+		}
+
+		if( delim == 0 )
+			break;
+		pc = end + 1;
+	}
+	return NULL;
+}
+
+
+struct pairsel *pairsel_compile( const char *spec, const char **error ) {
+
+	struct pairsel *sel = calloc( 1, sizeof(struct pairsel) );
+	char *x;
+
+	*error = NULL;
+	if( sel == NULL || ( sel->text = strdup( spec ) ) == NULL ) {
+		free( sel );
+		return NULL;
+	}
+
+	// The sets are separated by an 'x' delimited by whitespace.
+
+	x = strstr( sel->text, " x " );
+	sel->sets = x ? 2 : 1;
+	if( x ) {
+		*x = 0;
+		x += 3;
+		while( isspace( *x ) ) x++;
+	}
+
+	for(int i = 0; i < sel->sets; i++ ) {
+		char *text = i == 0 ? sel->text : x;
+		char *end = text + strlen( text );
+		while( isspace( *text ) ) text++;
+		while( end > text && isspace( end[-1] ) ) *--end = 0;
+		if( ( *error = _parse_set( text, sel->set + i ) ) != NULL
+				|| sel->set[i].factor == NULL ) {
+			if( *error )
+				*error = spec + ( *error - sel->text );
+			pairsel_destroy( sel );
+			return NULL;
+		}
+	}
+	return sel;
+}
+
+
+void pairsel_destroy( struct pairsel *sel ) {
+	if( sel ) {
+		for(int i = 0; i < sel->sets; i++ )
+			free( sel->set[i].factor );
+		free( sel->text );
+		free( sel );
+	}
+}
+
+
+static unsigned _class_of( const struct mtm_descriptor *d ) {
+	if( ! d->integral )
+		return CLASS_N;
+	return d->cardinality > 2 ? CLASS_C : CLASS_B;
+}
+
+
+static bool _matches( const struct factor *f, const struct mtm_matrix *m, int row ) {
+	switch( f->kind ) {
+	case F_RANGE:
+		return f->first <= row && row < f->last;
+	case F_CLASS:
+		return ( f->classes & _class_of( m->desc + row ) ) != 0;
+	case F_GLOB:
+		return fnmatch( f->glob, m->row_map[ row ].string, 0 ) == 0;
+	}
+	return false;
+}
+
+
+static bool _set_contains( const struct set *s, const struct mtm_matrix *m, int row ) {
+	bool in_term = true;
+	for(int i = 0; i < s->count; i++ ) {
+		if( in_term && ! _matches( s->factor + i, m, row ) )
+			in_term = false;
+		if( s->factor[i].last_of_term ) {
+			if( in_term )
+				return true;
+			in_term = true;
+		}
+	}
+	return false;
+}
+
+
+int pairsel_resolve( const struct pairsel *sel, const struct mtm_matrix *m, struct pairsel_rows side[2] ) {
+
+	for(int i = 0; i < sel->sets; i++ ) {
+		for(int k = 0; k < sel->set[i].count; k++ ) {
+			if( sel->set[i].factor[k].kind == F_GLOB && m->row_map == NULL )
+				return -1;
+		}
+	}
+
+	for(int i = 0; i < sel->sets; i++ ) {
+		struct pairsel_rows *s = side + i;
+		s->count  = 0;
+		s->offset = calloc( m->rows, sizeof(int) );
+		s->member = calloc( m->rows, sizeof(bool) );
+		if( s->offset == NULL || s->member == NULL ) {
+			while( i >= 0 )
+				pairsel_rows_free( side + i-- );
+			return -1;
+		}
+		for(int r = 0; r < m->rows; r++ ) {
+			if( _set_contains( sel->set + i, m, r ) ) {
+				s->member[r] = true;
+				s->offset[ s->count++ ] = r;
+			}
+		}
+	}
+	return sel->sets;
+}
+
+
+void pairsel_rows_free( struct pairsel_rows *s ) {
+	free( s->offset );
+	free( s->member );
+	s->offset = NULL;
+	s->member = NULL;
+	s->count  = 0;
+}
+
+
+#ifdef _UNITTEST_PAIRSEL_
+
+/**
+  * Resolves specs against a made-up 8-row matrix and checks the selected
+  * rows, or, given arguments, lists the rows each selects, e.g.:
+  * ut_pairsel 'N:A:* x %C' '@2-4,@6-&N:*'
+  */
+
+static const struct {
+	const char *spec;
+	const char *rows; // ...as _list() writes them, NULL for a syntax error
+} CASE[] = {
+	{ "N:A:* x %C",    "0 1 x 3 6" },
+	{ "@2-4,@6-&N:*",  "2 3 7" },
+	{ "%NB",           "0 1 2 4 5 7" },
+	{ "*:B:*&%N",      "2 5" },
+	{ "@5-",           "5 6 7" },
+	{ " @3 x  *:C:* ", "3 x 6 7" },
+	{ "N:*:2 x N:*",   "1 7 x 0 1 2 5 7" },
+	{ "Z:*",           "" },
+	{ "@4-2",          NULL },
+	{ "%X",            NULL },
+	{ "N:*,",          NULL }
+};
+
+/**
+  * Writes the rows of each set to buf (of at least 64 characters), the
+  * sets separated by " x ". Returns false if the spec did not compile.
+  */
+static bool _list( const char *spec, const struct mtm_matrix *m, char *buf ) {
+
+	const char *error;
+	struct pairsel_rows side[2];
+	struct pairsel *sel = pairsel_compile( spec, &error );
+
+	*buf = 0;
+	if( sel == NULL ) {
+		sprintf( buf, "error at \"%s\"", error ? error : "?" );
+		return false;
+	}
+	const int N = pairsel_resolve( sel, m, side );
+	for(int k = 0; k < N; k++ ) {
+		if( k ) strcat( buf, " x" );
+		for(int j = 0; j < side[k].count; j++ )
+			sprintf( buf + strlen( buf ), "%s%d", *buf ? " " : "", side[k].offset[j] );
+		pairsel_rows_free( side + k );
+	}
+	pairsel_destroy( sel );
+	return true;
+}
+
+int main( int argc, char *argv[] ) {
+
+	static const char *LABEL[] = {
+		"N:A:1", "N:A:2", "N:B:1", "C:A:3", "B:B:2", "N:B:3", "C:C:1", "N:C:2" };
+	struct mtm_descriptor desc[8];
+	struct mtm_row row_map[8];
+	struct mtm_matrix m;
+	char buf[ 64 ];
+	int failures = 0;
+
+	memset( desc, 0, sizeof(desc) );
+	memset( &m, 0, sizeof(m) );
+	for(int r = 0; r < 8; r++ ) {
+		row_map[r].offset = r;
+		row_map[r].string = LABEL[r];
+		desc[r].integral    = LABEL[r][0] != 'N';
+		desc[r].categorical = LABEL[r][0] != 'N';
+		desc[r].cardinality = LABEL[r][0] == 'C' ? 3 : 2;
+	}
+	m.rows    = 8;
+	m.desc    = desc;
+	m.row_map = row_map;
+
+	if( argc > 1 ) {
+		for(int i = 1; i < argc; i++ ) {
+			_list( argv[i], &m, buf );
+			printf( "%s: %s\n", argv[i], buf );
+		}
+		return EXIT_SUCCESS;
+	}
+
+	for(size_t i = 0; i < sizeof(CASE)/sizeof(CASE[0]); i++ ) {
+		const bool OK = _list( CASE[i].spec, &m, buf );
+		printf( "\"%s\": %s\n", CASE[i].spec, buf );
+		if( CASE[i].rows ? ! OK || strcmp( buf, CASE[i].rows ) : OK ) {
+			printf( "...expected %s\n", CASE[i].rows ? CASE[i].rows : "an error" );
+			failures += 1;
+		}
+	}
+
+	// Labels cannot be matched in a matrix without a row map.
+
+	m.row_map = NULL;
+	{
+		const char *error;
+		struct pairsel_rows side[2];
+		struct pairsel *sel = pairsel_compile( "@0 x N:*", &error );
+		if( sel == NULL || pairsel_resolve( sel, &m, side ) != -1 ) {
+			printf( "labels resolved without a row map\n" );
+			failures += 1;
+		}
+		pairsel_destroy( sel );
+	}
+
+	if( failures == 0 )
+		printf( "ok\n" );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
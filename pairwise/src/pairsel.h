@@ -0,0 +1,55 @@
+
+#ifndef _pairsel_h_
+#define _pairsel_h_
+
+#include <stdbool.h>
+
+/**
+  * A compact language for selecting feature pairs by label, row range
+  * and statistical class:
+  *
+  *   spec   := set [ " x " set ]
+  *   set    := term { "," term }          union
+  *   term   := factor { "&" factor }      intersection
+  *   factor := "@" <a> [ "-" [ <b> ] ]    rows [a,b), [a,a+1) or [a,end)
+  *           | "%" { "N" | "B" | "C" }    numeric, boolean, categorical
+  *           | <glob>                     row label (fnmatch(3) pattern)
+  *
+  * e.g. "N:GEXP:* x N:METH:*", "@0-500,@1000- x %C" or "*:TP53:*&%N".
+  *
+  * A single set selects all pairs of its rows; two sets select their
+  * cross-product, in which rows common to both sets are never paired
+  * with themselves and no pair appears twice.
+  */
+
+struct mtm_matrix;
+struct pairsel;
+
+/**
+  * Returns NULL on a syntax error, having pointed *error at the offending
+  * text (or at NULL if memory was exhausted).
+  */
+struct pairsel *pairsel_compile( const char *spec, const char **error );
+void pairsel_destroy( struct pairsel * );
+
+/**
+  * Rows of a matrix selected by one set, in ascending order of offset.
+  * member is indexed by row offset.
+  */
+struct pairsel_rows {
+	int count;
+	int *offset;
+	bool *member;
+};
+
+/**
+  * Resolve the sets against m (whose row map, if any, must be in row
+  * order). Returns the number of sets (1 or 2), filling that many
+  * elements of side, or -1 if a set names labels but m has none or
+  * memory was exhausted.
+  */
+int  pairsel_resolve( const struct pairsel *, const struct mtm_matrix *m, struct pairsel_rows side[2] );
+void pairsel_rows_free( struct pairsel_rows * );
+
+#endif
+
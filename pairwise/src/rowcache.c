@@ -0,0 +1,372 @@
+
+/**
+  * Row-wise precomputation.
+  * Everything in here is computed once, immediately after the matrix is
+  * loaded, and is read-only thereafter (so it is safely shared by any
+  * number of analysis contexts or worker processes).
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "mtmatrix.h"
+#include "rank.h"
+#include "limits.h"
+#include "corblock.h"
+#include "rowcache.h"
+
+
+static bool _is_orderable( const struct mtm_descriptor *d ) {
+	return ! ( d->categorical || d->integral || d->constant );
+}
+
+static bool _is_sliceable( const struct mtm_descriptor *d ) {
+	return d->categorical && ! d->constant
+		&& d->cardinality <= MAX_CATEGORY_COUNT;
+}
+
+static bool _is_rankable( const struct mtm_descriptor *d ) {
+	return _is_orderable( d ) && d->missing == 0;
+}
+
+
+static size_t _present_count( const float *row, int n ) {
+	size_t count = 0;
+	for(int j = 0; j < n; j++ )
+		if( ! isnan( row[j] ) ) count++;
+	return count;
+}
+
+
+void rowcache_destroy( struct RowCache *c ) {
+
+	if( c ) {
+		if( c->category_storage )
+			free( c->category_storage );
+		if( c->order_storage )
+			free( c->order_storage );
+		if( c->centered_storage )
+			free( c->centered_storage );
+		if( c->storage )
+			free( c->storage );
+		if( c->row )
+			free( c->row );
+		free( c );
+	}
+}
+
+
+/**
+  * Bytes of storage row i's entry requires.
+  */
+static size_t _row_bytes( const struct mtm_matrix *m, int i ) {
+
+	size_t n = 0;
+
+	if( _is_rankable( m->desc + i ) ) {
+		n += m->columns*sizeof(float);
+		if( m->columns <= CORBLOCK_MAX_LENGTH )
+			n += m->columns*sizeof(int16_t);
+	}
+	if( _is_orderable( m->desc + i ) )
+		n += _present_count( (const float*)m->data + i*m->columns, m->columns )*sizeof(unsigned int);
+	if( _is_sliceable( m->desc + i ) )
+		n += m->desc[i].cardinality*MTM_BITMAP_WORDS( m->columns )*sizeof(mtm_bitmap_t);
+	return n;
+}
+
+
+struct RowCache *rowcache_create( const struct mtm_matrix *m, size_t max_bytes ) {
+
+	struct RowCache *c
+		= calloc( 1, sizeof(struct RowCache) );
+	void *scratch = NULL;
+	bool *cached = NULL;
+	float *pf;
+	int16_t *pc;
+	unsigned int *po;
+	mtm_bitmap_t *pb;
+	size_t n = 0, ordered = 0, bitsets = 0, bytes = 0;
+	int i;
+
+	if( NULL == c )
+		return NULL;
+
+	c->rows    = m->rows;
+	c->columns = m->columns;
+	c->words   = MTM_BITMAP_WORDS( m->columns );
+	c->row     = calloc( m->rows, sizeof(struct CachedRow) );
+	cached     = calloc( m->rows, sizeof(bool) );
+	if( NULL == c->row || NULL == cached )
+		goto failure;
+
+	// Rows are cached in row order as long as they fit in max_bytes.
+
+	for(i = 0; i < m->rows; i++ ) {
+		const size_t ROW_BYTES = _row_bytes( m, i );
+		if( ROW_BYTES == 0 || bytes + ROW_BYTES > max_bytes )
+			continue;
+		bytes += ROW_BYTES;
+		cached[i] = true;
+		if( _is_rankable( m->desc + i ) )
+			n += 1;
+		if( _is_orderable( m->desc + i ) )
+			ordered += _present_count( (const float*)m->data + i*m->columns, m->columns );
+		if( _is_sliceable( m->desc + i ) )
+			bitsets += m->desc[i].cardinality;
+	}
+	c->bytes = bytes;
+
+	if( bitsets > 0 ) {
+		c->category_storage = calloc( bitsets * c->words, sizeof(mtm_bitmap_t) );
+		if( NULL == c->category_storage )
+			goto failure;
+	}
+
+	if( n > 0 || ordered > 0 ) {
+		scratch = rank_alloc( m->columns );
+		if( NULL == scratch )
+			goto failure;
+	}
+
+	if( ordered > 0 ) {
+		c->order_storage = malloc( ordered * sizeof(unsigned int) );
+		if( NULL == c->order_storage )
+			goto failure;
+	}
+
+	if( n > 0 ) {
+		c->storage = malloc( n * m->columns * sizeof(float) );
+		if( NULL == c->storage )
+			goto failure;
+		if( m->columns <= CORBLOCK_MAX_LENGTH ) {
+			c->centered_storage = malloc( n * m->columns * sizeof(int16_t) );
+			if( NULL == c->centered_storage )
+				goto failure;
+		}
+	}
+
+	pf = c->storage;
+	pc = c->centered_storage;
+	po = c->order_storage;
+	pb = c->category_storage;
+	for(i = 0; i < m->rows; i++ ) {
+
+		struct CachedRow *e = c->row + i;
+		e->data = m->data + i*m->columns;
+
+		if( ! cached[i] )
+			continue;
+
+		if( _is_sliceable( m->desc + i ) ) {
+			for(int j = 0; j < m->columns; j++ ) {
+				const unsigned int K = e->data[j];
+				if( K < m->desc[i].cardinality )
+					pb[ K*c->words + j/64 ] |= ((mtm_bitmap_t)1) << (j%64);
+			}
+			e->category = pb;
+			pb += m->desc[i].cardinality * c->words;
+		}
+
+		if( _is_orderable( m->desc + i ) ) {
+			e->order_count = rank_order_floats(
+				(const float*)e->data, m->columns, po, scratch );
+			e->order = po;
+			po += e->order_count;
+		}
+
+		if( _is_rankable( m->desc + i ) ) {
+			memcpy( pf, e->data, m->columns*sizeof(float) );
+			e->rank_status = rank_floats( pf, m->columns, 0, scratch );
+			e->rank = pf;
+			if( pc ) {
+				const int MEAN2 = m->columns + 1; // ...twice the mean rank
+				double ss = 0.0;
+				int j;
+				for(j = 0; j < m->columns; j++ ) {
+					const int d = (int)(2.0f*pf[j]) - MEAN2;
+					pc[j] = (int16_t)d;
+					ss += (double)d * d;
+				}
+				e->centered    = pc;
+				e->centered_ss = ss;
+				pc += m->columns;
+			}
+			pf += m->columns;
+		}
+	}
+
+	if( scratch )
+		rank_free( scratch );
+	free( cached );
+	return c;
+
+failure:
+	if( scratch )
+		rank_free( scratch );
+	if( cached )
+		free( cached );
+	rowcache_destroy( c );
+	return NULL;
+}
+
+
+const struct CachedRow *rowcache_lookup(
+		const struct RowCache *c,
+		const struct mtm_feature *f ) {
+
+	if( c && 0 <= f->offset && f->offset < c->rows ) {
+		const struct CachedRow *e = c->row + f->offset;
+		if( e->data == f->data )
+			return e;
+	}
+	return NULL;
+}
+
+
+
+#ifdef _UNITTEST_ROWCACHE_
+
+/**
+  * Checks the cached ranks, centered ranks and sample orders of random
+  * continuous rows with ties (and, in odd rows, NAs) against rank_floats,
+  * and that a bound leaves later rows uncached: ut_rowcache [ <columns> ]
+  */
+
+int main( int argc, char *argv[] ) {
+
+	const int COLUMNS = argc > 1 ? atoi( argv[1] ) : 100;
+	const int ROWS = 16;
+	struct mtm_matrix m;
+	struct mtm_descriptor desc[ ROWS ];
+	struct RowCache *c;
+	float *f = calloc( (size_t)ROWS*COLUMNS, sizeof(float) );
+	float *expect = calloc( COLUMNS, sizeof(float) );
+	float *got = calloc( COLUMNS, sizeof(float) );
+	int *position = calloc( COLUMNS, sizeof(int) );
+	void *scratch = rank_alloc( COLUMNS );
+	size_t half = 0;
+	int failures = 0, i, j;
+
+	if( f == NULL || expect == NULL || got == NULL || position == NULL || scratch == NULL ) {
+		printf( "setup failed\n" );
+		return EXIT_FAILURE;
+	}
+
+	// Values are drawn from few levels so that ties abound.
+
+	srand( 1 );
+	memset( &m, 0, sizeof(m) );
+	memset( desc, 0, sizeof(desc) );
+	for(i = 0; i < ROWS; i++ ) {
+		for(j = 0; j < COLUMNS; j++ ) {
+			float *v = f + i*COLUMNS + j;
+			*v = (float)( rand() % 7 ) / 4;
+			if( i % 2 && rand() % 5 == 0 ) {
+				*v = NAN;
+				desc[i].missing += 1;
+			}
+		}
+	}
+	m.rows    = ROWS;
+	m.columns = COLUMNS;
+	m.data    = (mtm_int_t*)f;
+	m.desc    = desc;
+
+	c = rowcache_create( &m, SIZE_MAX );
+	if( c == NULL ) {
+		printf( "rowcache_create failed\n" );
+		return EXIT_FAILURE;
+	}
+
+	for(i = 0; i < ROWS; i++ ) {
+
+		const struct CachedRow *e = c->row + i;
+		const float *row = f + i*COLUMNS;
+		int n = 0;
+
+		if( i < ROWS/2 )
+			half += _row_bytes( &m, i );
+
+		// The present values, in order, ranked from scratch...
+
+		for(j = 0; j < COLUMNS; j++ ) {
+			position[j] = isnan( row[j] ) ? -1 : n;
+			if( position[j] >= 0 )
+				expect[ n++ ] = row[j];
+		}
+		rank_floats( expect, n, 0, scratch );
+
+		if( e->order == NULL || e->order_count != (unsigned)n ) {
+			printf( "row %d: no sample order of %d values\n", i, n );
+			failures += 1;
+			continue;
+		}
+
+		// ...must be those of the sample order...
+
+		rank_floats_masked( row, e->order, e->order_count, position, got );
+		if( memcmp( got, expect, n*sizeof(float) ) ) {
+			printf( "row %d: ranks from the sample order differ\n", i );
+			failures += 1;
+		}
+
+		// ...and, of complete rows, the cached ranks and centered ranks.
+
+		if( ( e->rank != NULL ) != ( desc[i].missing == 0 ) ) {
+			printf( "row %d: ranks %scached\n", i, e->rank ? "" : "not " );
+			failures += 1;
+		}
+		if( e->rank ) {
+			double ss = 0.0;
+			if( memcmp( e->rank, expect, COLUMNS*sizeof(float) ) ) {
+				printf( "row %d: cached ranks differ\n", i );
+				failures += 1;
+			}
+			for(j = 0; j < COLUMNS && COLUMNS <= CORBLOCK_MAX_LENGTH; j++ ) {
+				const double D = 2.0*expect[j] - ( COLUMNS + 1 );
+				ss += D*D;
+				if( e->centered == NULL || e->centered[j] != D ) {
+					printf( "row %d: centered rank %d is not %g\n", i, j, D );
+					failures += 1;
+					break;
+				}
+			}
+			if( e->centered && e->centered_ss != ss ) {
+				printf( "row %d: centered sum of squares %g is not %g\n", i, e->centered_ss, ss );
+				failures += 1;
+			}
+		}
+	}
+	rowcache_destroy( c );
+
+	// Only the first half of the rows fit in their own size.
+
+	c = rowcache_create( &m, half );
+	for(i = 0; c && i < ROWS; i++ ) {
+		if( ( c->row[i].order != NULL ) != ( i < ROWS/2 ) ) {
+			printf( "row %d: %scached within %zu bytes\n", i,
+				c->row[i].order ? "" : "not ", half );
+			failures += 1;
+		}
+	}
+	if( c == NULL || c->bytes != half ) {
+		printf( "bounded cache holds %zu bytes, not %zu\n", c ? c->bytes : 0, half );
+		failures += 1;
+	}
+	rowcache_destroy( c );
+
+	rank_free( scratch );
+	free( position );
+	free( got );
+	free( expect );
+	free( f );
+	if( failures == 0 )
+		printf( "ok\n" );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,93 @@
+
+#ifndef _rowcache_h_
+#define _rowcache_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  * Per-row precomputations that are independent of any partner row and,
+  * thus, can be done once for the whole run rather than once per pair.
+  *
+  * Entries are indexed by row offset, but every entry also records the
+  * data pointer of the row it was computed from, and lookups verify it.
+  * This makes lookups safe regardless of where a struct mtm_feature came
+  * from (e.g. rows read from a disk-resident matrix in cross-product mode
+  * never match).
+  */
+struct CachedRow {
+
+	MTM_ROW_PTR data;
+
+	/**
+	  * Ranks (ties averaged) of a continuous row with no missing values;
+	  * otherwise NULL.
+	  */
+	const float *rank;
+
+	/**
+	  * The RANK_STATUS_* bits returned when rank was computed.
+	  */
+	int rank_status;
+
+	/**
+	  * When rank is present and the row is no longer than
+	  * CORBLOCK_MAX_LENGTH, the centered ranks 2*(rank - mean rank)
+	  * which are integers, and their sum of squares (also exact).
+	  * This is the representation corblock.c correlates in bulk.
+	  */
+	const int16_t *centered;
+	double centered_ss;
+
+	/**
+	  * Offsets of the present values of a continuous, non-constant row
+	  * in ascending order of value, and their count; otherwise NULL.
+	  * Ranks of any subset of the row's samples follow from this in
+	  * linear time (see rank_floats_masked).
+	  */
+	const unsigned int *order;
+	unsigned int order_count;
+
+	/**
+	  * For a categorical row, one bitset (of RowCache.words words) per
+	  * category in which bit i is set iff sample i has that category, so
+	  * that contingency table cells are popcounts of ANDs; otherwise NULL.
+	  * Missing samples have no bit set in any category.
+	  */
+	const mtm_bitmap_t *category;
+};
+
+struct RowCache {
+	int rows;
+	int columns;
+	struct CachedRow *row;
+	float *storage;
+	int16_t *centered_storage;
+	unsigned int *order_storage;
+	int words; // ...per category bitset
+	mtm_bitmap_t *category_storage;
+	size_t bytes; // ...of all the storage above but row
+};
+
+/**
+  * Rows are cached in row order as long as their entries fit in a total
+  * of max_bytes. Entries of the remaining rows hold only data, so every
+  * analysis of them takes the uncached path.
+  */
+struct RowCache *rowcache_create( const struct mtm_matrix *m, size_t max_bytes );
+void rowcache_destroy( struct RowCache * );
+
+/**
+  * Returns the cache entry for f or NULL if there is none.
+  */
+const struct CachedRow *rowcache_lookup(
+		const struct RowCache *,
+		const struct mtm_feature *f );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
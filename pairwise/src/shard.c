@@ -0,0 +1,148 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mtmatrix.h"
+#include "shard.h"
+
+#define CLASS_N (0)
+#define CLASS_C (1) // ...including boolean
+
+/**
+  * Rough relative costs per common sample of the tests applied to each
+  * class of pair (Spearman; Kruskal-Wallis or Mann-Whitney; contingency
+  * table accumulation) and per contingency table cell (the exact or
+  * chi-square test itself). Only their ratios matter.
+  */
+static const double W_SAMPLE[2][2] = {
+	{ 1.0, 1.5 },
+	{ 1.5, 0.5 } };
+static const double W_CELL = 4.0;
+
+static inline int _class( const struct mtm_descriptor *d ) {
+	return d->integral ? CLASS_C : CLASS_N;
+}
+
+
+void shard_accumulate( struct shard_totals *t, const struct mtm_descriptor *d ) {
+	const int K = _class( d );
+	t->count[K]   += 1;
+	t->missing[K] += d->missing;
+	if( K == CLASS_C )
+		t->cardinality += d->cardinality;
+}
+
+
+/**
+  * Samples in common are approximated by columns less both rows' missing
+  * counts (exact when missing values never coincide).
+  */
+double shard_cost( const struct shard_totals *t, const struct mtm_descriptor *d, int columns ) {
+
+	const int K = _class( d );
+	const double PRESENT = columns - (double)d->missing;
+	double cost = 0.0;
+
+	for(int k = 0; k < 2; k++ )
+		cost += W_SAMPLE[K][k]*( PRESENT*t->count[k] - t->missing[k] );
+	if( K == CLASS_C )
+		cost += W_CELL*d->cardinality*t->cardinality;
+	return cost > 0.0 ? cost : 0.0;
+}
+
+
+double shard_pair_cost( const struct mtm_descriptor *l, const struct mtm_descriptor *r, int columns ) {
+	struct shard_totals t = { {0,0}, {0,0}, 0 };
+	shard_accumulate( &t, r );
+	return shard_cost( &t, l, columns );
+}
+
+
+double shard_bounds( const double *cost, int n, int shard, int shards, int *first, int *last ) {
+
+	double total = 0.0, sum = 0.0, range = 0.0;
+	int l;
+
+	for(l = 0; l < n; l++ )
+		total += cost[l];
+
+	*first = *last = n;
+
+	for(l = 0; l < n; l++ ) {
+		const double MID = sum + cost[l]/2;
+		const int OWNER
+			= total > 0.0 && MID < total
+			? (int)( MID*shards/total )
+			: shards-1; // ...trailing rows of no cost
+		if( OWNER >= shard && *first == n )
+			*first = l;
+		if( OWNER > shard ) {
+			*last = l;
+			break;
+		}
+		sum += cost[l];
+	}
+	for(l = *first; l < *last; l++ )
+		range += cost[l];
+	return range;
+}
+
+
+#ifdef _UNITTEST_SHARD_
+
+/**
+  * Makes up a matrix of mixed numeric and categorical rows, checks the
+  * totals-based row costs against sums of pair costs, and shows how the
+  * all-pairs triangle divides: ut_shard [ <rows> [ <shards> ] ]
+  */
+
+int main( int argc, char *argv[] ) {
+
+	const int ROWS    = argc > 1 ? atoi( argv[1] ) : 1000;
+	const int SHARDS  = argc > 2 ? atoi( argv[2] ) : 7;
+	const int COLUMNS = 500;
+	struct mtm_descriptor *desc = calloc( ROWS, sizeof(struct mtm_descriptor) );
+	double *cost = calloc( ROWS, sizeof(double) );
+	struct shard_totals t = { {0,0}, {0,0}, 0 };
+	int failures = 0, covered = 0;
+
+	srand( 1 );
+	for(int i = 0; i < ROWS; i++ ) {
+		// Categorical rows cluster at the end as they often do in practice.
+		desc[i].integral    = rand() % ROWS < i/2;
+		desc[i].cardinality = desc[i].integral ? 2 + rand() % 5 : 0;
+		desc[i].missing     = rand() % 50;
+	}
+
+	for(int l = ROWS-1; l >= 0; l-- ) {
+		double brute = 0.0;
+		cost[l] = shard_cost( &t, desc + l, COLUMNS );
+		for(int r = l+1; r < ROWS; r++ )
+			brute += shard_pair_cost( desc + l, desc + r, COLUMNS );
+		if( brute - cost[l] > 1e-9*brute || cost[l] - brute > 1e-9*brute ) {
+			printf( "row %d: %g != %g\n", l, cost[l], brute );
+			failures += 1;
+		}
+		shard_accumulate( &t, desc + l );
+	}
+
+	for(int s = 0; s < SHARDS; s++ ) {
+		int first, last;
+		const double C = shard_bounds( cost, ROWS, s, SHARDS, &first, &last );
+		printf( "%d/%d: [%d,%d) %.4g\n", s, SHARDS, first, last, C );
+		if( first != covered )
+			failures += 1;
+		covered = last;
+	}
+	if( covered != ROWS )
+		failures += 1;
+
+	printf( "%d failures\n", failures );
+	free( cost );
+	free( desc );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
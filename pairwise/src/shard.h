@@ -0,0 +1,49 @@
+
+#ifndef _shard_h_
+#define _shard_h_
+
+/**
+  * Deterministic division of an exhaustive analysis among independent
+  * processes (e.g. cluster jobs) into contiguous ranges of left rows of
+  * roughly equal *modeled* cost.
+  *
+  * The cost of a pair is modeled from its rows' descriptors alone: it is
+  * proportional to the samples the rows (probably) have in common, with
+  * a per-sample weight that depends on the pair's class (numeric or
+  * categorical on each side), plus, for categorical pairs, a term for
+  * the size of the contingency table. The model is linear in per-row
+  * quantities, so the cost of pairing one row with many is computed in
+  * constant time from totals over the many.
+  */
+
+struct mtm_descriptor;
+
+struct shard_totals {
+	double count[2];       // ...of rows, by class
+	double missing[2];     // ...sum of their missing counts, by class
+	double cardinality;    // ...sum of categorical rows' cardinalities
+};
+
+void shard_accumulate( struct shard_totals *, const struct mtm_descriptor * );
+
+/**
+  * The modeled cost of pairing a row with every row accumulated in t.
+  */
+double shard_cost( const struct shard_totals *t, const struct mtm_descriptor *, int columns );
+
+/**
+  * The modeled cost of a single pair (for reference and testing).
+  */
+double shard_pair_cost( const struct mtm_descriptor *, const struct mtm_descriptor *, int columns );
+
+/**
+  * Given the costs of n consecutive rows, sets [*first,*last) to the
+  * range of rows belonging to shard <shard> of <shards>. Rows belong to
+  * the shard whose share of the total cost contains their midpoint, so
+  * the shards partition [0,n) and every process computes the same ranges
+  * from the same costs. Returns the modeled cost of the range.
+  */
+double shard_bounds( const double *cost, int n, int shard, int shards, int *first, int *last );
+
+#endif
+
@@ -0,0 +1,36 @@
+
+#include <string.h>
+
+#include "statname.h"
+
+/**
+  * This list must stay synchronized with the names assigned in cat.c,
+  * mix.c and num.c. Codes are recorded in files, so names may only ever
+  * be appended.
+  */
+static const char *NAME[] = {
+	"?",
+	"Spearman_rho,Fisher_transform",
+	"Spearman_rho,t-distribution",
+	"Kruskal-Wallis_K",
+	"Chi-square",
+	"Fisher_Exact"
+};
+#define NAME_COUNT (sizeof(NAME)/sizeof(const char*))
+
+
+unsigned statname_code( const char *name ) {
+	if( name ) {
+		for(unsigned k = 1; k < NAME_COUNT; k++ ) {
+			if( strcmp( name, NAME[k] ) == 0 )
+				return k;
+		}
+	}
+	return STATNAME_UNKNOWN;
+}
+
+
+const char *statname( unsigned code ) {
+	return NAME[ code < NAME_COUNT ? code : STATNAME_UNKNOWN ];
+}
+
@@ -0,0 +1,23 @@
+
+#ifndef _statname_h_
+#define _statname_h_
+
+/**
+  * Small integer codes for the names of statistical tests (the
+  * Statistic.name literals assigned in cat.c, mix.c and num.c) so that
+  * binary representations of results need not carry the strings.
+  * Code 0 stands for "?", the name of a test that was not performed,
+  * and for any name not known here.
+  */
+
+#define STATNAME_UNKNOWN (0)
+
+unsigned statname_code( const char *name );
+
+/**
+  * Returns "?" for codes that are not defined.
+  */
+const char *statname( unsigned code );
+
+#endif
+
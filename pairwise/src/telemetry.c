@@ -0,0 +1,255 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "stattest.h"
+struct feature_pair;
+#include "analysis.h"
+#include "mtsclass.h"
+#include "statname.h"
+#include "telemetry.h"
+
+static const char *CLASS_NAME[ TM_CLASSES ] = {
+	"NN", "NC", "CN", "CC"
+};
+
+static const char *TEST_NAME[ TM_TESTS ] = {
+	"spearman",
+	"kruskal_wallis",
+	"fisher_exact",
+	"chi_square"
+};
+
+/**
+  * In order of the COVAN_E_* bits.
+  */
+static const char *ERROR_NAME[ TM_ERRORS ] = {
+	"samples_size",
+	"univar_degen",
+	"covar_degen",
+	"math",
+	"toomany_cats"
+};
+
+static const char *PHASE_NAME[ TM_PHASES ] = {
+	"filter",
+	"rank",
+	"statistic",
+	"p_value"
+};
+
+
+/**
+  * Returns TM_TESTS for a test that was not performed.
+  */
+static int _test_of( const char *name ) {
+	// ...by the codes of statname.c
+	switch( statname_code( name ) ) {
+	case 1:
+	case 2: return TM_SPEARMAN;
+	case 3: return TM_KRUSKAL_WALLIS;
+	case 4: return TM_CHI_SQUARE;
+	case 5: return TM_FISHER_EXACT;
+	default:
+		break;
+	}
+	return TM_TESTS;
+}
+
+
+void telemetry_count( struct telemetry *tm, const struct CovariateAnalysis *covan ) {
+
+	const int TEST = _test_of( covan->result.name );
+	unsigned status = covan->status & COVAN_E_MASK;
+
+	tm->analyses += 1;
+	tm->by_class[
+		( covan->stat_class.left  == MTM_STATCLASS_CATEGORICAL ? 2 : 0 ) +
+		( covan->stat_class.right == MTM_STATCLASS_CATEGORICAL ? 1 : 0 ) ] += 1;
+
+	if( TEST < TM_TESTS ) {
+		tm->by_test[ TEST ] += 1;
+		// ...and, as the filters do, count non-finite results as failures.
+		if( ! ( isfinite( covan->result.probability )
+				&& fpclassify( covan->result.probability ) != FP_SUBNORMAL ) )
+			status |= COVAN_E_MATH;
+	}
+	for(int i = 0; i < 2; i++ ) {
+		if( _test_of( covan->waste[i].result.name ) == TM_KRUSKAL_WALLIS )
+			tm->waste_tests += 1;
+	}
+	for(int b = 0; b < TM_ERRORS; b++ ) {
+		if( status & (1U << b) )
+			tm->by_error[b] += 1;
+	}
+}
+
+
+void telemetry_merge( struct telemetry *sum, const struct telemetry *tm ) {
+
+	int i;
+
+	sum->analyses    += tm->analyses;
+	sum->repeated    += tm->repeated;
+	sum->waste_tests += tm->waste_tests;
+	for(i = 0; i < TM_CLASSES; i++ )
+		sum->by_class[i] += tm->by_class[i];
+	for(i = 0; i < TM_TESTS; i++ )
+		sum->by_test[i] += tm->by_test[i];
+	for(i = 0; i < TM_ERRORS; i++ )
+		sum->by_error[i] += tm->by_error[i];
+	for(i = 0; i < TM_PHASES; i++ )
+		sum->ticks[i] += tm->ticks[i];
+}
+
+
+static double _now( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+
+void telemetry_epoch( struct telemetry_epoch *e ) {
+	e->seconds = _now();
+	e->ticks   = tm_ticks();
+}
+
+
+double telemetry_elapsed( const struct telemetry_epoch *e, double *tick_rate ) {
+	const uint64_t TICKS = tm_ticks();
+	const double SECONDS = _now() - e->seconds;
+	if( tick_rate )
+		*tick_rate = SECONDS > 0 ? ( TICKS - e->ticks ) / SECONDS : 0.0;
+	return SECONDS;
+}
+
+
+void telemetry_progress( FILE *fp, const struct telemetry *tm, const struct telemetry_epoch *e ) {
+
+	double rate;
+	const double SECONDS = telemetry_elapsed( e, &rate );
+	uint64_t failed = 0;
+	int i;
+
+	for(i = 0; i < TM_ERRORS; i++ )
+		failed += tm->by_error[i];
+
+	fprintf( fp, "# progress %.0fs: %" PRIu64 " analyses (%.0f/s)",
+		SECONDS, tm->analyses, SECONDS > 0 ? tm->analyses / SECONDS : 0.0 );
+	for(i = 0; i < TM_CLASSES; i++ )
+		fprintf( fp, " %s %" PRIu64, CLASS_NAME[i], tm->by_class[i] );
+	fprintf( fp, ", %" PRIu64 " failed, %" PRIu64 " repeated;", failed, tm->repeated );
+	for(i = 0; i < TM_PHASES; i++ )
+		fprintf( fp, " %s %.1fs", PHASE_NAME[i], rate > 0 ? tm->ticks[i] / rate : 0.0 );
+	fputc( '\n', fp );
+	fflush( fp );
+}
+
+
+void telemetry_json( FILE *fp, const struct telemetry *tm, const struct telemetry_epoch *e,
+		uint64_t insignificant, uint64_t untested ) {
+
+	double rate;
+	const double SECONDS = telemetry_elapsed( e, &rate );
+	int i;
+
+	fprintf( fp, "{\"seconds\":%.3f,\"tick_rate\":%.6g,\"analyses\":%" PRIu64
+		",\"repeated\":%" PRIu64 ",\"insignificant\":%" PRIu64 ",\"untested\":%" PRIu64
+		",\"class\":{",
+		SECONDS, rate, tm->analyses, tm->repeated, insignificant, untested );
+	for(i = 0; i < TM_CLASSES; i++ )
+		fprintf( fp, "%s\"%s\":%" PRIu64, i ? "," : "", CLASS_NAME[i], tm->by_class[i] );
+	fprintf( fp, "},\"test\":{" );
+	for(i = 0; i < TM_TESTS; i++ )
+		fprintf( fp, "\"%s\":%" PRIu64 ",", TEST_NAME[i], tm->by_test[i] );
+	fprintf( fp, "\"waste_kruskal_wallis\":%" PRIu64 "},\"error\":{", tm->waste_tests );
+	for(i = 0; i < TM_ERRORS; i++ )
+		fprintf( fp, "%s\"%s\":%" PRIu64, i ? "," : "", ERROR_NAME[i], tm->by_error[i] );
+	fprintf( fp, "},\"ticks\":{" );
+	for(i = 0; i < TM_PHASES; i++ )
+		fprintf( fp, "%s\"%s\":%" PRIu64, i ? "," : "", PHASE_NAME[i], tm->ticks[i] );
+	fprintf( fp, "}}\n" );
+	fflush( fp );
+}
+
+
+#ifdef _UNITTEST_TELEMETRY_
+
+/**
+  * Counts a few made-up results, checks the tallies and the merge, and
+  * prints a progress line and the JSON summary.
+  */
+
+int main( void ) {
+
+	struct telemetry t, sum;
+	struct telemetry_epoch e;
+	struct CovariateAnalysis covan;
+	int failures = 0;
+
+	memset( &t,   0, sizeof(t) );
+	memset( &sum, 0, sizeof(sum) );
+	telemetry_epoch( &e );
+
+	// A numeric-numeric Spearman correlation...
+
+	memset( &covan, 0, sizeof(covan) );
+	covan.stat_class.left  = MTM_STATCLASS_CONTINUOUS;
+	covan.stat_class.right = MTM_STATCLASS_CONTINUOUS;
+	covan.result.name = "Spearman_rho,t-distribution";
+	covan.waste[0].result.name = covan.waste[1].result.name = "Kruskal-Wallis_K";
+	covan.result.probability = 0.01;
+	telemetry_count( &t, &covan );
+
+	// ...a categorical-numeric pair with too few samples...
+
+	memset( &covan, 0, sizeof(covan) );
+	covan.stat_class.left  = MTM_STATCLASS_CATEGORICAL;
+	covan.stat_class.right = MTM_STATCLASS_CONTINUOUS;
+	covan.result.name = covan.waste[0].result.name = covan.waste[1].result.name = "?";
+	covan.status = COVAN_E_SAMPLES_SIZE | COVAN_E_COVAR_DEGEN;
+	telemetry_count( &t, &covan );
+
+	// ...and a chi-square test that produced NaN.
+
+	memset( &covan, 0, sizeof(covan) );
+	covan.stat_class.left  = MTM_STATCLASS_CATEGORICAL;
+	covan.stat_class.right = MTM_STATCLASS_CATEGORICAL;
+	covan.result.name = "Chi-square";
+	covan.waste[0].result.name = covan.waste[1].result.name = "?";
+	covan.result.probability = NAN;
+	telemetry_count( &t, &covan );
+
+	t.ticks[ TM_RANK ] = 1000;
+	t.repeated = 3;
+
+	telemetry_merge( &sum, &t );
+	telemetry_merge( &sum, &t );
+
+	if( sum.analyses != 6 || sum.repeated != 6
+			|| sum.by_class[ TM_NN ] != 2 || sum.by_class[ TM_NC ] != 0
+			|| sum.by_class[ TM_CN ] != 2 || sum.by_class[ TM_CC ] != 2
+			|| sum.by_test[ TM_SPEARMAN ] != 2 || sum.by_test[ TM_CHI_SQUARE ] != 2
+			|| sum.by_test[ TM_KRUSKAL_WALLIS ] != 0 || sum.waste_tests != 4
+			|| sum.by_error[0] != 2 || sum.by_error[1] != 0
+			|| sum.by_error[2] != 2 || sum.by_error[3] != 2
+			|| sum.ticks[ TM_RANK ] != 2000 ) {
+		printf( "wrong counts\n" );
+		failures += 1;
+	}
+
+	telemetry_progress( stdout, &sum, &e );
+	telemetry_json( stdout, &sum, &e, 1, 2 );
+
+	if( failures == 0 )
+		printf( "ok\n" );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
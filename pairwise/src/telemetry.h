@@ -0,0 +1,130 @@
+
+#ifndef _telemetry_h_
+#define _telemetry_h_
+
+#include <stdio.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+/**
+  * Counts of the analyses of a run, by class of pair (N is numeric and
+  * C categorical, including boolean, so NC is numeric on the left), by
+  * primary test and by failure bit (COVAN_E_* in analysis.h), and the
+  * time spent in each phase of analysis. Everything is 64-bit.
+  *
+  * Analyses repeated to emit their results (FDR control's second pass,
+  * --top-k) are neither counted nor timed again, only tallied as repeats.
+  *
+  * Time is measured in ticks of tm_ticks(): CPU cycles (the time-stamp
+  * counter) where it is available, nanoseconds otherwise. Phases are
+  * timed by the analysis code itself (analysis.c, num.c, mix.c, cat.c)
+  * into whatever telemetry it was given, and not at all given NULL.
+  */
+
+enum TelemetryPhase {
+	TM_FILTER,    // ...NA removal, tabulation, culling
+	TM_RANK,
+	TM_STATISTIC,
+	TM_PVALUE,
+	TM_PHASES
+};
+
+enum TelemetryClass {
+	TM_NN,
+	TM_NC,
+	TM_CN,
+	TM_CC,
+	TM_CLASSES
+};
+
+enum TelemetryTest {
+	TM_SPEARMAN,
+	TM_KRUSKAL_WALLIS,
+	TM_FISHER_EXACT,
+	TM_CHI_SQUARE,
+	TM_TESTS
+};
+
+#define TM_ERRORS (5) // ...the bits of COVAN_E_MASK
+
+struct telemetry {
+	uint64_t analyses;
+	uint64_t repeated;
+	uint64_t by_class[ TM_CLASSES ];
+	uint64_t by_test[ TM_TESTS ];
+	uint64_t waste_tests; // ...secondary Kruskal-Wallis tests
+	uint64_t by_error[ TM_ERRORS ];
+	uint64_t ticks[ TM_PHASES ];
+};
+
+static inline uint64_t tm_ticks( void ) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec*UINT64_C(1000000000) + ts.tv_nsec;
+#endif
+}
+
+/**
+  * Usage:
+  *     uint64_t mark = tm_start( tm );
+  *     ...rank...
+  *     tm_lap( tm, TM_RANK, &mark );
+  *     ...
+  */
+static inline uint64_t tm_start( const struct telemetry *tm ) {
+	return tm ? tm_ticks() : 0;
+}
+
+static inline void tm_lap( struct telemetry *tm, enum TelemetryPhase phase, uint64_t *mark ) {
+	if( tm ) {
+		const uint64_t NOW = tm_ticks();
+		tm->ticks[ phase ] += NOW - *mark;
+		*mark = NOW;
+	}
+}
+
+/**
+  * Count one (completed) analysis.
+  */
+struct CovariateAnalysis;
+void telemetry_count( struct telemetry *, const struct CovariateAnalysis * );
+
+void telemetry_merge( struct telemetry *sum, const struct telemetry * );
+
+/**
+  * Wall-clock time and ticks at the start of a run, from which the tick
+  * rate is estimated.
+  */
+struct telemetry_epoch {
+	double seconds;
+	uint64_t ticks;
+};
+
+void   telemetry_epoch( struct telemetry_epoch * );
+
+/**
+  * Seconds since the epoch and, optionally, ticks per second.
+  */
+double telemetry_elapsed( const struct telemetry_epoch *, double *tick_rate );
+
+/**
+  * One "# progress ..." line.
+  */
+void telemetry_progress( FILE *, const struct telemetry *, const struct telemetry_epoch * );
+
+/**
+  * A single-line JSON object. <insignificant> and <untested> are the
+  * caller's (filtering) counts, included for convenience.
+  */
+void telemetry_json( FILE *, const struct telemetry *, const struct telemetry_epoch *,
+		uint64_t insignificant, uint64_t untested );
+
+#endif
+
@@ -0,0 +1,227 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "topk.h"
+
+struct topk {
+	unsigned rows, k;
+	uint32_t *count;          // ...of entries in each row's heap
+	struct topk_entry *entry; // rows*k
+};
+
+
+/**
+  * The total order of entries.
+  */
+static inline bool _weaker( const struct topk_entry *a, const struct topk_entry *b ) {
+	return a->strength < b->strength
+		|| ( a->strength == b->strength && a->partner > b->partner );
+}
+
+
+static void _sift_down( struct topk_entry *h, unsigned n, unsigned i ) {
+	const struct topk_entry e = h[i];
+	unsigned c;
+	while( (c = 2*i+1) < n ) {
+		if( c+1 < n && _weaker( h+c+1, h+c ) )
+			c += 1;
+		if( ! _weaker( h+c, &e ) )
+			break;
+		h[i] = h[c];
+		i = c;
+	}
+	h[i] = e;
+}
+
+
+static void _sift_up( struct topk_entry *h, unsigned i ) {
+	const struct topk_entry e = h[i];
+	while( i > 0 && _weaker( &e, h + (i-1)/2 ) ) {
+		h[i] = h[(i-1)/2];
+		i = (i-1)/2;
+	}
+	h[i] = e;
+}
+
+
+struct topk *topk_create( unsigned rows, unsigned k ) {
+	struct topk *t = calloc( 1, sizeof(struct topk) );
+	if( t ) {
+		t->rows  = rows;
+		t->k     = k;
+		t->count = calloc( rows, sizeof(uint32_t) );
+		t->entry = calloc( (size_t)rows*k, sizeof(struct topk_entry) );
+		if( t->count == NULL || t->entry == NULL ) {
+			topk_destroy( t );
+			t = NULL;
+		}
+	}
+	return t;
+}
+
+
+void topk_destroy( struct topk *t ) {
+	if( t ) {
+		if( t->count ) free( t->count );
+		if( t->entry ) free( t->entry );
+		free( t );
+	}
+}
+
+
+void topk_offer( struct topk *t, unsigned row, unsigned partner, double strength ) {
+
+	struct topk_entry *h = t->entry + (size_t)row*t->k;
+	const struct topk_entry e = {
+		.strength = strength,
+		.partner  = partner
+	};
+
+	if( t->count[row] < t->k ) {
+		h[ t->count[row] ] = e;
+		_sift_up( h, t->count[row]++ );
+	} else
+	if( t->k > 0 && _weaker( h, &e ) ) {
+		h[0] = e;
+		_sift_down( h, t->k, 0 );
+	}
+}
+
+
+/**
+  * Heapsort: repeatedly moving the weakest to the end leaves the entries
+  * strongest first.
+  */
+unsigned topk_sort( struct topk *t, unsigned row, const struct topk_entry **entries ) {
+
+	struct topk_entry *h = t->entry + (size_t)row*t->k;
+	unsigned n = t->count[row];
+
+	while( n > 1 ) {
+		const struct topk_entry weakest = h[0];
+		h[0] = h[--n];
+		_sift_down( h, n, 0 );
+		h[n] = weakest;
+	}
+	*entries = h;
+	return t->count[row];
+}
+
+
+void topk_clear( struct topk *t, unsigned row ) {
+	t->count[row] = 0;
+}
+
+
+/**
+  * The dimensions, then each row's count followed by its entries.
+  */
+int topk_save( const struct topk *t, FILE *fp ) {
+
+	const uint32_t dim[2] = { t->rows, t->k };
+
+	if( fwrite( dim, sizeof(dim), 1, fp ) != 1 )
+		return -1;
+	for(unsigned r = 0; r < t->rows; r++ ) {
+		if( fwrite( t->count + r, sizeof(uint32_t), 1, fp ) != 1
+			|| fwrite( t->entry + (size_t)r*t->k,
+				sizeof(struct topk_entry), t->count[r], fp ) != t->count[r] )
+			return -1;
+	}
+	return fflush( fp ) ? -1 : 0;
+}
+
+
+int topk_merge( struct topk *t, FILE *fp ) {
+
+	uint32_t dim[2], n;
+	struct topk_entry e;
+
+	if( fread( dim, sizeof(dim), 1, fp ) != 1
+		|| dim[0] != t->rows || dim[1] != t->k )
+		return -1;
+	for(unsigned r = 0; r < t->rows; r++ ) {
+		if( fread( &n, sizeof(n), 1, fp ) != 1 || n > t->k )
+			return -1;
+		while( n-- > 0 ) {
+			if( fread( &e, sizeof(e), 1, fp ) != 1 )
+				return -1;
+			topk_offer( t, r, e.partner, e.strength );
+		}
+	}
+	return 0;
+}
+
+
+#ifdef _UNITTEST_TOPK_
+
+/**
+  * Offers random strengths (with many ties) to a few rows, half of them
+  * through a save/merge round trip, and compares what is retained with
+  * a full sort: ut_topk [ <k> [ <offers per row> ] ]
+  */
+
+static int _cmp( const void *pvl, const void *pvr ) {
+	const struct topk_entry *l = pvl;
+	const struct topk_entry *r = pvr;
+	return _weaker( l, r ) ? +1 : ( _weaker( r, l ) ? -1 : 0 );
+}
+
+int main( int argc, char *argv[] ) {
+
+	const unsigned ROWS = 7;
+	const unsigned K = argc > 1 ? atoi( argv[1] ) : 10;
+	const unsigned N = argc > 2 ? atoi( argv[2] ) : 1000;
+	struct topk *t = topk_create( ROWS, K );
+	struct topk *u = topk_create( ROWS, K );
+	struct topk_entry *all = calloc( N, sizeof(struct topk_entry) );
+	FILE *fp = tmpfile();
+	int failures = 0;
+
+	srand( 1 );
+	for(unsigned r = 0; r < ROWS; r++ ) {
+		for(unsigned i = 0; i < N; i++ ) {
+			all[i].strength = rand() % 100;
+			all[i].partner  = i;
+			topk_offer( i % 2 ? t : u, r, i, all[i].strength );
+		}
+	}
+	topk_save( u, fp );
+	rewind( fp );
+	if( topk_merge( t, fp ) )
+		failures += 1;
+
+	srand( 1 ); // ...to regenerate the same strengths row by row.
+	for(unsigned r = 0; r < ROWS; r++ ) {
+		const struct topk_entry *e;
+		unsigned n;
+		for(unsigned i = 0; i < N; i++ ) {
+			all[i].strength = rand() % 100;
+			all[i].partner  = i;
+		}
+		qsort( all, N, sizeof(struct topk_entry), _cmp );
+		n = topk_sort( t, r, &e );
+		if( n != ( K < N ? K : N ) )
+			failures += 1;
+		for(unsigned i = 0; i < n; i++ ) {
+			if( e[i].partner != all[i].partner || e[i].strength != all[i].strength ) {
+				printf( "row %u rank %u: %u(%g) instead of %u(%g)\n", r, i,
+					e[i].partner, e[i].strength, all[i].partner, all[i].strength );
+				failures += 1;
+			}
+		}
+	}
+
+	printf( "%d failures\n", failures );
+	fclose( fp );
+	free( all );
+	topk_destroy( u );
+	topk_destroy( t );
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
@@ -0,0 +1,48 @@
+
+#ifndef _topk_h_
+#define _topk_h_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+  * For each of a fixed number of rows, the (up to) K strongest results
+  * offered for that row, in O(rows*K) memory.
+  *
+  * Each row keeps a min-heap of (strength, partner) entries whose root is
+  * the weakest retained entry, so a result weaker than that is rejected
+  * in constant time. Ties in strength are broken in favor of the lesser
+  * partner offset, so what is retained does not depend on the order in
+  * which results are offered.
+  */
+
+struct topk_entry {
+	double   strength;
+	uint32_t partner;
+};
+
+struct topk;
+
+struct topk *topk_create( unsigned rows, unsigned k );
+void topk_destroy( struct topk * );
+
+void topk_offer( struct topk *, unsigned row, unsigned partner, double strength );
+
+/**
+  * Sorts the row's entries from strongest to weakest, points *entries at
+  * them and returns their count. The row can then only be cleared.
+  */
+unsigned topk_sort( struct topk *, unsigned row, const struct topk_entry **entries );
+
+void topk_clear( struct topk *, unsigned row );
+
+/**
+  * Serialization so that results retained in other processes can be
+  * combined: topk_merge offers every entry written by topk_save. Both
+  * return non-zero on I/O error or, merging, on mismatched dimensions.
+  */
+int topk_save( const struct topk *, FILE * );
+int topk_merge( struct topk *, FILE * );
+
+#endif
+
@@ -17,12 +17,14 @@ struct feature_pair;
 #include "varfmt.h"
 #include "mtmatrix.h"
 #include "featpair.h"
+#include "numfmt.h"
 
 /**
   * Following two variables are initialized by emit_config
   * and used at runtime (by emit_exec) to actually produce output.
   */
 static int _columns = 0;
+static int _format  = FORMAT_TABULAR;
 static EMITTER_FXN _emitter[ MAX_OUTPUT_COLUMNS ];
 static const char *NOTIMPL = "unimplemented";
 
@@ -44,55 +46,52 @@ static const char *printf_format[6] = {
 };
 #define NUM_PRINTF_FORMATS (sizeof(printf_format)/sizeof(const char*))
 
-static void _emitJSONCovCount( EMITTER_SIG ) {}
-static void _emitJSONCovStatName( EMITTER_SIG ) {}
-static void _emitJSONCovErrBits( EMITTER_SIG ) {}
-static void _emitJSONCovSign( EMITTER_SIG ) {}
-static void _emitJSONCovStatValue( EMITTER_SIG ) {}
-static void _emitJSONCovProb( EMITTER_SIG ) {}
-static void _emitJSONCovLogProb( EMITTER_SIG ) {}
-static void _emitJSONCovExtra( EMITTER_SIG ) {}
-static void _emitJSONUniNameL( EMITTER_SIG ) {}
-static void _emitJSONUniNameR( EMITTER_SIG ) {}
-static void _emitJSONUniOffsetL( EMITTER_SIG ) {}
-static void _emitJSONUniOffsetR( EMITTER_SIG ) {}
-static void _emitJSONUniFeatureClassL( EMITTER_SIG ) {}
-static void _emitJSONUniFeatureClassR( EMITTER_SIG ) {}
-static void _emitJSONUniPreprocL( EMITTER_SIG ) {}
-static void _emitJSONUniPreprocR( EMITTER_SIG ) {}
-static void _emitJSONUniUnusedL( EMITTER_SIG ) {}
-static void _emitJSONUniUnusedR( EMITTER_SIG ) {}
-static void _emitJSONUniStatNameL( EMITTER_SIG ) {}
-static void _emitJSONUniStatNameR( EMITTER_SIG ) {}
-static void _emitJSONUniStatValueL( EMITTER_SIG ) {}
-static void _emitJSONUniStatValueR( EMITTER_SIG ) {}
-static void _emitJSONUniProbL( EMITTER_SIG ) {}
-static void _emitJSONUniProbR( EMITTER_SIG ) {}
-static void _emitJSONUniExtraL( EMITTER_SIG ) {}
-static void _emitJSONUniExtraR( EMITTER_SIG ) {}
+/**
+  * The printf_format that numfmt (see numfmt.h) can render, which is
+  * all the defaults, are rendered by it rather than fprintf.
+  */
+static struct numfmt_spec printf_spec[ NUM_PRINTF_FORMATS ];
+
+static void _emitDouble( int i, double v, FILE *fp ) {
+	if( printf_spec[i].conv ) {
+		char buf[ NUMFMT_MAXLEN ];
+		fwrite( buf, 1, numfmt_double( buf, v, printf_spec + i ) - buf, fp );
+	} else
+		fprintf( fp, printf_format[i], v );
+}
+
+static void _emitInt( long v, FILE *fp ) {
+	char buf[ NUMFMT_MAXLEN ];
+	fwrite( buf, 1, numfmt_int( buf, v ) - buf, fp );
+}
 
 static void _emitTabCovCount( EMITTER_SIG ) {
-	fprintf( fp, "%d", covan->result.sample_count );
+	_emitInt( covan->result.sample_count, fp );
 }
 static void _emitTabCovStatName( EMITTER_SIG ) {
 	fputs( covan->result.name, fp );
 }
 static void _emitTabCovErrBits( EMITTER_SIG ) {
-	fprintf( fp, "%02X", covan->status );
+	static const char HEX[] = "0123456789ABCDEF";
+	if( covan->status <= 0xFF ) {
+		fputc( HEX[ covan->status >> 4 ], fp );
+		fputc( HEX[ covan->status & 0xF ], fp );
+	} else
+		fprintf( fp, "%02X", covan->status );
 }
 static void _emitTabCovSign( EMITTER_SIG ) {
-	fprintf( fp, printf_format[0], covan->sign );
+	_emitDouble( 0, covan->sign, fp );
 }
 static void _emitTabCovStatValue( EMITTER_SIG ) {
-	fprintf( fp, printf_format[1], covan->result.value );
+	_emitDouble( 1, covan->result.value, fp );
 }
 static void _emitTabCovProb( EMITTER_SIG ) {
-	fprintf( fp, printf_format[2], covan->result.probability );
+	_emitDouble( 2, covan->result.probability, fp );
 }
 static void _emitTabCovLogProb( EMITTER_SIG ) {
 	const double d
 		= -log10(covan->result.probability);
-	fprintf( fp, printf_format[3], d );
+	_emitDouble( 3, d, fp );
 }
 static void _emitTabCovExtra( EMITTER_SIG ) {
 	fputs( NOTIMPL, fp );
@@ -106,10 +105,10 @@ static void _emitTabUniNameR( EMITTER_SIG ) {
 	fputs( pair->r.name ? pair->r.name : "?", fp );
 }
 static void _emitTabUniOffsetL( EMITTER_SIG ) {
-	fprintf( fp, "%d",  pair->l.offset );
+	_emitInt( pair->l.offset, fp );
 }
 static void _emitTabUniOffsetR( EMITTER_SIG ) {
-	fprintf( fp, "%d",  pair->r.offset );
+	_emitInt( pair->r.offset, fp );
 }
 
 static void _emitTabUniFeatureClassL( EMITTER_SIG ) {
@@ -129,10 +128,10 @@ static void _emitTabUniPreprocR( EMITTER_SIG ) {
 	fputs( NOTIMPL, fp );
 }
 static void _emitTabUniUnusedL( EMITTER_SIG ) {
-	fprintf( fp, "%d", covan->waste[0].unused );
+	_emitInt( covan->waste[0].unused, fp );
 }
 static void _emitTabUniUnusedR( EMITTER_SIG ) {
-	fprintf( fp, "%d", covan->waste[1].unused );
+	_emitInt( covan->waste[1].unused, fp );
 }
 static void _emitTabUniStatNameL( EMITTER_SIG ) {
 	fputs( covan->waste[0].result.name, fp );
@@ -141,16 +140,16 @@ static void _emitTabUniStatNameR( EMITTER_SIG ) {
 	fputs( covan->waste[1].result.name, fp );
 }
 static void _emitTabUniStatValueL( EMITTER_SIG ) {
-	fprintf( fp, printf_format[4], covan->waste[0].result.value );
+	_emitDouble( 4, covan->waste[0].result.value, fp );
 }
 static void _emitTabUniStatValueR( EMITTER_SIG ) {
-	fprintf( fp, printf_format[4], covan->waste[1].result.value );
+	_emitDouble( 4, covan->waste[1].result.value, fp );
 }
 static void _emitTabUniProbL( EMITTER_SIG ) {
-	fprintf( fp, printf_format[5], covan->waste[0].result.probability );
+	_emitDouble( 5, covan->waste[0].result.probability, fp );
 }
 static void _emitTabUniProbR( EMITTER_SIG ) {
-	fprintf( fp, printf_format[5], covan->waste[1].result.probability );
+	_emitDouble( 5, covan->waste[1].result.probability, fp );
 }
 static void _emitTabUniExtraL( EMITTER_SIG ) {
 	fputs( NOTIMPL, fp );
@@ -159,6 +158,221 @@ static void _emitTabUniExtraR( EMITTER_SIG ) {
 	fputs( NOTIMPL, fp );
 }
 
+/***************************************************************************
+  * JSON (NDJSON: one object per line)
+  * Each member is appended to a buffer that is reused for every line and
+  * only grows when a line exceeds all previous ones; emit_exec writes the
+  * completed line with a single fwrite. Numbers are rendered by numfmt in
+  * the column's microformat (less any '+', which JSON does not allow) or,
+  * if numfmt does not support it, in "%.3e". JSON has no representation
+  * of NaN or infinity, so they are emitted as null.
+  * A line for which the buffer could not be grown is dropped entirely.
+  */
+
+static struct {
+	char  *buf;
+	size_t len, cap;
+	bool failed; // ...the current line
+} _json;
+
+/**
+  * Insure room for n more characters.
+  */
+static char *_jreserve( size_t n ) {
+	if( _json.len + n > _json.cap ) {
+		size_t cap = _json.cap ? _json.cap : 1024;
+		char *buf;
+		while( cap < _json.len + n ) cap *= 2;
+		buf = realloc( _json.buf, cap );
+		if( buf == NULL ) {
+			_json.failed = true;
+			return NULL;
+		}
+		_json.buf = buf;
+		_json.cap = cap;
+	}
+	return _json.buf + _json.len;
+}
+
+static void _jraw( const char *s, size_t n ) {
+	char *pc = _jreserve( n );
+	if( pc ) {
+		memcpy( pc, s, n );
+		_json.len += n;
+	}
+}
+
+/**
+  * A string is copied verbatim unless it contains characters that must
+  * be escaped.
+  */
+static void _jstring( const char *s ) {
+
+	static const char HEX[] = "0123456789abcdef";
+	const size_t n = s ? strlen( s ) : 0;
+	size_t i;
+	char *pc;
+
+	if( s == NULL ) {
+		_jraw( "null", 4 );
+		return;
+	}
+	for(i = 0; i < n; i++ ) {
+		const unsigned char c = s[i];
+		if( c < 0x20 || c == '"' || c == '\\' )
+			break;
+	}
+	if( (pc = _jreserve( n + 2 + 5*(n-i) )) == NULL )
+		return;
+	*pc++ = '"';
+	memcpy( pc, s, i );
+	pc += i;
+	for(; i < n; i++ ) {
+		const unsigned char c = s[i];
+		if( c == '"' || c == '\\' ) {
+			*pc++ = '\\';
+			*pc++ = c;
+		} else
+		if( c < 0x20 ) {
+			*pc++ = '\\';
+			*pc++ = 'u';
+			*pc++ = '0';
+			*pc++ = '0';
+			*pc++ = HEX[ c >> 4 ];
+			*pc++ = HEX[ c & 0xF ];
+		} else
+			*pc++ = c;
+	}
+	*pc++ = '"';
+	_json.len = pc - _json.buf;
+}
+
+static void _jkey( const char *key ) {
+	_jstring( key );
+	_jraw( ":", 1 );
+}
+
+static void _jint( const char *key, long v ) {
+	char *pc;
+	_jkey( key );
+	if( (pc = _jreserve( NUMFMT_MAXLEN )) )
+		_json.len = numfmt_int( pc, v ) - _json.buf;
+}
+
+static void _jdouble( const char *key, int i, double v ) {
+	static const struct numfmt_spec DEFAULT = { 'e', false, 3 };
+	char *pc;
+	_jkey( key );
+	if( ! isfinite( v ) ) {
+		_jraw( "null", 4 );
+	} else
+	if( (pc = _jreserve( NUMFMT_MAXLEN )) ) {
+		struct numfmt_spec spec
+			= printf_spec[i].conv ? printf_spec[i] : DEFAULT;
+		spec.plus = false;
+		_json.len = numfmt_double( pc, v, &spec ) - _json.buf;
+	}
+}
+
+static void _jnull( const char *key ) {
+	_jkey( key );
+	_jraw( "null", 4 );
+}
+
+static void _emitJSONCovCount( EMITTER_SIG ) {
+	_jint( "count", covan->result.sample_count );
+}
+static void _emitJSONCovStatName( EMITTER_SIG ) {
+	_jkey( "stat" );
+	_jstring( covan->result.name );
+}
+static void _emitJSONCovErrBits( EMITTER_SIG ) {
+	_jint( "error", covan->status );
+}
+static void _emitJSONCovSign( EMITTER_SIG ) {
+	_jdouble( "sign", 0, covan->sign );
+}
+static void _emitJSONCovStatValue( EMITTER_SIG ) {
+	_jdouble( "value", 1, covan->result.value );
+}
+static void _emitJSONCovProb( EMITTER_SIG ) {
+	_jdouble( "p", 2, covan->result.probability );
+}
+static void _emitJSONCovLogProb( EMITTER_SIG ) {
+	_jdouble( "neglog10p", 3, -log10(covan->result.probability) );
+}
+static void _emitJSONCovExtra( EMITTER_SIG ) {
+	_jnull( "extra" );
+}
+static void _emitJSONUniNameL( EMITTER_SIG ) {
+	_jkey( "left_feature" );
+	_jstring( pair->l.name );
+}
+static void _emitJSONUniNameR( EMITTER_SIG ) {
+	_jkey( "right_feature" );
+	_jstring( pair->r.name );
+}
+static void _emitJSONUniOffsetL( EMITTER_SIG ) {
+	_jint( "left_offset", pair->l.offset );
+}
+static void _emitJSONUniOffsetR( EMITTER_SIG ) {
+	_jint( "right_offset", pair->r.offset );
+}
+static void _emitJSONUniFeatureClassL( EMITTER_SIG ) {
+	_jkey( "left_class" );
+#ifndef _UNIT_TEST_VARFMT
+	_jstring( mtm_sclass_name( covan->stat_class.left ) );
+#else
+	_jstring( NULL );
+#endif
+}
+static void _emitJSONUniFeatureClassR( EMITTER_SIG ) {
+	_jkey( "right_class" );
+#ifndef _UNIT_TEST_VARFMT
+	_jstring( mtm_sclass_name( covan->stat_class.right ) );
+#else
+	_jstring( NULL );
+#endif
+}
+static void _emitJSONUniPreprocL( EMITTER_SIG ) {
+	_jnull( "left_preproc" );
+}
+static void _emitJSONUniPreprocR( EMITTER_SIG ) {
+	_jnull( "right_preproc" );
+}
+static void _emitJSONUniUnusedL( EMITTER_SIG ) {
+	_jint( "left_unused", covan->waste[0].unused );
+}
+static void _emitJSONUniUnusedR( EMITTER_SIG ) {
+	_jint( "right_unused", covan->waste[1].unused );
+}
+static void _emitJSONUniStatNameL( EMITTER_SIG ) {
+	_jkey( "left_stat" );
+	_jstring( covan->waste[0].result.name );
+}
+static void _emitJSONUniStatNameR( EMITTER_SIG ) {
+	_jkey( "right_stat" );
+	_jstring( covan->waste[1].result.name );
+}
+static void _emitJSONUniStatValueL( EMITTER_SIG ) {
+	_jdouble( "left_value", 4, covan->waste[0].result.value );
+}
+static void _emitJSONUniStatValueR( EMITTER_SIG ) {
+	_jdouble( "right_value", 4, covan->waste[1].result.value );
+}
+static void _emitJSONUniProbL( EMITTER_SIG ) {
+	_jdouble( "left_p", 5, covan->waste[0].result.probability );
+}
+static void _emitJSONUniProbR( EMITTER_SIG ) {
+	_jdouble( "right_p", 5, covan->waste[1].result.probability );
+}
+static void _emitJSONUniExtraL( EMITTER_SIG ) {
+	_jnull( "left_extra" );
+}
+static void _emitJSONUniExtraR( EMITTER_SIG ) {
+	_jnull( "right_extra" );
+}
+
 /**
   * Notice I'm using a restricted printf formatting string.
   * Pad spaces are not allowed, mostly to simplify format parsing.
@@ -353,6 +567,8 @@ static void _fini() {
 	}
 	if( _emitter_specifier )
 		free( _emitter_specifier );
+	if( _json.buf )
+		free( _json.buf );
 }
 
 
@@ -404,10 +620,7 @@ const char *emit_config( const char *specifier_sequence, int format ) {
 	pc = _emitter_specifier = strdup( specifier_sequence );
 
 	assert( 0 <= format && format < 2 );
-
-	if( format == FORMAT_JSON ) {
-		return "JSON implementation incomplete";
-	}
+	_format = format;
 
 	if( _init() ) 
 		return "bug"; // should NEVER happen in Release build.
@@ -485,6 +698,9 @@ const char *emit_config( const char *specifier_sequence, int format ) {
 	if( d->name == NULL )
 		return specifier;
 
+	for(unsigned i = 0; i < NUM_PRINTF_FORMATS; i++ )
+		numfmt_parse( printf_format[i], printf_spec + i );
+
 	return NULL;
 }
 
@@ -492,6 +708,19 @@ const char *emit_config( const char *specifier_sequence, int format ) {
 void emit_exec( EMITTER_SIG ) {
 	int i;
 	char *sep = "";
+	if( _format == FORMAT_JSON ) {
+		_json.len    = 0;
+		_json.failed = false;
+		_jraw( "{", 1 );
+		for(i = 0; i < _columns; i++ ) {
+			if( i > 0 ) _jraw( ",", 1 );
+			_emitter[i]( pair, covan, fp );
+		}
+		_jraw( "}\n", 2 );
+		if( ! _json.failed )
+			fwrite( _json.buf, 1, _json.len, fp );
+		return;
+	}
 	for(i = 0; i < _columns; i++ ) {
 		fputs( sep, fp );
 		_emitter[i]( pair, covan, fp );
@@ -502,13 +731,129 @@ void emit_exec( EMITTER_SIG ) {
 
 
 #ifdef _UNIT_TEST_VARFMT
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+  * ut_varfmt <specifier> [ <format> ] configures the emitter and emits
+  * one line for a fabricated pair. Without arguments it checks the exact
+  * output of a few configurations. Since emit_config configures the
+  * process once, each is run in a child process.
+  */
+
+static int _failures = 0;
+
+/**
+  * The fabricated pair exercises string escapes, non-finite values
+  * (NaN, +/-infinity, and -log10 of a zero p-value) and microformats.
+  */
+static void _emit_fabricated( FILE *fp ) {
+
+	struct feature_pair pair;
+	struct CovariateAnalysis covan;
+
+	memset( &pair,  0, sizeof(pair) );
+	memset( &covan, 0, sizeof(covan) );
+	pair.l.name   = "N:GEXP:\"quoted\"\tname\\\x01";
+	pair.r.name   = "C:CLIN:plain";
+	pair.r.offset = 7;
+	covan.status  = 0x12;
+	covan.sign    = -0.25;
+	covan.result.name = "Kruskal-Wallis_K";
+	covan.result.value = 1.5;
+	covan.result.sample_count = 40;
+	covan.result.probability  = 0.0;
+	covan.waste[0].result.name = covan.waste[1].result.name = "?";
+	covan.waste[0].result.value = nan("");
+	covan.waste[1].result.value = -INFINITY;
+	covan.waste[1].result.probability = INFINITY;
+	emit_exec( &pair, &covan, fp );
+}
+
+static void _expect( const char *specifier, int format, const char *expect ) {
+
+	char got[ 2048 ];
+	size_t len = 0;
+	ssize_t n;
+	int fd[2];
+	pid_t pid;
+
+	fflush( stdout );
+	if( pipe( fd ) || ( pid = fork() ) < 0 ) {
+		perror( "ut_varfmt" );
+		exit( EXIT_FAILURE );
+	}
+	if( pid == 0 ) {
+		FILE *fp = fdopen( fd[1], "w" );
+		const char *bad;
+		close( fd[0] );
+		// ...emit_config lists what it matched on stdout.
+		if( freopen( "/dev/null", "w", stdout ) == NULL )
+			_exit( EXIT_FAILURE );
+		bad = emit_config( specifier, format );
+		if( bad )
+			fprintf( fp, "invalid specifier \"%s\"\n", bad );
+		else
+			_emit_fabricated( fp );
+		fclose( fp );
+		_exit( EXIT_SUCCESS );
+	}
+	close( fd[1] );
+	while( len < sizeof(got) - 1
+			&& ( n = read( fd[0], got + len, sizeof(got) - 1 - len ) ) > 0 )
+		len += n;
+	got[ len ] = '\0';
+	close( fd[0] );
+	waitpid( pid, NULL, 0 );
+
+	if( strcmp( got, expect ) ) {
+		fprintf( stderr, "\"%s\" (format %d): expected\n%s...got\n%s",
+			specifier, format, expect, got );
+		_failures += 1;
+	}
+}
+
+#define SPECIFIER "<f >f <o >o st si v%+.2f p P <v >v <pro >pro c e x"
+
 int main( int argc, char *argv[] ) {
+
 	if( argc > 1 ) {
-		emit_config( argv[1], argc > 2 ? atoi(argv[2]) : 0 );
-	} else
-		return EXIT_FAILURE;
+		const char *bad
+			= emit_config( argv[1], argc > 2 ? atoi(argv[2]) : 0 );
+		if( bad ) {
+			fprintf( stderr, "invalid specifier \"%s\"\n", bad );
+			return EXIT_FAILURE;
+		}
+		_emit_fabricated( stdout );
+		return EXIT_SUCCESS;
+	}
 
-	return EXIT_SUCCESS;
+	_expect( SPECIFIER, FORMAT_TABULAR,
+		"N:GEXP:\"quoted\"\tname\\\x01\tC:CLIN:plain\t0\t7\tKruskal-Wallis_K"
+		"\t-2.500e-01\t+1.50\t0.000e+00\tinf\tnan\t-inf\t0.000e+00\tinf"
+		"\t40\t12\tunimplemented\n" );
+
+	// JSON escapes the names, renders non-finite values as null and
+	// drops the '+' of the value's microformat.
+
+	_expect( SPECIFIER, FORMAT_JSON,
+		"{\"left_feature\":\"N:GEXP:\\\"quoted\\\"\\u0009name\\\\\\u0001\","
+		"\"right_feature\":\"C:CLIN:plain\","
+		"\"left_offset\":0,\"right_offset\":7,"
+		"\"stat\":\"Kruskal-Wallis_K\",\"sign\":-2.500e-01,\"value\":1.50,"
+		"\"p\":0.000e+00,\"neglog10p\":null,"
+		"\"left_value\":null,\"right_value\":null,"
+		"\"left_p\":0.000e+00,\"right_p\":null,"
+		"\"count\":40,\"error\":18,\"extra\":null}\n" );
+
+	// The magic format names (see main.c) are no JSON specifiers.
+
+	_expect( "std",    FORMAT_JSON, "invalid specifier \"std\"\n" );
+	_expect( "tcga",   FORMAT_JSON, "invalid specifier \"tcga\"\n" );
+	_expect( "binary", FORMAT_JSON, "invalid specifier \"binary\"\n" );
+
+	if( _failures == 0 )
+		printf( "ok\n" );
+	return _failures ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 #endif
-
@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# This script verifies that skipping rows that can take part in no test
+# (constant, empty, or nearly empty rows) changes neither the output nor
+# the summary counts of an all-pairs run, with and without tiling.
+# It generates a random matrix (with preptest.py), inserts such rows, and
+# compares the output with that of --debug P, which disables the skipping.
+# The executable must therefore be a debug build (make DEBUG=1).
+#
+# If the outputs are identical it emits nothing and exits 0.
+# Otherwise it names the options under which they differed and exits 1.
+
+if [ $# -lt 1 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "prefilter.sh <debug executable> [ row_count [ column_count ] ]"
+	exit 0
+fi
+
+EXECUTABLE=$1
+ROWS=${2:-200}
+COLUMNS=${3:-400}
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+python3 "$(dirname "$0")/preptest.py" $((ROWS*2/3)) $((ROWS-ROWS*2/3)) $COLUMNS > "$DIR/random" || exit 1
+{
+	head -n 1 "$DIR/random"
+	awk -v n=$COLUMNS '
+		function row( label, first, rest,   i, s ) {
+			s = label "\t" first
+			for(i = 2; i <= n; i++ )
+				s = s "\t" rest
+			print s
+		}
+		BEGIN {
+			row( "N:CONSTANT", "1.5", "1.5" )
+			row( "C:CONSTANT", "AAA", "AAA" )
+			row( "N:EMPTY",    "NA",  "NA" )
+			row( "C:EMPTY",    "NA",  "NA" )
+			row( "N:SINGLE",   "1.5", "NA" )
+			row( "C:SINGLE",   "AAA", "NA" )
+		}'
+	tail -n +2 "$DIR/random"
+} > "$DIR/input"
+
+status=0
+for tiling in "" --tiled; do
+	"$EXECUTABLE" $tiling "$DIR/input" > "$DIR/skipping" || exit 1
+	"$EXECUTABLE" $tiling --debug P "$DIR/input" > "$DIR/all" || exit 1
+	if ! cmp -s "$DIR/skipping" "$DIR/all"; then
+		echo "output${tiling:+ with $tiling} differs under --debug P"
+		status=1
+	fi
+done
+exit $status
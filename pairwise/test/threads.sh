@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# This script verifies that all-pairs output does not depend on the number
+# of worker processes, with and without tiling.
+# It generates a random matrix (with preptest.py) whose rows are long
+# enough that tiles hold fewer than all rows, and compares the output of
+# --threads 1 with that of --threads 4.
+#
+# If the outputs are identical it emits nothing and exits 0.
+# Otherwise it names the options under which they differed and exits 1.
+
+if [ $# -lt 1 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "threads.sh <executable> [ row_count [ column_count ] ]"
+	exit 0
+fi
+
+EXECUTABLE=$1
+ROWS=${2:-300}
+COLUMNS=${3:-2000}
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+python3 "$(dirname "$0")/preptest.py" $((ROWS*2/3)) $((ROWS-ROWS*2/3)) $COLUMNS > "$DIR/input" || exit 1
+
+status=0
+for tiling in "" --tiled; do
+	"$EXECUTABLE" -T 1 $tiling "$DIR/input" > "$DIR/1" || exit 1
+	"$EXECUTABLE" -T 4 $tiling "$DIR/input" > "$DIR/4" || exit 1
+	if ! cmp -s "$DIR/1" "$DIR/4"; then
+		echo "--threads 4 $tiling output differs from --threads 1"
+		status=1
+	fi
+done
+exit $status